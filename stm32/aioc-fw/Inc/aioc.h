@@ -8,4 +8,9 @@
 #define AIOC_IRQ_PRIO_SERIAL     3
 #define AIOC_IRQ_PRIO_AUDIO      2
 
+/* Build identification reported to the host. Can be overridden by the build system (e.g. with a git describe string) */
+#ifndef AIOC_BUILD_ID
+#define AIOC_BUILD_ID            __DATE__ " " __TIME__
+#endif
+
 #endif /* AIOC_H_ */
@@ -96,7 +96,7 @@
 
 //------------- CLASS -------------//
 #define CFG_TUD_AUDIO             1
-#define CFG_TUD_CDC               1
+#define CFG_TUD_CDC               2 /* Second instance is the optional control CDC */
 #define CFG_TUD_HID               1
 #define CFG_TUD_DFU_RUNTIME       1
 
@@ -107,8 +107,8 @@
 // CDC Endpoint transfer buffer size, more is faster
 #define CFG_TUD_CDC_EP_BUFSIZE   64
 
-// HID buffer size
-#define CFG_TUD_HID_EP_BUFSIZE   8
+// HID buffer size (large enough for the telemetry input report)
+#define CFG_TUD_HID_EP_BUFSIZE   32
 
  //--------------------------------------------------------------------
  // AUDIO CLASS DRIVER CONFIGURATION
@@ -0,0 +1,146 @@
+#include "afsk.h"
+#include "modem.h"
+#include "dsp.h"
+
+/* Non-coherent quadrature correlator. Each tone is mixed down to baseband and integrated
+ * over one bit period with a sliding window. The stronger tone decides the line level,
+ * a digital PLL recovers the bit clock from the level transitions. */
+typedef struct {
+    uint32_t markStep;
+    uint32_t spaceStep;
+    uint32_t markPhase;
+    uint32_t spacePhase;
+    int16_t markI[AFSK_RX_WINDOW_MAX];
+    int16_t markQ[AFSK_RX_WINDOW_MAX];
+    int16_t spaceI[AFSK_RX_WINDOW_MAX];
+    int16_t spaceQ[AFSK_RX_WINDOW_MAX];
+    int32_t markSumI;
+    int32_t markSumQ;
+    int32_t spaceSumI;
+    int32_t spaceSumQ;
+    uint8_t window;
+    uint8_t pos;
+    uint32_t pllStep;
+    int32_t pll;
+    uint8_t level;
+} afsk_rx_t;
+
+static afsk_rx_t rx;
+
+/* Phase-continuous tone generator, switching tones on every zero bit (NRZI) */
+typedef struct {
+    uint32_t markStep;
+    uint32_t spaceStep;
+    uint32_t phase;
+    uint32_t baudStep;
+    uint32_t baudPhase;
+    uint16_t level;
+    bool mark;
+} afsk_tx_t;
+
+static afsk_tx_t tx;
+
+static inline int64_t Energy(int32_t i, int32_t q)
+{
+    return (int64_t) i * i + (int64_t) q * q;
+}
+
+void Afsk_RxInit(uint32_t sampleRate)
+{
+    rx = (afsk_rx_t) {
+        .markStep = Dsp_PhaseStep(AFSK_MARK_HZ, sampleRate),
+        .spaceStep = Dsp_PhaseStep(AFSK_SPACE_HZ, sampleRate),
+        .window = (sampleRate + AFSK_BAUD / 2) / AFSK_BAUD,
+        .pllStep = Dsp_PhaseStep(AFSK_BAUD, sampleRate)
+    };
+
+    if (rx.window > AFSK_RX_WINDOW_MAX) {
+        rx.window = AFSK_RX_WINDOW_MAX;
+    }
+}
+
+void Afsk_RxProcess(const int16_t * samples, uint16_t count)
+{
+    while (count--) {
+        int32_t sample = *samples++;
+        uint8_t pos = rx.pos;
+
+        int16_t markI = (sample * Dsp_Cosine(rx.markPhase)) >> 15;
+        int16_t markQ = (sample * Dsp_Sine(rx.markPhase)) >> 15;
+        int16_t spaceI = (sample * Dsp_Cosine(rx.spacePhase)) >> 15;
+        int16_t spaceQ = (sample * Dsp_Sine(rx.spacePhase)) >> 15;
+
+        rx.markPhase += rx.markStep;
+        rx.spacePhase += rx.spaceStep;
+
+        /* Sliding window integration over one bit period */
+        rx.markSumI += markI - rx.markI[pos];
+        rx.markSumQ += markQ - rx.markQ[pos];
+        rx.spaceSumI += spaceI - rx.spaceI[pos];
+        rx.spaceSumQ += spaceQ - rx.spaceQ[pos];
+        rx.markI[pos] = markI;
+        rx.markQ[pos] = markQ;
+        rx.spaceI[pos] = spaceI;
+        rx.spaceQ[pos] = spaceQ;
+        rx.pos = (pos + 1 < rx.window) ? pos + 1 : 0;
+
+        uint8_t level = Energy(rx.markSumI, rx.markSumQ) > Energy(rx.spaceSumI, rx.spaceSumQ);
+
+        /* The bit is sampled when the PLL wraps around, i.e. half a bit period after the (expected) transition */
+        int32_t pllPrevious = rx.pll;
+        rx.pll = (int32_t) ((uint32_t) rx.pll + rx.pllStep);
+
+        if ((pllPrevious > 0) && (rx.pll < 0)) {
+            Modem_RxLevel(level);
+        }
+
+        if (level != rx.level) {
+            /* Pull the clock phase towards the transition */
+            int32_t lead = (int32_t) (0x100000000ULL / AFSK_RX_PLL_LEAD);
+            int32_t error = (int32_t) ((uint32_t) rx.pll - (uint32_t) lead);
+
+            rx.pll = (int32_t) ((uint32_t) lead + (uint32_t) (((int64_t) error * AFSK_RX_PLL_INERTIA) >> 2));
+            rx.level = level;
+        }
+    }
+}
+
+void Afsk_TxInit(uint32_t sampleRate, uint16_t level)
+{
+    uint32_t baudStep = Dsp_PhaseStep(AFSK_BAUD, sampleRate);
+
+    tx = (afsk_tx_t) {
+        .markStep = Dsp_PhaseStep(AFSK_MARK_HZ, sampleRate),
+        .spaceStep = Dsp_PhaseStep(AFSK_SPACE_HZ, sampleRate),
+        .baudStep = baudStep,
+        .baudPhase = -baudStep, /* Fetch the first bit with the first sample */
+        .level = level,
+        .mark = true
+    };
+}
+
+bool Afsk_TxSample(int16_t * sample)
+{
+    /* Called at audio interrupt priority. Returns false after the last bit */
+    uint32_t baudPrevious = tx.baudPhase;
+
+    tx.baudPhase += tx.baudStep;
+
+    if (tx.baudPhase < baudPrevious) {
+        int8_t bit = Modem_TxBit();
+
+        if (bit < 0) {
+            *sample = 0;
+            return false;
+        }
+
+        if (bit == 0) {
+            tx.mark = !tx.mark;
+        }
+    }
+
+    *sample = ((int32_t) Dsp_Sine(tx.phase) * tx.level) >> 16;
+    tx.phase += tx.mark ? tx.markStep : tx.spaceStep;
+
+    return true;
+}
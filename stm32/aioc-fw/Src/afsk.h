@@ -0,0 +1,20 @@
+#ifndef AFSK_H_
+#define AFSK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Bell 202 AFSK at 1200 baud */
+#define AFSK_BAUD               1200
+#define AFSK_MARK_HZ            1200
+#define AFSK_SPACE_HZ           2200
+#define AFSK_RX_WINDOW_MAX      16  /* Correlator length in samples (one bit period), limits the sample rate to 19.2 kHz */
+#define AFSK_RX_PLL_INERTIA     3   /* On a transition, the bit clock phase error is multiplied by INERTIA/4 */
+#define AFSK_RX_PLL_LEAD        16  /* Sample 1/LEAD of a bit period early, which is more robust against the unequal tone responses */
+
+void Afsk_RxInit(uint32_t sampleRate);
+void Afsk_RxProcess(const int16_t * samples, uint16_t count);
+void Afsk_TxInit(uint32_t sampleRate, uint16_t level);
+bool Afsk_TxSample(int16_t * sample);
+
+#endif /* AFSK_H_ */
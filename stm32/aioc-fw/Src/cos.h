@@ -12,35 +12,35 @@ static inline void COS_VirtualSetState(uint8_t state)
     LED_SET(0, state & 0x01 ? 1 : 0);
 
     if (settingsRegMap[SETTINGS_REG_CM108_IOMUX0] & SETTINGS_REG_CM108_IOMUX0_BTN1SRC_VCOS_MASK) {
-        USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_VOLUP : 0x00);
+        USB_HIDSendButtonState(USB_HID_SOURCE_VCOS, USB_HID_BUTTON_VOLUP, state & 0x01);
     }
 
     if (settingsRegMap[SETTINGS_REG_CM108_IOMUX1] & SETTINGS_REG_CM108_IOMUX1_BTN2SRC_VCOS_MASK) {
-        USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_VOLDN : 0x00);
+        USB_HIDSendButtonState(USB_HID_SOURCE_VCOS, USB_HID_BUTTON_VOLDN, state & 0x01);
     }
 
     if (settingsRegMap[SETTINGS_REG_CM108_IOMUX2] & SETTINGS_REG_CM108_IOMUX2_BTN3SRC_VCOS_MASK) {
-        USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_PLAYMUTE : 0x00);
+        USB_HIDSendButtonState(USB_HID_SOURCE_VCOS, USB_HID_BUTTON_PLAYMUTE, state & 0x01);
     }
 
     if (settingsRegMap[SETTINGS_REG_CM108_IOMUX3] & SETTINGS_REG_CM108_IOMUX3_BTN4SRC_VCOS_MASK) {
-        USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_RECMUTE : 0x00);
+        USB_HIDSendButtonState(USB_HID_SOURCE_VCOS, USB_HID_BUTTON_RECMUTE, state & 0x01);
     }
 
     if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX0] & SETTINGS_REG_SERIAL_IOMUX0_DCDSRC_VCOS_MASK) {
-        USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_DCD : 0x00);
+        USB_SerialSendLineState(USB_SERIAL_SOURCE_VCOS, USB_SERIAL_LINESTATE_DCD, state & 0x01);
     }
 
     if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX1] & SETTINGS_REG_SERIAL_IOMUX1_DSRSRC_VCOS_MASK) {
-        USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_DSR : 0x00);
+        USB_SerialSendLineState(USB_SERIAL_SOURCE_VCOS, USB_SERIAL_LINESTATE_DSR, state & 0x01);
     }
 
     if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX2] & SETTINGS_REG_SERIAL_IOMUX2_RISRC_VCOS_MASK) {
-        USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_RI : 0x00);
+        USB_SerialSendLineState(USB_SERIAL_SOURCE_VCOS, USB_SERIAL_LINESTATE_RI, state & 0x01);
     }
 
     if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX3] & SETTINGS_REG_SERIAL_IOMUX3_BRKSRC_VCOS_MASK) {
-        USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_BREAK : 0x00);
+        USB_SerialSendLineState(USB_SERIAL_SOURCE_VCOS, USB_SERIAL_LINESTATE_BREAK, state & 0x01);
     }
 }
 
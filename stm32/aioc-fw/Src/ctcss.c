@@ -0,0 +1,230 @@
+#include "ctcss.h"
+#include "settings.h"
+#include <math.h>
+
+/* Standard CTCSS tones in units of 0.1 Hz */
+static const uint16_t ctcssTones[CTCSS_TONES] = {
+     670,  693,  719,  744,  770,  797,  825,  854,  885,  915,
+     948,  974, 1000, 1035, 1072, 1109, 1148, 1188, 1230, 1273,
+    1318, 1365, 1413, 1462, 1514, 1567, 1598, 1622, 1655, 1679,
+    1713, 1738, 1773, 1799, 1835, 1862, 1899, 1928, 1966, 1995,
+    2035, 2065, 2107, 2181, 2257, 2291, 2336, 2418, 2503, 2541
+};
+
+typedef struct {
+    float b0, b1, b2, a1, a2;
+    float z1, z2;
+} biquad_t;
+
+static bool ctcssEnabled = false;
+
+/* Anti-aliasing low pass and decimation */
+static biquad_t lowpass[2];
+static uint8_t decimFactor = 1;
+static uint8_t decimCount = 0;
+
+/* Goertzel filter bank */
+static float coefficients[CTCSS_TONES];
+static float state1[CTCSS_TONES];
+static float state2[CTCSS_TONES];
+static uint16_t windowLength = 0;
+static uint16_t windowPos = 0;
+
+static int8_t detectedTone = -1;
+static uint8_t missCount = 0;
+static uint16_t detectedLevel = 0;
+
+static void InfoUpdate(void)
+{
+    settingsRegMap[SETTINGS_REG_INFO_CTCSS0] =
+            (((uint32_t) Ctcss_Tone() << SETTINGS_REG_INFO_CTCSS0_TONE_OFFS) & SETTINGS_REG_INFO_CTCSS0_TONE_MASK) |
+            (((uint32_t) detectedLevel << SETTINGS_REG_INFO_CTCSS0_LEVEL_OFFS) & SETTINGS_REG_INFO_CTCSS0_LEVEL_MASK);
+}
+
+static void LowpassInit(biquad_t * biquad, float w0, float q)
+{
+    /* Bilinear transform of a 2nd order low pass section */
+    float cosw0 = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * q);
+    float a0 = 1.0f + alpha;
+
+    *biquad = (biquad_t) {
+        .b0 = (1.0f - cosw0) / 2.0f / a0,
+        .b1 = (1.0f - cosw0) / a0,
+        .b2 = (1.0f - cosw0) / 2.0f / a0,
+        .a1 = -2.0f * cosw0 / a0,
+        .a2 = (1.0f - alpha) / a0
+    };
+}
+
+static inline float Biquad(biquad_t * biquad, float x)
+{
+    /* Transposed direct form II */
+    float y = biquad->b0 * x + biquad->z1;
+    biquad->z1 = biquad->b1 * x - biquad->a1 * y + biquad->z2;
+    biquad->z2 = biquad->b2 * x - biquad->a2 * y;
+
+    return y;
+}
+
+static int8_t ConfiguredTone(void)
+{
+    /* Nearest standard tone to the configured frequency or -1 for any tone */
+    uint16_t frequency = SETTINGS_GET(SETTINGS_REG_CTCSS_CTRL, FREQ);
+    int8_t nearest = -1;
+    uint16_t nearestDistance = UINT16_MAX;
+
+    if (frequency == 0) {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < CTCSS_TONES; i++) {
+        uint16_t distance = (ctcssTones[i] > frequency) ? ctcssTones[i] - frequency : frequency - ctcssTones[i];
+
+        if (distance < nearestDistance) {
+            nearest = i;
+            nearestDistance = distance;
+        }
+    }
+
+    return nearest;
+}
+
+static void Evaluate(void)
+{
+    float power[CTCSS_TONES];
+    uint8_t peak = 0;
+
+    for (uint8_t i = 0; i < CTCSS_TONES; i++) {
+        power[i] = state1[i] * state1[i] + state2[i] * state2[i] - coefficients[i] * state1[i] * state2[i];
+
+        if (power[i] > power[peak]) {
+            peak = i;
+        }
+    }
+
+    float otherPower = 0;
+    uint8_t otherCount = 0;
+
+    for (uint8_t i = 0; i < CTCSS_TONES; i++) {
+        uint32_t distance = (ctcssTones[i] > ctcssTones[peak]) ? ctcssTones[i] - ctcssTones[peak] : ctcssTones[peak] - ctcssTones[i];
+
+        if (distance * 1000 > (uint32_t) ctcssTones[peak] * CTCSS_SPACING) {
+            otherPower += power[i];
+            otherCount++;
+        }
+    }
+
+    /* A sine of amplitude A yields a Goertzel power of (A * N / 2)^2 */
+    float level = 2.0f * sqrtf(power[peak]) / windowLength;
+    float minLevel = SETTINGS_GET(SETTINGS_REG_CTCSS_CTRL, LEVEL);
+
+    /* A different tone while one is detected (e.g. the smeared spectrum of a window at the end of the tone) counts as a miss */
+    bool present = (level >= minLevel) && (power[peak] * otherCount >= otherPower * CTCSS_CONTRAST) &&
+                   ((detectedTone < 0) || (detectedTone == peak));
+
+    if (present) {
+        detectedTone = peak;
+        detectedLevel = (level > UINT16_MAX) ? UINT16_MAX : (uint16_t) level;
+        missCount = 0;
+    } else if ((detectedTone >= 0) && (++missCount >= CTCSS_RELEASE)) {
+        detectedTone = -1;
+        detectedLevel = 0;
+    }
+
+    InfoUpdate();
+}
+
+void Ctcss_Init(void)
+{
+    /* The capture path is set up once, so this is latched until next reboot */
+    ctcssEnabled = SETTINGS_GET(SETTINGS_REG_CTCSS_CTRL, ENABLE) != 0;
+
+    detectedTone = -1;
+    detectedLevel = 0;
+    InfoUpdate();
+}
+
+void Ctcss_Configure(uint32_t sampleRate)
+{
+    const float pi = 3.14159265f;
+    float w0 = 2.0f * pi * CTCSS_CUTOFF / sampleRate;
+
+    /* 4th order Butterworth as two 2nd order sections */
+    LowpassInit(&lowpass[0], w0, 0.5412f);
+    LowpassInit(&lowpass[1], w0, 1.3066f);
+
+    decimFactor = sampleRate / CTCSS_RATE;
+
+    if (decimFactor == 0) {
+        decimFactor = 1;
+    }
+
+    decimCount = 0;
+
+    uint32_t rate = sampleRate / decimFactor;
+
+    for (uint8_t i = 0; i < CTCSS_TONES; i++) {
+        coefficients[i] = 2.0f * cosf(2.0f * pi * ctcssTones[i] / (10.0f * rate));
+        state1[i] = 0;
+        state2[i] = 0;
+    }
+
+    windowLength = rate * CTCSS_WINDOW_MS / 1000;
+    windowPos = 0;
+}
+
+void Ctcss_Process(const int16_t * samples, uint16_t count)
+{
+    if (windowLength == 0) {
+        return;
+    }
+
+    for (uint16_t n = 0; n < count; n++) {
+        float x = Biquad(&lowpass[1], Biquad(&lowpass[0], samples[n]));
+
+        if (++decimCount < decimFactor) {
+            continue;
+        }
+
+        decimCount = 0;
+
+        for (uint8_t i = 0; i < CTCSS_TONES; i++) {
+            float s = x + coefficients[i] * state1[i] - state2[i];
+            state2[i] = state1[i];
+            state1[i] = s;
+        }
+
+        if (++windowPos >= windowLength) {
+            Evaluate();
+
+            for (uint8_t i = 0; i < CTCSS_TONES; i++) {
+                state1[i] = 0;
+                state2[i] = 0;
+            }
+
+            windowPos = 0;
+        }
+    }
+}
+
+bool Ctcss_Enabled(void)
+{
+    return ctcssEnabled;
+}
+
+uint16_t Ctcss_Tone(void)
+{
+    return (detectedTone >= 0) ? ctcssTones[detectedTone] : 0;
+}
+
+bool Ctcss_Match(void)
+{
+    if (detectedTone < 0) {
+        return false;
+    }
+
+    int8_t configured = ConfiguredTone();
+
+    return (configured < 0) || (configured == detectedTone);
+}
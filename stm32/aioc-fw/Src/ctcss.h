@@ -0,0 +1,31 @@
+#ifndef CTCSS_H_
+#define CTCSS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* CTCSS (sub-audible tone) detector. The tone analysis stream is low pass filtered, decimated
+ * and fed into a Goertzel filter bank on the 50 standard tones, evaluated once per window.
+ * The strongest tone is detected when it is above the minimum level and stands out from the average of the
+ * bins more than CTCSS_SPACING away from it (voice above the band leaks only little into the bank).
+ * It is considered gone after CTCSS_RELEASE windows without it (or with a different tone). */
+#define CTCSS_TONES             50
+#define CTCSS_RATE              1000 /* Analysis rate is decimated to no less than this */
+#define CTCSS_CUTOFF            300  /* Anti-aliasing low pass (4th order Butterworth) before decimation */
+#define CTCSS_WINDOW_MS         200
+#define CTCSS_RELEASE           2
+#define CTCSS_CONTRAST          10.0f /* Minimum ratio of the tone power to the average power of distant bins */
+#define CTCSS_SPACING           60    /* Bins within this distance (in 0.1%) of the tone are excluded from the average */
+
+void Ctcss_Init(void);
+void Ctcss_Configure(uint32_t sampleRate);
+void Ctcss_Process(const int16_t * samples, uint16_t count);
+bool Ctcss_Enabled(void);
+
+/* Detected tone in units of 0.1 Hz or 0 if none */
+uint16_t Ctcss_Tone(void);
+
+/* True while the configured tone (or any tone, if none is configured) is detected */
+bool Ctcss_Match(void);
+
+#endif /* CTCSS_H_ */
@@ -0,0 +1,78 @@
+#include "dsp.h"
+#include <math.h>
+#include <stddef.h>
+
+/* One full sine period in Q15 */
+const int16_t dspSineLUT[DSP_SINE_LUT_SIZE] = {
+         0,    804,   1608,   2410,   3212,   4011,   4808,   5602,   6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+     12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,  18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+     23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,  27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+     30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,  32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+     32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,  32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+     30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,  27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+     23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,  18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+     12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,   6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+         0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,  -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530, -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+    -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790, -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+    -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971, -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285, -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+    -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683, -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+    -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868, -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,  -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804
+};
+
+float Dsp_RootRaisedCosine(float t, float beta)
+{
+    const float pi = 3.14159265f;
+
+    if (fabsf(t) < 1e-6f) {
+        return 1.0f - beta + 4.0f * beta / pi;
+    }
+
+    if (fabsf(fabsf(t) - 1.0f / (4.0f * beta)) < 1e-6f) {
+        /* Removable singularity */
+        return beta / sqrtf(2.0f) * ((1.0f + 2.0f / pi) * sinf(pi / (4.0f * beta)) + (1.0f - 2.0f / pi) * cosf(pi / (4.0f * beta)));
+    }
+
+    return (sinf(pi * t * (1.0f - beta)) + 4.0f * beta * t * cosf(pi * t * (1.0f + beta))) /
+            (pi * t * (1.0f - (4.0f * beta * t) * (4.0f * beta * t)));
+}
+
+void Dsp_DecimInit(dsp_decim_t * decim, uint8_t factor)
+{
+    *decim = (dsp_decim_t) {
+        .factor = (factor > 0) ? factor : 1
+    };
+}
+
+void Dsp_RingInit(dsp_ring_t * ring, int16_t * buffer, uint16_t blockLength, uint8_t blockCount)
+{
+    *ring = (dsp_ring_t) {
+        .buffer = buffer,
+        .blockLength = blockLength,
+        .blockCount = blockCount
+    };
+}
+
+void Dsp_RingReset(dsp_ring_t * ring)
+{
+    /* Drop all data, the writer must not be active */
+    ring->writePos = 0;
+    ring->readBlock = ring->writeBlock;
+}
+
+const int16_t * Dsp_RingRead(dsp_ring_t * ring)
+{
+    /* Oldest complete block or NULL */
+    if (ring->readBlock == ring->writeBlock) {
+        return NULL;
+    }
+
+    return &ring->buffer[ring->readBlock * ring->blockLength];
+}
+
+void Dsp_RingRelease(dsp_ring_t * ring)
+{
+    ring->readBlock = (ring->readBlock + 1 < ring->blockCount) ? ring->readBlock + 1 : 0;
+}
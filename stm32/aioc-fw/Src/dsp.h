@@ -0,0 +1,123 @@
+#ifndef DSP_H_
+#define DSP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Common helpers for the on-device signal processing */
+#define DSP_SINE_LUT_BITS   8
+#define DSP_SINE_LUT_SIZE   (1 << DSP_SINE_LUT_BITS)
+
+extern const int16_t dspSineLUT[DSP_SINE_LUT_SIZE];
+
+/* Sine of a 32 bit phase (full circle = 2^32) in Q15 */
+static inline int16_t Dsp_Sine(uint32_t phase)
+{
+    return dspSineLUT[phase >> (32 - DSP_SINE_LUT_BITS)];
+}
+
+/* Cosine of a 32 bit phase (full circle = 2^32) in Q15 */
+static inline int16_t Dsp_Cosine(uint32_t phase)
+{
+    return dspSineLUT[(phase + 0x40000000UL) >> (32 - DSP_SINE_LUT_BITS)];
+}
+
+/* Phase increment per sample for a frequency in Hz */
+static inline uint32_t Dsp_PhaseStep(uint32_t frequency, uint32_t sampleRate)
+{
+    return (uint32_t) (((uint64_t) frequency << 32) / sampleRate);
+}
+
+/* Boxcar decimator, which places its nulls at multiples of the output rate */
+typedef struct {
+    int32_t accu;
+    uint8_t count;
+    uint8_t factor;
+} dsp_decim_t;
+
+/* Block ring, filled sample by sample from an interrupt and consumed block by block from the main loop.
+ * Blocks from readBlock up to (excluding) writeBlock are complete */
+typedef struct {
+    int16_t * buffer;
+    uint16_t blockLength;
+    uint8_t blockCount;
+    volatile uint8_t writeBlock;
+    volatile uint8_t readBlock;
+    uint16_t writePos;
+    volatile uint8_t overruns;
+} dsp_ring_t;
+
+/* Returns true, when a decimated sample is available in *output */
+static inline bool Dsp_Decimate(dsp_decim_t * decim, int16_t sample, int16_t * output)
+{
+    decim->accu += sample;
+
+    if (++decim->count < decim->factor) {
+        return false;
+    }
+
+    *output = decim->accu / decim->factor;
+    decim->accu = 0;
+    decim->count = 0;
+
+    return true;
+}
+
+/* Called from interrupt context only */
+static inline void Dsp_RingWrite(dsp_ring_t * ring, int16_t sample)
+{
+    ring->buffer[ring->writeBlock * ring->blockLength + ring->writePos] = sample;
+
+    if (++ring->writePos >= ring->blockLength) {
+        uint8_t next = (ring->writeBlock + 1 < ring->blockCount) ? ring->writeBlock + 1 : 0;
+
+        ring->writePos = 0;
+
+        if (next == ring->readBlock) {
+            /* Main loop did not keep up, overwrite the current block */
+            ring->overruns++;
+        } else {
+            ring->writeBlock = next;
+        }
+    }
+}
+
+/* G.711 mu-law compression of a 16 bit sample (14 bit magnitude) into 8 bits */
+static inline uint8_t Dsp_UlawEncode(int16_t sample)
+{
+    uint8_t sign = (sample < 0) ? 0x80 : 0x00;
+    int32_t magnitude = ((sample < 0) ? -(int32_t) sample : sample) >> 2;
+
+    magnitude += 33; /* Bias, so every segment starts at a power of 2 */
+
+    if (magnitude > 0x1FFF) {
+        magnitude = 0x1FFF;
+    }
+
+    uint8_t exponent = 31 - 5 - __builtin_clz(magnitude);
+    uint8_t mantissa = (magnitude >> (exponent + 1)) & 0x0F;
+
+    return ~(sign | (exponent << 4) | mantissa);
+}
+
+static inline int16_t Dsp_UlawDecode(uint8_t code)
+{
+    code = ~code;
+
+    uint8_t exponent = (code >> 4) & 0x07;
+    int32_t magnitude = ((((code & 0x0F) << 1) + 33) << exponent) - 33;
+
+    return (code & 0x80) ? (int16_t) -(magnitude << 2) : (int16_t) (magnitude << 2);
+}
+
+void Dsp_DecimInit(dsp_decim_t * decim, uint8_t factor);
+void Dsp_RingInit(dsp_ring_t * ring, int16_t * buffer, uint16_t blockLength, uint8_t blockCount);
+void Dsp_RingReset(dsp_ring_t * ring);
+const int16_t * Dsp_RingRead(dsp_ring_t * ring);
+void Dsp_RingRelease(dsp_ring_t * ring);
+
+/* Root raised cosine pulse at time t (in symbol periods) with roll-off beta. Used for table generation only */
+float Dsp_RootRaisedCosine(float t, float beta);
+
+#endif /* DSP_H_ */
+
@@ -0,0 +1,198 @@
+#include "dtmf.h"
+#include "stm32f3xx_hal.h"
+#include "settings.h"
+#include <math.h>
+
+#define DTMF_TONES      8
+
+static const uint16_t dtmfFrequencies[DTMF_TONES] = {
+    697, 770, 852, 941,         /* Low group (rows) */
+    1209, 1336, 1477, 1633      /* High group (columns) */
+};
+
+static const char dtmfDigits[4][4] = {
+    { '1', '2', '3', 'A' },
+    { '4', '5', '6', 'B' },
+    { '7', '8', '9', 'C' },
+    { '*', '0', '#', 'D' }
+};
+
+static bool dtmfEnabled = false;
+
+/* Goertzel filter bank */
+static float coefficients[DTMF_TONES];
+static float state1[DTMF_TONES];
+static float state2[DTMF_TONES];
+static float windowEnergy;
+static uint16_t windowLength = 0;
+static uint16_t windowPos = 0;
+
+/* Debouncing */
+static char candidateDigit = 0;
+static uint8_t candidateCount = 0;
+static char activeDigit = 0;
+static uint32_t activeTick = 0;
+static uint32_t lastDuration = 0;
+
+static dtmf_event_t lastEvent;
+
+static void InfoUpdate(void)
+{
+    settingsRegMap[SETTINGS_REG_INFO_DTMF0] =
+            (((uint32_t) lastEvent.digit << SETTINGS_REG_INFO_DTMF0_DIGIT_OFFS) & SETTINGS_REG_INFO_DTMF0_DIGIT_MASK) |
+            (((uint32_t) lastEvent.count << SETTINGS_REG_INFO_DTMF0_COUNT_OFFS) & SETTINGS_REG_INFO_DTMF0_COUNT_MASK) |
+            (((lastDuration > 0xFFFF ? 0xFFFF : lastDuration) << SETTINGS_REG_INFO_DTMF0_DURATION_OFFS) & SETTINGS_REG_INFO_DTMF0_DURATION_MASK);
+}
+
+static uint8_t MaxIndex(const float * power, uint8_t count)
+{
+    uint8_t index = 0;
+
+    for (uint8_t i = 1; i < count; i++) {
+        if (power[i] > power[index]) {
+            index = i;
+        }
+    }
+
+    return index;
+}
+
+static char Evaluate(void)
+{
+    /* Returns the digit present in the current window or 0 */
+    float power[DTMF_TONES];
+
+    for (uint8_t i = 0; i < DTMF_TONES; i++) {
+        power[i] = state1[i] * state1[i] + state2[i] * state2[i] - coefficients[i] * state1[i] * state2[i];
+    }
+
+    uint8_t row = MaxIndex(&power[0], 4);
+    uint8_t col = MaxIndex(&power[4], 4) + 4;
+    float rowPower = power[row];
+    float colPower = power[col];
+
+    /* A sine of amplitude A yields a Goertzel power of (A * N / 2)^2 */
+    float minPower = (float) SETTINGS_GET(SETTINGS_REG_DTMF_CTRL, LEVEL) * windowLength / 2;
+    minPower *= minPower;
+
+    if ((rowPower < minPower) || (colPower < minPower)) {
+        return 0;
+    }
+
+    if ((colPower > rowPower * DTMF_TWIST_HIGH) || (rowPower > colPower * DTMF_TWIST_LOW)) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < DTMF_TONES; i++) {
+        float peakPower = (i < 4) ? rowPower : colPower;
+
+        if ((i != row) && (i != col) && (power[i] * DTMF_PEAK_RATIO > peakPower)) {
+            return 0;
+        }
+    }
+
+    /* Same scale as the window energy: a sine of power P yields P * 2 / N */
+    if ((rowPower + colPower) * 2 / windowLength < windowEnergy * DTMF_ENERGY_RATIO) {
+        return 0;
+    }
+
+    return dtmfDigits[row][col - 4];
+}
+
+static void Debounce(char digit)
+{
+    if (digit == candidateDigit) {
+        if (candidateCount < DTMF_CONFIRM) {
+            candidateCount++;
+        }
+    } else {
+        candidateDigit = digit;
+        candidateCount = 1;
+    }
+
+    if ((candidateCount < DTMF_CONFIRM) || (candidateDigit == activeDigit)) {
+        return;
+    }
+
+    uint32_t nowTick = HAL_GetTick();
+
+    if (activeDigit != 0) {
+        lastDuration = nowTick - activeTick;
+    }
+
+    activeDigit = candidateDigit;
+    activeTick = nowTick;
+
+    if (activeDigit != 0) {
+        lastEvent.digit = activeDigit;
+        lastEvent.tick = nowTick;
+        lastEvent.count++;
+    }
+
+    InfoUpdate();
+}
+
+void Dtmf_Init(void)
+{
+    /* The capture path is set up once, so this is latched until next reboot */
+    dtmfEnabled = SETTINGS_GET(SETTINGS_REG_DTMF_CTRL, ENABLE) != 0;
+
+    lastEvent = (dtmf_event_t) { 0 };
+    InfoUpdate();
+}
+
+void Dtmf_Configure(uint32_t sampleRate)
+{
+    const float pi = 3.14159265f;
+
+    for (uint8_t i = 0; i < DTMF_TONES; i++) {
+        coefficients[i] = 2.0f * cosf(2.0f * pi * dtmfFrequencies[i] / sampleRate);
+        state1[i] = 0;
+        state2[i] = 0;
+    }
+
+    windowEnergy = 0;
+    windowLength = sampleRate * DTMF_WINDOW_MS / 1000;
+    windowPos = 0;
+}
+
+void Dtmf_Process(const int16_t * samples, uint16_t count)
+{
+    if (windowLength == 0) {
+        return;
+    }
+
+    for (uint16_t n = 0; n < count; n++) {
+        float x = samples[n];
+
+        windowEnergy += x * x;
+
+        for (uint8_t i = 0; i < DTMF_TONES; i++) {
+            float s = x + coefficients[i] * state1[i] - state2[i];
+            state2[i] = state1[i];
+            state1[i] = s;
+        }
+
+        if (++windowPos >= windowLength) {
+            Debounce(Evaluate());
+
+            for (uint8_t i = 0; i < DTMF_TONES; i++) {
+                state1[i] = 0;
+                state2[i] = 0;
+            }
+
+            windowEnergy = 0;
+            windowPos = 0;
+        }
+    }
+}
+
+bool Dtmf_Enabled(void)
+{
+    return dtmfEnabled;
+}
+
+void Dtmf_LastEvent(dtmf_event_t * event)
+{
+    *event = lastEvent;
+}
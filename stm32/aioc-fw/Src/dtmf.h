@@ -0,0 +1,30 @@
+#ifndef DTMF_H_
+#define DTMF_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* DTMF decoder. Goertzel filter bank on the 8 DTMF frequencies, evaluated once per window.
+ * A window is accepted as a digit when both groups have a dominant tone above the minimum level,
+ * the twist is within limits and the two tones carry most of the window energy.
+ * A digit is reported once it was seen in DTMF_CONFIRM consecutive windows. */
+#define DTMF_WINDOW_MS          20
+#define DTMF_CONFIRM            2
+#define DTMF_TWIST_HIGH         6.31f /* High group may exceed the low group by up to 8 dB (pre-emphasis) */
+#define DTMF_TWIST_LOW          2.51f /* Low group may exceed the high group by up to 4 dB */
+#define DTMF_PEAK_RATIO         6.31f /* Other tones of a group must be at least 8 dB below the dominant one */
+#define DTMF_ENERGY_RATIO       0.4f  /* Minimum share of the window energy in the two tones */
+
+typedef struct {
+    uint32_t tick;      /* Millisecond tick at which the digit was recognized */
+    uint8_t count;      /* Incremented for every digit */
+    char digit;         /* '0'..'9', '*', '#', 'A'..'D' or 0 if none so far */
+} dtmf_event_t;
+
+void Dtmf_Init(void);
+void Dtmf_Configure(uint32_t sampleRate);
+void Dtmf_Process(const int16_t * samples, uint16_t count);
+bool Dtmf_Enabled(void);
+void Dtmf_LastEvent(dtmf_event_t * event);
+
+#endif /* DTMF_H_ */
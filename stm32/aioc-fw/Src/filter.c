@@ -0,0 +1,252 @@
+#include "filter.h"
+#include "stm32f3xx_hal.h"
+#include "settings.h"
+#include "usb_audio.h"
+#include <math.h>
+#include <string.h>
+
+#define FILTER_EMPHASIS_LOW     300.0f  /* Corner frequencies of the emphasis presets in Hz */
+#define FILTER_EMPHASIS_HIGH    3000.0f
+#define FILTER_EMPHASIS_REF     1000.0f /* Frequency at which the emphasis presets have unity gain */
+#define FILTER_CTCSS_CUTOFF     300.0f
+#define FILTER_INFO_INTERVAL    1000    /* Update interval of the cycle statistics in ms */
+
+typedef struct {
+    int32_t b0, b1, b2, a1, a2; /* Q3.28, with a1 and a2 negated, so that all terms are accumulated */
+    int32_t x1, x2, y1, y2;     /* Q31 */
+} filter_section_t;
+
+typedef struct {
+    filter_section_t section[FILTER_SECTIONS];
+    volatile uint8_t sectionCount;
+    uint32_t cyclesAvg; /* 28.4 format */
+    uint32_t cyclesMax;
+
+    /* Configuration the sections were computed from */
+    uint32_t configRate;
+    uint32_t configRegs[1 + 5 * FILTER_SECTIONS];
+} filter_t;
+
+static filter_t filters[FILTER_PATH_COUNT];
+static uint32_t infoTick;
+
+static uint32_t Saturate16(uint32_t value)
+{
+    return (value > 0xFFFF) ? 0xFFFF : value;
+}
+
+static void InfoUpdate(void)
+{
+    settingsRegMap[SETTINGS_REG_INFO_FILTER0] =
+            ((Saturate16(filters[FILTER_PATH_RX].cyclesAvg >> 4) << SETTINGS_REG_INFO_FILTER0_RXCYCLES_OFFS) & SETTINGS_REG_INFO_FILTER0_RXCYCLES_MASK) |
+            ((Saturate16(filters[FILTER_PATH_TX].cyclesAvg >> 4) << SETTINGS_REG_INFO_FILTER0_TXCYCLES_OFFS) & SETTINGS_REG_INFO_FILTER0_TXCYCLES_MASK);
+    settingsRegMap[SETTINGS_REG_INFO_FILTER1] =
+            ((Saturate16(filters[FILTER_PATH_RX].cyclesMax) << SETTINGS_REG_INFO_FILTER1_RXCYCLESMAX_OFFS) & SETTINGS_REG_INFO_FILTER1_RXCYCLESMAX_MASK) |
+            ((Saturate16(filters[FILTER_PATH_TX].cyclesMax) << SETTINGS_REG_INFO_FILTER1_TXCYCLESMAX_OFFS) & SETTINGS_REG_INFO_FILTER1_TXCYCLESMAX_MASK);
+}
+
+static int32_t Coefficient(float value)
+{
+    return (int32_t) lroundf(value * (1UL << FILTER_COEF_SHIFT));
+}
+
+static void SectionInit(filter_section_t * section, float b0, float b1, float b2, float a1, float a2)
+{
+    *section = (filter_section_t) {
+        .b0 = Coefficient(b0),
+        .b1 = Coefficient(b1),
+        .b2 = Coefficient(b2),
+        .a1 = -Coefficient(a1),
+        .a2 = -Coefficient(a2)
+    };
+}
+
+static void EmphasisInit(filter_section_t * section, uint32_t sampleRate, float zero, float pole)
+{
+    /* Bilinear transform of H(s) = (1 + s/wz) / (1 + s/wp) with pre-warped corners */
+    const float pi = 3.14159265f;
+    float k = 2.0f * sampleRate;
+    float wz = k * tanf(pi * zero / sampleRate);
+    float wp = k * tanf(pi * pole / sampleRate);
+    float b0 = (wp / wz) * (k + wz) / (k + wp);
+    float b1 = (wp / wz) * (wz - k) / (k + wp);
+    float a1 = (wp - k) / (k + wp);
+
+    /* Unity gain at the reference frequency */
+    float cosw = cosf(2.0f * pi * FILTER_EMPHASIS_REF / sampleRate);
+    float gain = sqrtf(b0 * b0 + b1 * b1 + 2.0f * b0 * b1 * cosw) / sqrtf(1.0f + a1 * a1 + 2.0f * a1 * cosw);
+
+    SectionInit(section, b0 / gain, b1 / gain, 0.0f, a1, 0.0f);
+}
+
+static void HighpassInit(filter_section_t * section, uint32_t sampleRate, float cutoff, float q)
+{
+    /* Bilinear transform of a 2nd order high pass section */
+    const float pi = 3.14159265f;
+    float w0 = 2.0f * pi * cutoff / sampleRate;
+    float cosw0 = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * q);
+    float a0 = 1.0f + alpha;
+
+    SectionInit(section, (1.0f + cosw0) / 2.0f / a0, -(1.0f + cosw0) / a0, (1.0f + cosw0) / 2.0f / a0,
+            -2.0f * cosw0 / a0, (1.0f - alpha) / a0);
+}
+
+static void Configure(filter_path_t path, uint32_t sampleRate, const uint32_t * regs)
+{
+    filter_section_t section[FILTER_SECTIONS];
+    uint8_t sectionCount = 0;
+    uint32_t ctrl = regs[0];
+    const uint32_t * coefficients = &regs[1];
+
+    /* Both control registers share the same layout */
+    uint32_t preset = (ctrl & SETTINGS_REG_RXFILT_CTRL_PRESET_MASK) >> SETTINGS_REG_RXFILT_CTRL_PRESET_OFFS;
+    uint32_t sections = (ctrl & SETTINGS_REG_RXFILT_CTRL_SECTIONS_MASK) >> SETTINGS_REG_RXFILT_CTRL_SECTIONS_OFFS;
+
+    if (sampleRate == 0) {
+        preset = SETTINGS_REG_RXFILT_CTRL_PRESET_OFF_ENUM;
+    }
+
+    switch (preset) {
+    case SETTINGS_REG_RXFILT_CTRL_PRESET_CUSTOM_ENUM:
+        sectionCount = (sections < FILTER_SECTIONS) ? sections : FILTER_SECTIONS;
+
+        for (uint8_t i = 0; i < sectionCount; i++) {
+            section[i] = (filter_section_t) {
+                .b0 = (int32_t) coefficients[5 * i + 0],
+                .b1 = (int32_t) coefficients[5 * i + 1],
+                .b2 = (int32_t) coefficients[5 * i + 2],
+                .a1 = -(int32_t) coefficients[5 * i + 3],
+                .a2 = -(int32_t) coefficients[5 * i + 4]
+            };
+        }
+        break;
+
+    case SETTINGS_REG_RXFILT_CTRL_PRESET_DEEMPH_ENUM:
+        EmphasisInit(&section[0], sampleRate, FILTER_EMPHASIS_HIGH, FILTER_EMPHASIS_LOW);
+        sectionCount = 1;
+        break;
+
+    case SETTINGS_REG_RXFILT_CTRL_PRESET_PREEMPH_ENUM:
+        EmphasisInit(&section[0], sampleRate, FILTER_EMPHASIS_LOW, FILTER_EMPHASIS_HIGH);
+        sectionCount = 1;
+        break;
+
+    case SETTINGS_REG_RXFILT_CTRL_PRESET_CTCSSREJECT_ENUM:
+        /* 6th order Butterworth, sections ordered by ascending Q to keep the intermediate gain low */
+        HighpassInit(&section[0], sampleRate, FILTER_CTCSS_CUTOFF, 0.5176f);
+        HighpassInit(&section[1], sampleRate, FILTER_CTCSS_CUTOFF, 0.7071f);
+        HighpassInit(&section[2], sampleRate, FILTER_CTCSS_CUTOFF, 1.9319f);
+        sectionCount = 3;
+        break;
+
+    default:
+        break;
+    }
+
+    /* Swap in the new sections with cleared states at once */
+    __disable_irq();
+    memcpy(filters[path].section, section, sectionCount * sizeof(filter_section_t));
+    filters[path].sectionCount = sectionCount;
+    filters[path].cyclesAvg = 0;
+    filters[path].cyclesMax = 0;
+    USB_AudioFilterRestart(path);
+    __enable_irq();
+}
+
+void Filter_Init(void)
+{
+    infoTick = HAL_GetTick();
+    InfoUpdate();
+}
+
+void Filter_Task(void)
+{
+    static const struct {
+        uint8_t ctrl;
+        uint8_t coefficients;
+    } filterRegs[FILTER_PATH_COUNT] = {
+        [FILTER_PATH_RX] = { SETTINGS_REG_RXFILT_CTRL, SETTINGS_REG_RXFILT_COEF0 },
+        [FILTER_PATH_TX] = { SETTINGS_REG_TXFILT_CTRL, SETTINGS_REG_TXFILT_COEF0 }
+    };
+    bool changed = false;
+
+    for (uint8_t path = 0; path < FILTER_PATH_COUNT; path++) {
+        /* Follow the sample rate and the settings, which may be changed by the host at any time */
+        uint32_t sampleRate = (path == FILTER_PATH_RX) ? USB_AudioRxSampleRate() : USB_AudioTxSampleRate();
+        uint32_t regs[1 + 5 * FILTER_SECTIONS];
+
+        regs[0] = settingsRegMap[filterRegs[path].ctrl];
+        memcpy(&regs[1], &settingsRegMap[filterRegs[path].coefficients], 5 * FILTER_SECTIONS * sizeof(uint32_t));
+
+        if ((sampleRate != filters[path].configRate) || (memcmp(regs, filters[path].configRegs, sizeof(regs)) != 0)) {
+            Configure(path, sampleRate, regs);
+            filters[path].configRate = sampleRate;
+            memcpy(filters[path].configRegs, regs, sizeof(regs));
+            changed = true;
+        }
+    }
+
+    uint32_t now = HAL_GetTick();
+
+    if (changed || (now - infoTick >= FILTER_INFO_INTERVAL)) {
+        infoTick = now;
+        InfoUpdate();
+    }
+}
+
+bool Filter_Enabled(filter_path_t path)
+{
+    return filters[path].sectionCount != 0;
+}
+
+void Filter_Process(filter_path_t path, int16_t * samples)
+{
+    filter_t * filter = &filters[path];
+    uint32_t startCycles = DWT->CYCCNT;
+    int32_t work[FILTER_BLOCK_LEN];
+
+    for (uint8_t n = 0; n < FILTER_BLOCK_LEN; n++) {
+        work[n] = (int32_t) samples[n] << 16;
+    }
+
+    for (uint8_t i = 0; i < filter->sectionCount; i++) {
+        filter_section_t * section = &filter->section[i];
+        int32_t b0 = section->b0, b1 = section->b1, b2 = section->b2, a1 = section->a1, a2 = section->a2;
+        int32_t x1 = section->x1, x2 = section->x2, y1 = section->y1, y2 = section->y2;
+
+        for (uint8_t n = 0; n < FILTER_BLOCK_LEN; n++) {
+            int32_t x = work[n];
+
+            /* One SMULL and four SMLAL */
+            int64_t acc = (int64_t) b0 * x;
+            acc += (int64_t) b1 * x1;
+            acc += (int64_t) b2 * x2;
+            acc += (int64_t) a1 * y1;
+            acc += (int64_t) a2 * y2;
+            acc >>= FILTER_COEF_SHIFT;
+
+            int32_t y = (acc > INT32_MAX) ? INT32_MAX : (acc < INT32_MIN) ? INT32_MIN : (int32_t) acc;
+
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            work[n] = y;
+        }
+
+        section->x1 = x1;
+        section->x2 = x2;
+        section->y1 = y1;
+        section->y2 = y2;
+    }
+
+    for (uint8_t n = 0; n < FILTER_BLOCK_LEN; n++) {
+        samples[n] = (int16_t) (work[n] >> 16);
+    }
+
+    uint32_t cycles = DWT->CYCCNT - startCycles;
+
+    filter->cyclesAvg = filter->cyclesAvg - (filter->cyclesAvg >> 4) + cycles;
+    if (cycles > filter->cyclesMax) filter->cyclesMax = cycles;
+}
@@ -0,0 +1,27 @@
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Cascaded biquad filters on the capture and playback paths. The sections run in direct form I with Q3.28 coefficients
+ * and Q31 states, accumulating in 64 bit (SMULL/SMLAL). The audio interrupts collect blocks of FILTER_BLOCK_LEN samples,
+ * so that each section keeps its coefficients and states in registers for a whole block. This adds one block of latency. */
+#define FILTER_SECTIONS         3  /* Must match the number of coefficient registers (five per section) */
+#define FILTER_BLOCK_LEN        16
+#define FILTER_COEF_SHIFT       28 /* Q3.28 */
+
+typedef enum {
+    FILTER_PATH_RX = 0,
+    FILTER_PATH_TX,
+    FILTER_PATH_COUNT
+} filter_path_t;
+
+void Filter_Init(void);
+void Filter_Task(void);
+bool Filter_Enabled(filter_path_t path);
+
+/* Called from interrupt context with a block of FILTER_BLOCK_LEN samples, which are filtered in place */
+void Filter_Process(filter_path_t path, int16_t * samples);
+
+#endif /* FILTER_H_ */
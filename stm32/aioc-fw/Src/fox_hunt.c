@@ -104,7 +104,7 @@ void FoxHunt_Tick(void) {
 		(isIdentifying == 0)) {
 
 		secondsPassed = 0;
-		IO_PTTAssert(IO_PTT_MASK_PTT1);
+		IO_PTTSourceAssert(IO_PTT_SOURCE_FOXHUNT, IO_PTT_MASK_PTT1);
 
 		isIdentifying = 1;
 		timingsIndex = 0;
@@ -139,7 +139,7 @@ void TIM15_IRQHandler(void)
                 if (timingsIndex == timingsLength) {
                     /* All done IDing */
                     isIdentifying = 0;
-                    IO_PTTDeassert(IO_PTT_MASK_PTT1);
+                    IO_PTTSourceRelease(IO_PTT_SOURCE_FOXHUNT, IO_PTT_MASK_PTT1);
                 } else {
                     /* Move on to the next timing */
                     remainingCycles = timingsLUT[timingsIndex] * ((uint32_t) (MORSE_UNIT_LENGTH * FOXHUNT_SAMPLERATE) / SETTINGS_GET(SETTINGS_REG_FOXHUNT_CTRL, WPM));
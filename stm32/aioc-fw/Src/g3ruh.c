@@ -0,0 +1,201 @@
+#include "g3ruh.h"
+#include "modem.h"
+#include "dsp.h"
+
+/* Feedback taps of the (de-)scrambler polynomial 1 + x^12 + x^17, with the previous line bit in bit 0 */
+#define SCRAMBLER_TAPS(s)       ((((s) >> 11) ^ ((s) >> 16)) & 0x01)
+
+/* Matched filter, DC tracking slicer and a digital PLL for the bit clock */
+typedef struct {
+    int16_t coefficients[G3RUH_RX_FILTER_MAXLEN];
+    int16_t history[G3RUH_RX_FILTER_MAXLEN];
+    uint8_t length;
+    uint8_t pos;
+    int32_t dcAccu;
+    uint32_t pllStep;
+    int32_t pll;
+    uint8_t level;
+    uint32_t scrambler;
+} g3ruh_rx_t;
+
+static g3ruh_rx_t rx;
+
+/* Pulse shaping generator. The line bits are delayed by half the pulse span */
+typedef struct {
+    uint32_t baudStep;
+    uint32_t baudPhase;
+    uint32_t symbols;   /* Line bits, most recent in bit 0 */
+    uint32_t scrambler;
+    uint16_t level;
+    uint8_t nrzi;
+} g3ruh_tx_t;
+
+static g3ruh_tx_t tx;
+static int16_t txPulse[G3RUH_TX_SPAN * G3RUH_TX_PHASES];
+static bool txPulseValid = false;
+
+bool G3ruh_RxInit(uint32_t sampleRate)
+{
+    /* Returns false, if the sample rate is too low for this modem */
+    if (sampleRate < G3RUH_RX_MINRATE) {
+        return false;
+    }
+
+    rx = (g3ruh_rx_t) {
+        .length = (G3RUH_TX_SPAN * sampleRate / G3RUH_BAUD) | 0x01, /* Odd, so that there is a center tap */
+        .pllStep = Dsp_PhaseStep(G3RUH_BAUD, sampleRate)
+    };
+
+    if (rx.length > G3RUH_RX_FILTER_MAXLEN) {
+        rx.length = G3RUH_RX_FILTER_MAXLEN;
+    }
+
+    /* Root raised cosine, normalized to a DC gain of 0.5 to leave headroom in the accumulator */
+    float taps[G3RUH_RX_FILTER_MAXLEN];
+    float sum = 0.0f;
+
+    for (uint8_t i = 0; i < rx.length; i++) {
+        float t = ((float) i - (rx.length - 1) / 2) * G3RUH_BAUD / sampleRate;
+        taps[i] = Dsp_RootRaisedCosine(t, G3RUH_ROLLOFF);
+        sum += taps[i];
+    }
+
+    for (uint8_t i = 0; i < rx.length; i++) {
+        rx.coefficients[i] = (int16_t) (taps[i] / sum * 16384.0f + 0.5f);
+    }
+
+    return true;
+}
+
+void G3ruh_RxProcess(const int16_t * samples, uint16_t count)
+{
+    while (count--) {
+        rx.history[rx.pos] = *samples++;
+        rx.pos = (rx.pos + 1 < rx.length) ? rx.pos + 1 : 0;
+
+        /* Matched filter, the filter is symmetric so the order of the history does not matter */
+        int32_t filtered = 0;
+        uint8_t tap = rx.pos;
+
+        for (uint8_t i = 0; i < rx.length; i++) {
+            filtered += (int32_t) rx.coefficients[i] * rx.history[tap];
+            tap = (tap + 1 < rx.length) ? tap + 1 : 0;
+        }
+
+        filtered >>= 15;
+
+        /* The scrambled signal has no DC, remove the offset of the receiver discriminator */
+        rx.dcAccu += filtered - (rx.dcAccu >> 10);
+        uint8_t level = filtered > (rx.dcAccu >> 10);
+
+        /* The bit is sampled when the PLL wraps around, i.e. half a bit period after the (expected) transition */
+        int32_t pllPrevious = rx.pll;
+        rx.pll = (int32_t) ((uint32_t) rx.pll + rx.pllStep);
+
+        if ((pllPrevious > 0) && (rx.pll < 0)) {
+            uint8_t descrambled = level ^ SCRAMBLER_TAPS(rx.scrambler);
+
+            rx.scrambler = (rx.scrambler << 1) | level;
+            Modem_RxLevel(descrambled);
+        }
+
+        if (level != rx.level) {
+            /* Pull the clock phase towards the transition. With only a few samples per bit, a transition is detected
+             * half a sample late on average and the bit is sampled half a sample late as well, so aim one sample ahead */
+            int32_t error = (int32_t) ((uint32_t) rx.pll - rx.pllStep);
+
+            rx.pll = (int32_t) (rx.pllStep + (uint32_t) (((int64_t) error * G3RUH_RX_PLL_INERTIA) >> 2));
+            rx.level = level;
+        }
+    }
+}
+
+static void TxPulseInit(void)
+{
+    /* Entry [j * PHASES + p] is the contribution of the line bit j bit periods ago, at phase p of the current bit period */
+    float pulse[G3RUH_TX_SPAN * G3RUH_TX_PHASES];
+    float peak = 0.0f;
+
+    for (uint16_t i = 0; i < G3RUH_TX_SPAN * G3RUH_TX_PHASES; i++) {
+        float t = (float) i / G3RUH_TX_PHASES - G3RUH_TX_SPAN / 2;
+        pulse[i] = Dsp_RootRaisedCosine(t, G3RUH_ROLLOFF);
+    }
+
+    /* Normalize to the worst case sum of all overlapping pulses */
+    for (uint8_t p = 0; p < G3RUH_TX_PHASES; p++) {
+        float sum = 0.0f;
+
+        for (uint8_t j = 0; j < G3RUH_TX_SPAN; j++) {
+            float value = pulse[j * G3RUH_TX_PHASES + p];
+            sum += (value < 0.0f) ? -value : value;
+        }
+
+        if (sum > peak) peak = sum;
+    }
+
+    for (uint16_t i = 0; i < G3RUH_TX_SPAN * G3RUH_TX_PHASES; i++) {
+        txPulse[i] = (int16_t) (pulse[i] / peak * 32767.0f);
+    }
+
+    txPulseValid = true;
+}
+
+bool G3ruh_TxInit(uint32_t sampleRate, uint16_t level)
+{
+    /* Returns false, if the sample rate is too low for this modem */
+    if (sampleRate < G3RUH_TX_MINRATE) {
+        return false;
+    }
+
+    uint32_t baudStep = Dsp_PhaseStep(G3RUH_BAUD, sampleRate);
+
+    if (!txPulseValid) {
+        TxPulseInit();
+    }
+
+    tx = (g3ruh_tx_t) {
+        .baudStep = baudStep,
+        .baudPhase = -baudStep, /* Fetch the first bit with the first sample */
+        .level = level
+    };
+
+    return true;
+}
+
+bool G3ruh_TxSample(int16_t * sample)
+{
+    /* Called at audio interrupt priority. Returns false after the last bit */
+    uint32_t baudPrevious = tx.baudPhase;
+
+    tx.baudPhase += tx.baudStep;
+
+    if (tx.baudPhase < baudPrevious) {
+        int8_t bit = Modem_TxBit();
+
+        if (bit < 0) {
+            *sample = 0;
+            return false;
+        }
+
+        /* NRZI (a zero is a change in level), then scramble */
+        if (bit == 0) {
+            tx.nrzi ^= 0x01;
+        }
+
+        uint8_t line = tx.nrzi ^ SCRAMBLER_TAPS(tx.scrambler);
+
+        tx.scrambler = (tx.scrambler << 1) | line;
+        tx.symbols = (tx.symbols << 1) | line;
+    }
+
+    const int16_t * pulse = &txPulse[tx.baudPhase >> (32 - G3RUH_TX_PHASE_BITS)];
+    int32_t accu = 0;
+
+    for (uint8_t j = 0; j < G3RUH_TX_SPAN; j++) {
+        accu += (tx.symbols & (1UL << j)) ? pulse[j * G3RUH_TX_PHASES] : -pulse[j * G3RUH_TX_PHASES];
+    }
+
+    *sample = (accu * tx.level) >> 16;
+
+    return true;
+}
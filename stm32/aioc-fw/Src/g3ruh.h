@@ -0,0 +1,23 @@
+#ifndef G3RUH_H_
+#define G3RUH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* G3RUH 9600 baud FSK: Scrambled (1 + x^12 + x^17) NRZI baseband, root raised cosine shaped on both ends */
+#define G3RUH_BAUD              9600
+#define G3RUH_ROLLOFF           0.5f
+#define G3RUH_RX_MINRATE        38400 /* At least four samples per bit for the clock recovery */
+#define G3RUH_RX_FILTER_MAXLEN  21    /* Matched filter length in samples (four bit periods at 48 kHz) */
+#define G3RUH_RX_PLL_INERTIA    3     /* On a transition, the bit clock phase error is multiplied by INERTIA/4 */
+#define G3RUH_TX_MINRATE        19200 /* At least two samples per bit, so the shaped pulse does not alias */
+#define G3RUH_TX_SPAN           4     /* Pulse length in bit periods */
+#define G3RUH_TX_PHASE_BITS     4     /* Pulse table resolution per bit period (log2) */
+#define G3RUH_TX_PHASES         (1 << G3RUH_TX_PHASE_BITS)
+
+bool G3ruh_RxInit(uint32_t sampleRate);
+void G3ruh_RxProcess(const int16_t * samples, uint16_t count);
+bool G3ruh_TxInit(uint32_t sampleRate, uint16_t level);
+bool G3ruh_TxSample(int16_t * sample);
+
+#endif /* G3RUH_H_ */
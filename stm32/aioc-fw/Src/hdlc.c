@@ -0,0 +1,173 @@
+#include "hdlc.h"
+
+uint16_t Hdlc_Crc(const uint8_t * data, uint16_t length)
+{
+    /* CRC-16/X.25, bitwise (reflected polynomial 0x1021) */
+    uint16_t crc = 0xFFFF;
+
+    while (length--) {
+        crc ^= *data++;
+
+        for (uint8_t i=0; i<8; i++) {
+            crc = (crc & 0x0001) ? (crc >> 1) ^ 0x8408 : (crc >> 1);
+        }
+    }
+
+    return crc;
+}
+
+void Hdlc_RxInit(hdlc_rx_t * rx, uint8_t * buffer)
+{
+    *rx = (hdlc_rx_t) {
+        .frame = buffer,
+        .active = false
+    };
+}
+
+hdlc_rx_result_t Hdlc_RxLevel(hdlc_rx_t * rx, uint8_t level)
+{
+    /* NRZI: No change in level is a one, a change is a zero */
+    uint8_t bit = (level == rx->lastLevel) ? 1 : 0;
+    hdlc_rx_result_t result = HDLC_RX_NONE;
+
+    rx->lastLevel = level;
+
+    if (bit) {
+        if (++rx->ones >= 7) {
+            /* Abort sequence or idle line, wait for the next flag */
+            rx->active = false;
+            return HDLC_RX_NONE;
+        }
+    } else {
+        if (rx->ones == 6) {
+            /* Flag. Its first seven bits are in the shift register already,
+             * which means that the frame ended on a byte boundary if seven bits are pending */
+            if (rx->active && (rx->bitCount == 7) && (rx->length >= HDLC_FRAME_MINLEN)) {
+                if (Hdlc_Crc(rx->frame, rx->length) == HDLC_FCS_GOOD) {
+                    rx->frameLength = rx->length - HDLC_FCS_LEN;
+                    result = HDLC_RX_FRAME;
+                } else {
+                    result = HDLC_RX_FCSERR;
+                }
+            }
+
+            /* A flag also opens the next frame */
+            rx->active = true;
+            rx->ones = 0;
+            rx->bitCount = 0;
+            rx->length = 0;
+
+            return result;
+        }
+
+        if (rx->ones == 5) {
+            /* Stuffed zero */
+            rx->ones = 0;
+            return HDLC_RX_NONE;
+        }
+
+        rx->ones = 0;
+    }
+
+    /* Bits are sent LSB first */
+    rx->shift = (rx->shift >> 1) | (bit << 7);
+
+    if (++rx->bitCount == 8) {
+        rx->bitCount = 0;
+
+        if (rx->active) {
+            if (rx->length < HDLC_FRAME_MAXLEN) {
+                rx->frame[rx->length++] = rx->shift;
+            } else {
+                /* Too long for a valid frame */
+                rx->active = false;
+            }
+        }
+    }
+
+    return HDLC_RX_NONE;
+}
+
+void Hdlc_TxInit(hdlc_tx_t * tx, const uint8_t * frame, uint16_t length, uint16_t preambleFlags, uint16_t tailFlags)
+{
+    /* The FCS is the complemented CRC, sent low byte first */
+    *tx = (hdlc_tx_t) {
+        .frame = frame,
+        .length = length,
+        .fcs = ~Hdlc_Crc(frame, length),
+        .flags = preambleFlags,
+        .tailFlags = (tailFlags > 0) ? tailFlags : 1, /* At least the closing flag */
+        .state = HDLC_TX_PREAMBLE
+    };
+}
+
+static bool TxLoad(hdlc_tx_t * tx)
+{
+    switch (tx->state) {
+    case HDLC_TX_PREAMBLE:
+        if (tx->flags > 0) {
+            tx->flags--;
+            tx->shift = HDLC_FLAG;
+            break;
+        }
+
+        tx->state = HDLC_TX_DATA;
+        tx->ones = 0;
+        /* fall through */
+
+    case HDLC_TX_DATA:
+        if (tx->position < tx->length) {
+            tx->shift = tx->frame[tx->position++];
+            break;
+        } else if (tx->position < tx->length + HDLC_FCS_LEN) {
+            tx->shift = (tx->position++ == tx->length) ? (tx->fcs & 0xFF) : (tx->fcs >> 8);
+            break;
+        }
+
+        tx->state = HDLC_TX_TAIL;
+        tx->flags = tx->tailFlags;
+        /* fall through */
+
+    case HDLC_TX_TAIL:
+        if (tx->flags > 0) {
+            tx->flags--;
+            tx->shift = HDLC_FLAG;
+            break;
+        }
+
+        tx->state = HDLC_TX_DONE;
+        /* fall through */
+
+    default:
+        return false;
+    }
+
+    tx->bitCount = 8;
+    return true;
+}
+
+int8_t Hdlc_TxBit(hdlc_tx_t * tx)
+{
+    /* Returns the next bit (before NRZI encoding) or -1 after the last flag */
+    if ((tx->state == HDLC_TX_DATA) && (tx->ones == 5)) {
+        /* Stuffed zero */
+        tx->ones = 0;
+        return 0;
+    }
+
+    if ((tx->bitCount == 0) && !TxLoad(tx)) {
+        return -1;
+    }
+
+    /* Bits are sent LSB first */
+    uint8_t bit = tx->shift & 0x01;
+
+    tx->shift >>= 1;
+    tx->bitCount--;
+
+    if (tx->state == HDLC_TX_DATA) {
+        tx->ones = bit ? tx->ones + 1 : 0;
+    }
+
+    return bit;
+}
@@ -0,0 +1,57 @@
+#ifndef HDLC_H_
+#define HDLC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* AX.25 frames: up to 10 addresses, 2 control bytes, PID, 256 information bytes and FCS */
+#define HDLC_FRAME_MAXLEN   (10 * 7 + 2 + 1 + 256 + 2)
+#define HDLC_FRAME_MINLEN   (2 * 7 + 1 + 2)
+#define HDLC_FCS_LEN        2
+#define HDLC_FCS_GOOD       0xF0B8 /* CRC residue over a frame including a valid FCS */
+#define HDLC_FLAG           0x7E
+
+typedef enum {
+    HDLC_RX_NONE,
+    HDLC_RX_FRAME,      /* Frame with valid FCS in frame[0 ... frameLength-1], FCS stripped. Valid until the next call */
+    HDLC_RX_FCSERR      /* Frame of valid length, but FCS mismatch */
+} hdlc_rx_result_t;
+
+typedef struct {
+    uint8_t * frame;    /* HDLC_FRAME_MAXLEN bytes */
+    uint16_t length;
+    uint16_t frameLength;
+    uint8_t shift;
+    uint8_t bitCount;
+    uint8_t ones;
+    uint8_t lastLevel;
+    bool active;
+} hdlc_rx_t;
+
+typedef enum {
+    HDLC_TX_PREAMBLE,
+    HDLC_TX_DATA,
+    HDLC_TX_TAIL,
+    HDLC_TX_DONE
+} hdlc_tx_state_t;
+
+typedef struct {
+    const uint8_t * frame;
+    uint16_t length;
+    uint16_t position;
+    uint16_t fcs;
+    uint16_t flags;     /* Remaining flags of the current (preamble or tail) sequence */
+    uint16_t tailFlags;
+    uint8_t shift;
+    uint8_t bitCount;
+    uint8_t ones;
+    hdlc_tx_state_t state;
+} hdlc_tx_t;
+
+void Hdlc_RxInit(hdlc_rx_t * rx, uint8_t * buffer);
+hdlc_rx_result_t Hdlc_RxLevel(hdlc_rx_t * rx, uint8_t level);
+void Hdlc_TxInit(hdlc_tx_t * tx, const uint8_t * frame, uint16_t length, uint16_t preambleFlags, uint16_t tailFlags);
+int8_t Hdlc_TxBit(hdlc_tx_t * tx);
+uint16_t Hdlc_Crc(const uint8_t * data, uint16_t length);
+
+#endif /* HDLC_H_ */
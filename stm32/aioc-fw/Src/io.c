@@ -2,6 +2,119 @@
 #include "usb_hid.h"
 #include "usb_serial.h"
 #include "settings.h"
+#include "subtone.h"
+
+static uint8_t PTTOutputs(void)
+{
+    /* Output data register, as the input data register lags behind a write for some cycles */
+    uint32_t outputReg = IO_OUT_GPIO->ODR;
+
+    return (outputReg & IO_OUT_PIN_1 ? IO_PTT_MASK_PTT1 : 0) |
+           (outputReg & IO_OUT_PIN_2 ? IO_PTT_MASK_PTT2 : 0);
+}
+
+/* Sources whose release is followed by the tail of the sub-audible tone encoder */
+#define IO_PTT_SOURCES_TAIL     ((1U << IO_PTT_SOURCE_VPTT) | (1U << IO_PTT_SOURCE_MODEM) | (1U << IO_PTT_SOURCE_FOXHUNT))
+
+static uint8_t pttSourceMask[IO_PTT_SOURCE_COUNT];
+
+/* Called with interrupts disabled */
+static void PTTAssert(uint8_t pttMask)
+{
+    Subtone_CancelRelease(pttMask);
+
+    if (pttMask & IO_PTT_MASK_PTT1) {
+        IO_OUT_GPIO->BSRR = IO_OUT_PIN_1;
+        LED_SET(1, 1);
+
+        /* Update debug register */
+        settingsRegMap[SETTINGS_REG_INFO_AUDIO0] |= SETTINGS_REG_INFO_AIOC0_PTT1STATE_MASK;
+    }
+
+    if (pttMask & IO_PTT_MASK_PTT2) {
+        IO_OUT_GPIO->BSRR = IO_OUT_PIN_2;
+        LED_SET(0, 1);
+
+        /* Update debug register */
+        settingsRegMap[SETTINGS_REG_INFO_AUDIO0] |= SETTINGS_REG_INFO_AIOC0_PTT2STATE_MASK;
+    }
+
+    USB_SerialPTTChanged(PTTOutputs());
+}
+
+/* Called with interrupts disabled */
+static void PTTDeassert(uint8_t pttMask)
+{
+    if (pttMask & IO_PTT_MASK_PTT1) {
+        IO_OUT_GPIO->BRR = IO_OUT_PIN_1;
+        LED_SET(1, 0);
+
+        /* Update debug register */
+        settingsRegMap[SETTINGS_REG_INFO_AUDIO0] &= ~SETTINGS_REG_INFO_AIOC0_PTT1STATE_MASK;
+    }
+
+    if (pttMask & IO_PTT_MASK_PTT2) {
+        IO_OUT_GPIO->BRR = IO_OUT_PIN_2;
+        LED_SET(0, 0);
+
+        /* Update debug register */
+        settingsRegMap[SETTINGS_REG_INFO_AUDIO0] &= ~SETTINGS_REG_INFO_AIOC0_PTT2STATE_MASK;
+    }
+
+    USB_SerialPTTChanged(PTTOutputs());
+}
+
+void IO_PTTAssert(uint8_t pttMask)
+{
+    __disable_irq();
+    PTTAssert(pttMask);
+    __enable_irq();
+}
+
+void IO_PTTDeassertImmediate(uint8_t pttMask)
+{
+    __disable_irq();
+
+    /* Overrides a tail that may be running on these outputs */
+    Subtone_CancelRelease(pttMask);
+    PTTDeassert(pttMask);
+
+    __enable_irq();
+}
+
+void IO_PTTSourceAssert(io_ptt_source_t source, uint8_t pttMask)
+{
+    __disable_irq();
+
+    pttSourceMask[source] |= pttMask;
+    PTTAssert(pttMask);
+
+    __enable_irq();
+}
+
+void IO_PTTSourceRelease(io_ptt_source_t source, uint8_t pttMask)
+{
+    __disable_irq();
+
+    /* Only release the outputs this source holds and no other source does */
+    pttMask &= pttSourceMask[source];
+    pttSourceMask[source] &= ~pttMask;
+
+    for (uint8_t i = 0; i < IO_PTT_SOURCE_COUNT; i++) {
+        pttMask &= ~pttSourceMask[i];
+    }
+
+    if (IO_PTT_SOURCES_TAIL & (1U << source)) {
+        /* The sub-audible tone encoder may hold the outputs for its tail */
+        pttMask &= ~Subtone_DeferRelease(pttMask);
+    }
+
+    if (pttMask != IO_PTT_MASK_NONE) {
+        PTTDeassert(pttMask);
+    }
+
+    __enable_irq();
+}
 
 void IO_IN_EXTI_ISR(void)
 {
@@ -9,35 +122,35 @@ void IO_IN_EXTI_ISR(void)
         uint8_t state = IO_IN_GPIO->IDR & IO_IN_PIN_1 ? 0x00 : 0x01;
 
         if (settingsRegMap[SETTINGS_REG_CM108_IOMUX0] & SETTINGS_REG_CM108_IOMUX0_BTN1SRC_IN1_MASK) {
-            USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_VOLUP : 0x00);
+            USB_HIDSendButtonState(USB_HID_SOURCE_IN1, USB_HID_BUTTON_VOLUP, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_CM108_IOMUX1] & SETTINGS_REG_CM108_IOMUX1_BTN2SRC_IN1_MASK) {
-            USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_VOLDN : 0x00);
+            USB_HIDSendButtonState(USB_HID_SOURCE_IN1, USB_HID_BUTTON_VOLDN, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_CM108_IOMUX2] & SETTINGS_REG_CM108_IOMUX2_BTN3SRC_IN1_MASK) {
-            USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_PLAYMUTE : 0x00);
+            USB_HIDSendButtonState(USB_HID_SOURCE_IN1, USB_HID_BUTTON_PLAYMUTE, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_CM108_IOMUX3] & SETTINGS_REG_CM108_IOMUX3_BTN4SRC_IN1_MASK) {
-            USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_RECMUTE : 0x00);
+            USB_HIDSendButtonState(USB_HID_SOURCE_IN1, USB_HID_BUTTON_RECMUTE, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX0] & SETTINGS_REG_SERIAL_IOMUX0_DCDSRC_IN1_MASK) {
-            USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_DCD : 0x00);
+            USB_SerialSendLineState(USB_SERIAL_SOURCE_IN1, USB_SERIAL_LINESTATE_DCD, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX1] & SETTINGS_REG_SERIAL_IOMUX1_DSRSRC_IN1_MASK) {
-            USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_DSR : 0x00);
+            USB_SerialSendLineState(USB_SERIAL_SOURCE_IN1, USB_SERIAL_LINESTATE_DSR, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX2] & SETTINGS_REG_SERIAL_IOMUX2_RISRC_IN1_MASK) {
-            USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_RI : 0x00);
+            USB_SerialSendLineState(USB_SERIAL_SOURCE_IN1, USB_SERIAL_LINESTATE_RI, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX3] & SETTINGS_REG_SERIAL_IOMUX3_BRKSRC_IN1_MASK) {
-            USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_BREAK : 0x00);
+            USB_SerialSendLineState(USB_SERIAL_SOURCE_IN1, USB_SERIAL_LINESTATE_BREAK, state & 0x01);
         }
     }
 
@@ -45,35 +158,35 @@ void IO_IN_EXTI_ISR(void)
         uint8_t state = IO_IN_GPIO->IDR & IO_IN_PIN_2 ? 0x00 : 0x01;
 
         if (settingsRegMap[SETTINGS_REG_CM108_IOMUX0] & SETTINGS_REG_CM108_IOMUX0_BTN1SRC_IN2_MASK) {
-            USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_VOLUP : 0x00);
+            USB_HIDSendButtonState(USB_HID_SOURCE_IN2, USB_HID_BUTTON_VOLUP, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_CM108_IOMUX1] & SETTINGS_REG_CM108_IOMUX1_BTN2SRC_IN2_MASK) {
-            USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_VOLDN : 0x00);
+            USB_HIDSendButtonState(USB_HID_SOURCE_IN2, USB_HID_BUTTON_VOLDN, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_CM108_IOMUX2] & SETTINGS_REG_CM108_IOMUX2_BTN3SRC_IN2_MASK) {
-            USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_PLAYMUTE : 0x00);
+            USB_HIDSendButtonState(USB_HID_SOURCE_IN2, USB_HID_BUTTON_PLAYMUTE, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_CM108_IOMUX3] & SETTINGS_REG_CM108_IOMUX3_BTN4SRC_IN2_MASK) {
-            USB_HIDSendButtonState(state & 0x01 ? USB_HID_BUTTON_RECMUTE : 0x00);
+            USB_HIDSendButtonState(USB_HID_SOURCE_IN2, USB_HID_BUTTON_RECMUTE, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX0] & SETTINGS_REG_SERIAL_IOMUX0_DCDSRC_IN2_MASK) {
-            USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_DCD : 0x00);
+            USB_SerialSendLineState(USB_SERIAL_SOURCE_IN2, USB_SERIAL_LINESTATE_DCD, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX1] & SETTINGS_REG_SERIAL_IOMUX1_DSRSRC_IN2_MASK) {
-            USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_DSR : 0x00);
+            USB_SerialSendLineState(USB_SERIAL_SOURCE_IN2, USB_SERIAL_LINESTATE_DSR, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX2] & SETTINGS_REG_SERIAL_IOMUX2_RISRC_IN2_MASK) {
-            USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_RI : 0x00);
+            USB_SerialSendLineState(USB_SERIAL_SOURCE_IN2, USB_SERIAL_LINESTATE_RI, state & 0x01);
         }
 
         if (settingsRegMap[SETTINGS_REG_SERIAL_IOMUX3] & SETTINGS_REG_SERIAL_IOMUX3_BRKSRC_IN2_MASK) {
-            USB_SerialSendLineState(state & 0x01 ? USB_SERIAL_LINESTATE_BREAK : 0x00);
+            USB_SerialSendLineState(USB_SERIAL_SOURCE_IN2, USB_SERIAL_LINESTATE_BREAK, state & 0x01);
         }
     }
 
@@ -10,6 +10,17 @@
 #define IO_PTT_MASK_NONE        0x00
 #define IO_PTT_MASK_PTT1        0x01
 #define IO_PTT_MASK_PTT2        0x02
+#define IO_PTT_MASK_ALL         (IO_PTT_MASK_PTT1 | IO_PTT_MASK_PTT2)
+
+/* PTT sources sharing the PTT outputs. An output is only released when no source holds it */
+typedef enum {
+    IO_PTT_SOURCE_VPTT = 0,
+    IO_PTT_SOURCE_MODEM,
+    IO_PTT_SOURCE_FOXHUNT,
+    IO_PTT_SOURCE_CM108,
+    IO_PTT_SOURCE_SERIAL,
+    IO_PTT_SOURCE_COUNT
+} io_ptt_source_t;
 
 #define IO_OUT_GPIO             GPIOA
 #define IO_OUT_PIN_1            GPIO_PIN_1
@@ -22,69 +33,23 @@
 #define IO_IN_PIN_2_EXTI_PR     EXTI_PR_PR7
 #define IO_IN_IRQN              EXTI9_5_IRQn
 
-static inline void IO_PTTAssert(uint8_t pttMask)
-{
-    __disable_irq();
-
-    if (pttMask & IO_PTT_MASK_PTT1) {
-        IO_OUT_GPIO->BSRR = IO_OUT_PIN_1;
-        LED_SET(1, 1);
-
-        /* Update debug register */
-        settingsRegMap[SETTINGS_REG_INFO_AUDIO0] |= SETTINGS_REG_INFO_AIOC0_PTT1STATE_MASK;
-    }
-
-    if (pttMask & IO_PTT_MASK_PTT2) {
-        IO_OUT_GPIO->BSRR = IO_OUT_PIN_2;
-        LED_SET(0, 1);
-
-        /* Update debug register */
-        settingsRegMap[SETTINGS_REG_INFO_AUDIO0] |= SETTINGS_REG_INFO_AIOC0_PTT2STATE_MASK;
-    }
-
-    __enable_irq();
-}
-
-static inline void IO_PTTDeassert(uint8_t pttMask)
-{
-    __disable_irq();
+/* Implemented in io.c, as the release may be deferred by the sub-audible tone encoder
+ * and the serial receive path needs to know when the outputs change.
+ * Only automatic transmissions (virtual PTT, modem, fox hunt) release with the tail of the tone encoder,
+ * host controlled outputs drop immediately. IO_PTTDeassertImmediate forces the outputs off regardless of the sources */
+void IO_PTTAssert(uint8_t pttMask);
+void IO_PTTDeassertImmediate(uint8_t pttMask);
+void IO_PTTSourceAssert(io_ptt_source_t source, uint8_t pttMask);
+void IO_PTTSourceRelease(io_ptt_source_t source, uint8_t pttMask);
 
-    if (pttMask & IO_PTT_MASK_PTT1) {
-        IO_OUT_GPIO->BRR = IO_OUT_PIN_1;
-        LED_SET(1, 0);
-
-        /* Update debug register */
-        settingsRegMap[SETTINGS_REG_INFO_AUDIO0] &= ~SETTINGS_REG_INFO_AIOC0_PTT1STATE_MASK;
-    }
-
-    if (pttMask & IO_PTT_MASK_PTT2) {
-        IO_OUT_GPIO->BRR = IO_OUT_PIN_2;
-        LED_SET(0, 0);
-
-        /* Update debug register */
-        settingsRegMap[SETTINGS_REG_INFO_AUDIO0] &= ~SETTINGS_REG_INFO_AIOC0_PTT2STATE_MASK;
-    }
-
-    __enable_irq();
-}
-
-static inline void IO_PTTControl(uint8_t pttMask)
+static inline void IO_PTTControl(io_ptt_source_t source, uint8_t pttMask)
 {
-    /* TODO: Using this function, both PTTs can only be asserted/deasserted simultaneously.
-     * Switch to using fully event(edge) driven PTT assertion/deassertion using functions below */
-
-    if (pttMask & IO_PTT_MASK_PTT1) {
-        IO_PTTAssert(IO_PTT_MASK_PTT1);
-    } else {
-        IO_PTTDeassert(IO_PTT_MASK_PTT1);
-    }
-
-    if (pttMask & IO_PTT_MASK_PTT2) {
-        IO_PTTAssert(IO_PTT_MASK_PTT2);
-    } else {
-        IO_PTTDeassert(IO_PTT_MASK_PTT2);
+    /* Level based control, e.g. from the host. Outputs held by other sources stay asserted */
+    if (pttMask != IO_PTT_MASK_NONE) {
+        IO_PTTSourceAssert(source, pttMask);
     }
 
+    IO_PTTSourceRelease(source, ~pttMask & IO_PTT_MASK_ALL);
 }
 
 static inline  uint8_t IO_PTTStatus(void)
@@ -0,0 +1,183 @@
+#include "kiss.h"
+#include "tusb.h"
+#include "settings.h"
+#include "usb_control.h"
+#include "modem.h"
+
+static bool rxInFrame = false;
+static bool rxEscape = false;
+static bool rxOverflow = false;
+static uint16_t rxCount = 0;
+static uint8_t rxCommand;
+static uint8_t rxErrors = 0;
+
+static void WriteEscaped(const uint8_t * data, uint16_t length)
+{
+    uint8_t buffer[32];
+    uint8_t count = 0;
+
+    while (length--) {
+        uint8_t c = *data++;
+
+        if (count > sizeof(buffer) - 2) {
+            tud_cdc_n_write(USB_CONTROL_ITF, buffer, count);
+            count = 0;
+        }
+
+        if (c == KISS_FEND) {
+            buffer[count++] = KISS_FESC;
+            buffer[count++] = KISS_TFEND;
+        } else if (c == KISS_FESC) {
+            buffer[count++] = KISS_FESC;
+            buffer[count++] = KISS_TFESC;
+        } else {
+            buffer[count++] = c;
+        }
+    }
+
+    tud_cdc_n_write(USB_CONTROL_ITF, buffer, count);
+}
+
+bool Kiss_Connected(void)
+{
+    return USB_ControlEnabled() &&
+            (SETTINGS_GET(SETTINGS_REG_CTLCDC_CTRL, PROTOCOL) == SETTINGS_REG_CTLCDC_CTRL_PROTOCOL_KISS_ENUM) &&
+            tud_cdc_n_connected(USB_CONTROL_ITF);
+}
+
+bool Kiss_SendFrame(const uint8_t * data, uint16_t length)
+{
+    /* Frames are sent as a whole or not at all */
+    static const uint8_t header[] = { KISS_FEND, KISS_CMD_DATA };
+    static const uint8_t trailer[] = { KISS_FEND };
+
+    if (!Kiss_Connected()) {
+        return false;
+    }
+
+    uint32_t encodedLength = sizeof(header) + length + sizeof(trailer);
+
+    for (uint16_t i=0; i<length; i++) {
+        if ((data[i] == KISS_FEND) || (data[i] == KISS_FESC)) {
+            encodedLength++;
+        }
+    }
+
+    if (tud_cdc_n_write_available(USB_CONTROL_ITF) < encodedLength) {
+        return false;
+    }
+
+    tud_cdc_n_write(USB_CONTROL_ITF, header, sizeof(header));
+    WriteEscaped(data, length);
+    tud_cdc_n_write(USB_CONTROL_ITF, trailer, sizeof(trailer));
+    tud_cdc_n_write_flush(USB_CONTROL_ITF);
+
+    return true;
+}
+
+static void SetParameter(uint32_t mask, uint8_t offset, uint8_t value)
+{
+    uint32_t txCtrl = settingsRegMap[SETTINGS_REG_MODEM_TXCTRL];
+
+    Settings_RegWriteImmediate(SETTINGS_REG_MODEM_TXCTRL, (txCtrl & ~mask) | (((uint32_t) value << offset) & mask));
+}
+
+static void Dispatch(uint8_t * buffer)
+{
+    /* rxCount includes the command byte */
+    uint16_t length = rxCount - 1;
+
+    if (rxCommand == KISS_CMD_RETURN) {
+        /* There is no other mode to return to */
+        return;
+    }
+
+    if (((rxCommand >> 4) != 0) || rxOverflow) {
+        /* Single port TNC */
+        rxErrors++;
+        return;
+    }
+
+    switch (rxCommand & KISS_CMD_MASK) {
+    case KISS_CMD_DATA:
+        if (length > 0) {
+            Modem_TxStart(length);
+        }
+        break;
+
+    case KISS_CMD_TXDELAY:
+        if (length >= 1) {
+            SetParameter(SETTINGS_REG_MODEM_TXCTRL_TXDELAY_MASK, SETTINGS_REG_MODEM_TXCTRL_TXDELAY_OFFS, buffer[0]);
+        }
+        break;
+
+    case KISS_CMD_TXTAIL:
+        if (length >= 1) {
+            SetParameter(SETTINGS_REG_MODEM_TXCTRL_TXTAIL_MASK, SETTINGS_REG_MODEM_TXCTRL_TXTAIL_OFFS, buffer[0]);
+        }
+        break;
+
+    default:
+        /* Persistence, slot time, duplex and hardware commands have no meaning here */
+        break;
+    }
+}
+
+void Kiss_Task(void)
+{
+    if (!Modem_Enabled()) {
+        /* Nothing to feed, just keep the fifo from filling up */
+        tud_cdc_n_read_flush(USB_CONTROL_ITF);
+        return;
+    }
+
+    uint16_t size;
+    uint8_t * buffer = Modem_TxBuffer(&size);
+
+    /* While the previous frame is being transmitted, the data is left in the fifo, which pushes back on the host */
+    while ((buffer != NULL) && (tud_cdc_n_available(USB_CONTROL_ITF) > 0)) {
+        uint8_t c = (uint8_t) tud_cdc_n_read_char(USB_CONTROL_ITF);
+
+        if (c == KISS_FEND) {
+            if (rxInFrame && (rxCount > 0)) {
+                Dispatch(buffer);
+                buffer = Modem_TxBuffer(&size);
+            }
+
+            /* A FEND also opens the next frame */
+            rxInFrame = true;
+            rxEscape = false;
+            rxOverflow = false;
+            rxCount = 0;
+            continue;
+        }
+
+        if (!rxInFrame) {
+            continue;
+        }
+
+        if (rxEscape) {
+            c = (c == KISS_TFEND) ? KISS_FEND : (c == KISS_TFESC) ? KISS_FESC : c;
+            rxEscape = false;
+        } else if (c == KISS_FESC) {
+            rxEscape = true;
+            continue;
+        }
+
+        if (rxCount == 0) {
+            rxCommand = c;
+        } else if (rxCount <= size) {
+            buffer[rxCount - 1] = c;
+        } else {
+            rxOverflow = true;
+            continue;
+        }
+
+        rxCount++;
+    }
+}
+
+uint8_t Kiss_Errors(void)
+{
+    return rxErrors;
+}
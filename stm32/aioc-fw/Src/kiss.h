@@ -0,0 +1,24 @@
+#ifndef KISS_H_
+#define KISS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* KISS framing on the control CDC (when its protocol is set to KISS) */
+#define KISS_FEND           0xC0
+#define KISS_FESC           0xDB
+#define KISS_TFEND          0xDC
+#define KISS_TFESC          0xDD
+
+#define KISS_CMD_DATA       0x00
+#define KISS_CMD_TXDELAY    0x01
+#define KISS_CMD_TXTAIL     0x04
+#define KISS_CMD_RETURN     0xFF
+#define KISS_CMD_MASK       0x0F /* Upper nibble is the port number */
+
+void Kiss_Task(void);
+bool Kiss_Connected(void);
+bool Kiss_SendFrame(const uint8_t * data, uint16_t length);
+uint8_t Kiss_Errors(void);
+
+#endif /* KISS_H_ */
@@ -0,0 +1,256 @@
+#include "limiter.h"
+#include "stm32f3xx_hal.h"
+#include "settings.h"
+#include "usb_audio.h"
+#include <math.h>
+
+#define LIMITER_GAIN_INTERVAL   1       /* Update interval of the compressor gain in ms */
+#define LIMITER_INFO_INTERVAL   1000    /* Update interval of the gain reduction statistics in ms */
+
+/* Parameters, prepared by the main loop */
+static uint32_t configRate = 0;
+static uint32_t configCtrl = 0;
+static uint32_t configComp = 0;
+static volatile uint8_t limiterMode = SETTINGS_REG_LIMIT_CTRL_MODE_OFF_ENUM;
+static volatile uint8_t lookahead = 0;
+static volatile uint8_t releaseShift = 0;
+static volatile int32_t ceiling = INT16_MAX;
+static float compThreshold = 0.0f; /* in dBFS */
+static float compSlope = 0.0f;     /* 1/ratio - 1 */
+static float compKnee = 0.0f;      /* in dB */
+static float compMakeup = 0.0f;    /* in dB */
+static volatile uint32_t compGain = LIMITER_UNITY;
+
+/* Limiter state, owned by the DAC interrupt */
+static int32_t delayLine[LIMITER_LOOKAHEAD_MAX]; /* Compressed samples may exceed the 16 bit range */
+static uint8_t delayPos = 0;
+static uint32_t gain = LIMITER_UNITY;
+static uint32_t floorGain = LIMITER_UNITY;
+static uint32_t gainStep = 0;
+static uint8_t holdCount = 0;
+
+/* Compressor state, owned by the DAC interrupt */
+static uint32_t envelope = 0;
+static uint32_t compGainSmooth = LIMITER_UNITY;
+static volatile uint32_t compEnvelope = 0; /* Published to the main loop */
+
+/* Telemetry, collected by the DAC interrupt */
+static volatile uint32_t limitGainMin = LIMITER_UNITY;
+static volatile uint32_t limitMs = 0;
+static uint8_t msCount = 0;
+static bool msLimited = false;
+
+/* Highest gain reductions during the last second in 0.1 dB */
+static uint32_t gainTick;
+static uint32_t infoTick;
+static float compGainDbMin = 0.0f;
+static uint32_t limitReduction = 0;
+static uint32_t compReduction = 0;
+
+static void InfoUpdate(void)
+{
+    settingsRegMap[SETTINGS_REG_INFO_LIMIT0] =
+            ((limitReduction << SETTINGS_REG_INFO_LIMIT0_LIMITGR_OFFS) & SETTINGS_REG_INFO_LIMIT0_LIMITGR_MASK) |
+            ((compReduction << SETTINGS_REG_INFO_LIMIT0_COMPGR_OFFS) & SETTINGS_REG_INFO_LIMIT0_COMPGR_MASK);
+    settingsRegMap[SETTINGS_REG_INFO_LIMIT1] =
+            (limitMs << SETTINGS_REG_INFO_LIMIT1_LIMITMS_OFFS) & SETTINGS_REG_INFO_LIMIT1_LIMITMS_MASK;
+}
+
+static void Configure(uint32_t sampleRate)
+{
+    uint8_t mode = SETTINGS_GET(SETTINGS_REG_LIMIT_CTRL, MODE);
+    uint32_t release = SETTINGS_GET(SETTINGS_REG_LIMIT_CTRL, RELEASE) * sampleRate / 1000;
+    uint32_t ratio = SETTINGS_GET(SETTINGS_REG_LIMIT_COMP, RATIO);
+    uint32_t limit = SETTINGS_GET(SETTINGS_REG_LIMIT_CTRL, CEILING);
+    uint32_t makeup = SETTINGS_GET(SETTINGS_REG_LIMIT_COMP, MAKEUP);
+    uint8_t shift = 0;
+    uint32_t length = sampleRate / 1000;
+
+    /* Release time constant as a power of 2 in samples */
+    while ((2UL << shift) <= release) {
+        shift++;
+    }
+
+    if (length > LIMITER_LOOKAHEAD_MAX) {
+        length = LIMITER_LOOKAHEAD_MAX;
+    }
+
+    /* Restart with an empty delay line */
+    __disable_irq();
+    limiterMode = (length != 0) ? mode : SETTINGS_REG_LIMIT_CTRL_MODE_OFF_ENUM;
+    lookahead = length;
+    releaseShift = shift;
+    ceiling = (limit < INT16_MAX) ? limit : INT16_MAX;
+    compThreshold = -(float) SETTINGS_GET(SETTINGS_REG_LIMIT_COMP, THRESHOLD);
+    compSlope = 10.0f / ((ratio < 10) ? 10 : ratio) - 1.0f;
+    compKnee = SETTINGS_GET(SETTINGS_REG_LIMIT_COMP, KNEE);
+    compMakeup = (makeup < LIMITER_MAKEUP_MAX) ? makeup : LIMITER_MAKEUP_MAX;
+
+    for (uint8_t i = 0; i < LIMITER_LOOKAHEAD_MAX; i++) {
+        delayLine[i] = 0;
+    }
+
+    delayPos = 0;
+    gain = LIMITER_UNITY;
+    floorGain = LIMITER_UNITY;
+    gainStep = 0;
+    holdCount = 0;
+    envelope = 0;
+    compEnvelope = 0;
+    compGain = LIMITER_UNITY;
+    compGainSmooth = LIMITER_UNITY;
+    __enable_irq();
+}
+
+static float CompressorGainDb(uint32_t level)
+{
+    /* Static curve with a quadratic soft knee */
+    float over = 20.0f * log10f((level + 1) / 32768.0f) - compThreshold;
+
+    if (2.0f * over <= -compKnee) {
+        return 0.0f;
+    }
+
+    if (2.0f * over < compKnee) {
+        float x = over + compKnee / 2.0f;
+        return compSlope * x * x / (2.0f * compKnee);
+    }
+
+    return compSlope * over;
+}
+
+void Limiter_Init(void)
+{
+    gainTick = HAL_GetTick();
+    infoTick = gainTick;
+    InfoUpdate();
+}
+
+void Limiter_Task(void)
+{
+    /* Follow the playback sample rate and the settings */
+    uint32_t sampleRate = USB_AudioTxSampleRate();
+    uint32_t ctrl = settingsRegMap[SETTINGS_REG_LIMIT_CTRL];
+    uint32_t comp = settingsRegMap[SETTINGS_REG_LIMIT_COMP];
+
+    if ((sampleRate != configRate) || (ctrl != configCtrl) || (comp != configComp)) {
+        Configure(sampleRate);
+
+        configRate = sampleRate;
+        configCtrl = ctrl;
+        configComp = comp;
+    }
+
+    uint32_t now = HAL_GetTick();
+
+    if ((limiterMode == SETTINGS_REG_LIMIT_CTRL_MODE_COMPRESS_ENUM) && (now - gainTick >= LIMITER_GAIN_INTERVAL)) {
+        /* The compressor gain follows the envelope published by the DAC interrupt, keeping the float math out of it.
+         * The interrupt smooths over the steps, so there is no need to run this on every pass of the main loop */
+        float gainDb = CompressorGainDb(compEnvelope);
+
+        gainTick = now;
+        compGain = (uint32_t) (LIMITER_UNITY * powf(10.0f, (gainDb + compMakeup) / 20.0f));
+
+        if (gainDb < compGainDbMin) {
+            compGainDbMin = gainDb;
+        }
+    }
+
+    if (now - infoTick >= LIMITER_INFO_INTERVAL) {
+        /* Collect the gain reduction of the last window */
+        __disable_irq();
+        uint32_t gainMin = limitGainMin;
+        limitGainMin = LIMITER_UNITY;
+        __enable_irq();
+
+        uint32_t limit = (gainMin < LIMITER_UNITY) ? (uint32_t) (-200.0f * log10f((gainMin + 1) / (float) LIMITER_UNITY)) : 0;
+        uint32_t compress = (uint32_t) (-10.0f * compGainDbMin);
+
+        infoTick = now;
+        compGainDbMin = 0.0f;
+        limitReduction = (limit > 0xFFFF) ? 0xFFFF : limit;
+        compReduction = (compress > 0xFFFF) ? 0xFFFF : compress;
+
+        InfoUpdate();
+    }
+}
+
+int16_t Limiter_TxSample(int16_t sample)
+{
+    /* Called at audio interrupt priority */
+    if (limiterMode == SETTINGS_REG_LIMIT_CTRL_MODE_OFF_ENUM) {
+        return sample;
+    }
+
+    int32_t input = sample;
+
+    if (limiterMode == SETTINGS_REG_LIMIT_CTRL_MODE_COMPRESS_ENUM) {
+        uint32_t magnitude = (input < 0) ? -input : input;
+
+        /* Peak envelope with instant attack. The decay is rounded up, so that it reaches zero */
+        envelope = (magnitude > envelope) ? magnitude : envelope - ((envelope + (1UL << releaseShift) - 1) >> releaseShift);
+        compEnvelope = envelope;
+
+        /* Smooth the gain updates from the main loop. Steps are rounded away from zero, so that the target is reached */
+        int32_t delta = (int32_t) compGain - (int32_t) compGainSmooth;
+        compGainSmooth = (int32_t) compGainSmooth + ((delta > 0) ? (delta + 31) >> 5 : delta >> 5);
+        input = (int32_t) (((int64_t) input * compGainSmooth) >> 16);
+    }
+
+    /* Gain this sample needs when it leaves the delay line */
+    uint32_t magnitude = (input < 0) ? -input : input;
+    uint32_t need = (magnitude > (uint32_t) ceiling) ? ((uint32_t) ceiling << 16) / magnitude : LIMITER_UNITY;
+
+    if (need < LIMITER_UNITY) {
+        /* Hold until this sample has been played */
+        holdCount = lookahead + 1;
+        msLimited = true;
+
+        if (need < floorGain) {
+            floorGain = need;
+        }
+
+        if (need < gain) {
+            /* A steeper ramp also reaches all earlier targets in time */
+            uint32_t step = (gain - need + lookahead - 1) / lookahead;
+
+            if (step > gainStep) {
+                gainStep = step;
+            }
+        }
+    }
+
+    if (gainStep != 0) {
+        gain = (gain > floorGain + gainStep) ? gain - gainStep : floorGain;
+
+        if (gain == floorGain) {
+            gainStep = 0;
+        }
+    } else if (holdCount == 0) {
+        floorGain = LIMITER_UNITY;
+        gain += ((LIMITER_UNITY - gain) + (1UL << releaseShift) - 1) >> releaseShift; /* Rounded up, so that unity is reached */
+    }
+
+    if (holdCount != 0) {
+        holdCount--;
+    }
+
+    if (gain < limitGainMin) {
+        limitGainMin = gain;
+    }
+
+    if (++msCount >= lookahead) {
+        /* The lookahead is 1 ms long */
+        limitMs += msLimited ? 1 : 0;
+        msLimited = false;
+        msCount = 0;
+    }
+
+    int32_t delayed = delayLine[delayPos];
+    delayLine[delayPos] = input;
+    delayPos = (delayPos + 1 < lookahead) ? delayPos + 1 : 0;
+
+    int32_t output = (int32_t) (((int64_t) delayed * gain) >> 16);
+
+    return (output > ceiling) ? ceiling : (output < -ceiling) ? -ceiling : (int16_t) output;
+}
@@ -0,0 +1,21 @@
+#ifndef LIMITER_H_
+#define LIMITER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Playback dynamics processing against over-deviation. An optional soft-knee compressor follows a peak envelope, from which
+ * the main loop computes its gain. The peak limiter delays the audio by 1 ms of lookahead and ramps
+ * the gain down linearly, so that it has reached the required value when the peak leaves the delay line.
+ * The gain is held while limited samples are in the delay line and then released exponentially. */
+#define LIMITER_LOOKAHEAD_MAX   48 /* 1 ms at 48 kHz */
+#define LIMITER_MAKEUP_MAX      24 /* Compressor makeup gain limit in dB */
+#define LIMITER_UNITY           65536 /* Gains are in 16.16 format */
+
+void Limiter_Init(void);
+void Limiter_Task(void);
+
+/* Called by the DAC interrupt for every playback sample */
+int16_t Limiter_TxSample(int16_t sample);
+
+#endif /* LIMITER_H_ */
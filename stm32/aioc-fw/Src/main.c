@@ -1,9 +1,16 @@
 #include "stm32f3xx_hal.h"
 #include "aioc.h"
 #include "settings.h"
+#include "pool.h"
 #include "led.h"
 #include "usb.h"
 #include "fox_hunt.h"
+#include "modem.h"
+#include "tone.h"
+#include "subtone.h"
+#include "preroll.h"
+#include "filter.h"
+#include "limiter.h"
 #include <assert.h>
 #include <io.h>
 #include <stdio.h>
@@ -180,7 +187,12 @@ int main(void)
     SystemReset();
     SystemClock_Config();
 
+    /* Cycle counter, used by several modules for timestamps and processing cost measurement */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     Settings_Init();
+    Pool_Init();
 
     LED_Init();
     LED_MODE(0, LED_MODE_SLOWPULSE2X);
@@ -188,6 +200,13 @@ int main(void)
 
     IO_Init();
 
+    Modem_Init();
+    Tone_Init();
+    Subtone_Init();
+    Preroll_Init();
+    Filter_Init();
+    Limiter_Init();
+
     USB_Init();
 
     FoxHunt_Init();
@@ -204,7 +223,14 @@ int main(void)
     HAL_IWDG_Init(&IWDGHandle);
 
     while (1) {
+        Settings_Task();
         USB_Task();
+        Modem_Task();
+        Tone_Task();
+        Subtone_Task();
+        Preroll_Task();
+        Filter_Task();
+        Limiter_Task();
 
         static uint32_t lastTick = 0;
         uint32_t nowTick = HAL_GetTick();
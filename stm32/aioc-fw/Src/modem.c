@@ -0,0 +1,301 @@
+#include "modem.h"
+#include "stm32f3xx_hal.h"
+#include "settings.h"
+#include "pool.h"
+#include "hdlc.h"
+#include "kiss.h"
+#include "afsk.h"
+#include "g3ruh.h"
+#include "usb_audio.h"
+#include "io.h"
+#include "dsp.h"
+#include <stddef.h>
+
+static uint8_t modemMode = SETTINGS_REG_MODEM_CTRL_MODE_NONE_ENUM;
+static uint8_t modemState = SETTINGS_REG_INFO_MODEM2_STATE_OFF_ENUM;
+
+/* Block ring filled by the ADC interrupt */
+static dsp_ring_t rxRing;
+static dsp_decim_t rxDecim;
+static uint32_t rxSampleRate = 0;
+static bool rxRateSupported = true;
+
+static hdlc_rx_t hdlcRx;
+
+typedef enum {
+    TX_IDLE,
+    TX_PENDING,     /* Frame in buffer, waiting for the main loop to key up */
+    TX_ACTIVE,      /* Owned by the DAC interrupt */
+    TX_DONE         /* Waiting for the main loop to release the PTT */
+} tx_state_t;
+
+static uint8_t * txFrame;
+static uint16_t txLength;
+static volatile tx_state_t txState = TX_IDLE;
+static bool txRateSupported = true;
+static hdlc_tx_t hdlcTx;
+
+static uint16_t rxFrames = 0;
+static uint16_t rxFcsErrors = 0;
+static uint8_t kissDrops = 0;
+static uint32_t rxCyclesAvg = 0; /* 28.4 format */
+static uint32_t rxCyclesMax = 0;
+static uint16_t txFrames = 0;
+
+static void InfoUpdate(void)
+{
+    uint32_t cyclesAvg = rxCyclesAvg >> 4;
+    uint8_t state = ((modemState == SETTINGS_REG_INFO_MODEM2_STATE_RUN_ENUM) && !rxRateSupported) ?
+            SETTINGS_REG_INFO_MODEM2_STATE_RATE_ENUM : modemState;
+    uint8_t txStatus = (txState != TX_IDLE) ? SETTINGS_REG_INFO_MODEM3_TXSTATE_ACTIVE_ENUM :
+            !txRateSupported ? SETTINGS_REG_INFO_MODEM3_TXSTATE_RATE_ENUM : SETTINGS_REG_INFO_MODEM3_TXSTATE_IDLE_ENUM;
+
+    settingsRegMap[SETTINGS_REG_INFO_MODEM0] =
+            (((uint32_t) rxFrames << SETTINGS_REG_INFO_MODEM0_RXFRAMES_OFFS) & SETTINGS_REG_INFO_MODEM0_RXFRAMES_MASK) |
+            (((uint32_t) rxFcsErrors << SETTINGS_REG_INFO_MODEM0_RXFCSERR_OFFS) & SETTINGS_REG_INFO_MODEM0_RXFCSERR_MASK);
+    settingsRegMap[SETTINGS_REG_INFO_MODEM1] =
+            (((cyclesAvg > 0xFFFF ? 0xFFFF : cyclesAvg) << SETTINGS_REG_INFO_MODEM1_RXCYCLES_OFFS) & SETTINGS_REG_INFO_MODEM1_RXCYCLES_MASK) |
+            (((rxCyclesMax > 0xFFFF ? 0xFFFF : rxCyclesMax) << SETTINGS_REG_INFO_MODEM1_RXCYCLESMAX_OFFS) & SETTINGS_REG_INFO_MODEM1_RXCYCLESMAX_MASK);
+    settingsRegMap[SETTINGS_REG_INFO_MODEM2] =
+            (((uint32_t) rxRing.overruns << SETTINGS_REG_INFO_MODEM2_RXOVERRUN_OFFS) & SETTINGS_REG_INFO_MODEM2_RXOVERRUN_MASK) |
+            (((uint32_t) kissDrops << SETTINGS_REG_INFO_MODEM2_KISSDROP_OFFS) & SETTINGS_REG_INFO_MODEM2_KISSDROP_MASK) |
+            (((uint32_t) state << SETTINGS_REG_INFO_MODEM2_STATE_OFFS) & SETTINGS_REG_INFO_MODEM2_STATE_MASK);
+    settingsRegMap[SETTINGS_REG_INFO_MODEM3] =
+            (((uint32_t) txFrames << SETTINGS_REG_INFO_MODEM3_TXFRAMES_OFFS) & SETTINGS_REG_INFO_MODEM3_TXFRAMES_MASK) |
+            (((uint32_t) Kiss_Errors() << SETTINGS_REG_INFO_MODEM3_KISSERR_OFFS) & SETTINGS_REG_INFO_MODEM3_KISSERR_MASK) |
+            (((uint32_t) txStatus << SETTINGS_REG_INFO_MODEM3_TXSTATE_OFFS) & SETTINGS_REG_INFO_MODEM3_TXSTATE_MASK);
+}
+
+static uint32_t ModeBaudrate(void)
+{
+    return (modemMode == SETTINGS_REG_MODEM_CTRL_MODE_G3RUH9600_ENUM) ? G3RUH_BAUD : AFSK_BAUD;
+}
+
+static void RxConfig(uint32_t sampleRate)
+{
+    /* Follow the capture sample rate, which may be changed by the host at any time.
+     * AFSK is demodulated at a decimated rate, G3RUH needs the full rate */
+    uint8_t decim = 1;
+
+    if (modemMode == SETTINGS_REG_MODEM_CTRL_MODE_AFSK1200_ENUM) {
+        decim = sampleRate / MODEM_AFSK_MINRATE;
+
+        if (decim == 0) {
+            decim = 1;
+        }
+    }
+
+    NVIC_DisableIRQ(ADC1_2_IRQn);
+    Dsp_DecimInit(&rxDecim, decim);
+    Dsp_RingReset(&rxRing);
+    NVIC_EnableIRQ(ADC1_2_IRQn);
+
+    switch (modemMode) {
+    case SETTINGS_REG_MODEM_CTRL_MODE_AFSK1200_ENUM:
+        Afsk_RxInit(sampleRate / decim);
+        rxRateSupported = true;
+        break;
+
+    case SETTINGS_REG_MODEM_CTRL_MODE_G3RUH9600_ENUM:
+        rxRateSupported = G3ruh_RxInit(sampleRate);
+        break;
+
+    default:
+        rxRateSupported = false;
+        break;
+    }
+
+    rxSampleRate = sampleRate;
+    InfoUpdate();
+}
+
+void Modem_RxLevel(uint8_t level)
+{
+    switch (Hdlc_RxLevel(&hdlcRx, level)) {
+    case HDLC_RX_FRAME:
+        rxFrames++;
+
+        if (!Kiss_SendFrame(hdlcRx.frame, hdlcRx.frameLength)) {
+            kissDrops++;
+        }
+        break;
+
+    case HDLC_RX_FCSERR:
+        rxFcsErrors++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+void Modem_RxSample(int16_t sample)
+{
+    /* Called at audio interrupt priority */
+    if (modemState != SETTINGS_REG_INFO_MODEM2_STATE_RUN_ENUM) {
+        return;
+    }
+
+    if (Dsp_Decimate(&rxDecim, sample, &sample)) {
+        Dsp_RingWrite(&rxRing, sample);
+    }
+}
+
+void Modem_Init(void)
+{
+    /* Buffers are allocated once, so the mode is latched until next reboot */
+    modemMode = SETTINGS_GET(SETTINGS_REG_MODEM_CTRL, MODE);
+
+    if (modemMode == SETTINGS_REG_MODEM_CTRL_MODE_NONE_ENUM) {
+        modemState = SETTINGS_REG_INFO_MODEM2_STATE_OFF_ENUM;
+        InfoUpdate();
+        return;
+    }
+
+    int16_t * rxBlocks = Pool_Alloc(POOL_CLIENT_AUDIO, MODEM_RX_BLOCKS * MODEM_BLOCK_LEN * sizeof(int16_t));
+    uint8_t * frameBuffer = Pool_Alloc(POOL_CLIENT_AUDIO, HDLC_FRAME_MAXLEN);
+    txFrame = Pool_Alloc(POOL_CLIENT_AUDIO, HDLC_FRAME_MAXLEN - HDLC_FCS_LEN);
+
+    if ((rxBlocks == NULL) || (frameBuffer == NULL) || (txFrame == NULL)) {
+        modemState = SETTINGS_REG_INFO_MODEM2_STATE_NOMEM_ENUM;
+        InfoUpdate();
+        return;
+    }
+
+    Dsp_RingInit(&rxRing, rxBlocks, MODEM_BLOCK_LEN, MODEM_RX_BLOCKS);
+    Dsp_DecimInit(&rxDecim, 1);
+    Hdlc_RxInit(&hdlcRx, frameBuffer);
+
+    modemState = SETTINGS_REG_INFO_MODEM2_STATE_RUN_ENUM;
+    InfoUpdate();
+}
+
+static void TxTask(void)
+{
+    if (txState == TX_PENDING) {
+        /* TXDELAY and TXTAIL are given in units of 10 ms, which is baudrate/800 flags */
+        uint32_t baudrate = ModeBaudrate();
+        uint16_t preambleFlags = (SETTINGS_GET(SETTINGS_REG_MODEM_TXCTRL, TXDELAY) * baudrate + 400) / 800;
+        uint16_t tailFlags = (SETTINGS_GET(SETTINGS_REG_MODEM_TXCTRL, TXTAIL) * baudrate + 400) / 800;
+        uint32_t sampleRate = USB_AudioTxSampleRate();
+        uint16_t level = SETTINGS_GET(SETTINGS_REG_MODEM_TXCTRL, LEVEL);
+
+        Hdlc_TxInit(&hdlcTx, txFrame, txLength, preambleFlags, tailFlags);
+
+        if (modemMode == SETTINGS_REG_MODEM_CTRL_MODE_G3RUH9600_ENUM) {
+            txRateSupported = G3ruh_TxInit(sampleRate, level);
+        } else {
+            Afsk_TxInit(sampleRate, level);
+            txRateSupported = true;
+        }
+
+        if (!txRateSupported) {
+            /* Drop the frame rather than keying up with an aliased signal */
+            txState = TX_IDLE;
+            InfoUpdate();
+            return;
+        }
+
+        /* Key the same PTT outputs as the virtual PTT */
+        uint8_t txPttMask = IO_PTT_MASK_NONE;
+        txPttMask |= settingsRegMap[SETTINGS_REG_AIOC_IOMUX0] & SETTINGS_REG_AIOC_IOMUX0_OUT1SRC_VPTT_MASK ? IO_PTT_MASK_PTT1 : 0;
+        txPttMask |= settingsRegMap[SETTINGS_REG_AIOC_IOMUX1] & SETTINGS_REG_AIOC_IOMUX1_OUT2SRC_VPTT_MASK ? IO_PTT_MASK_PTT2 : 0;
+
+        IO_PTTSourceAssert(IO_PTT_SOURCE_MODEM, txPttMask);
+
+        /* Hand over to the DAC interrupt */
+        txState = TX_ACTIVE;
+        InfoUpdate();
+    } else if (txState == TX_DONE) {
+        IO_PTTSourceRelease(IO_PTT_SOURCE_MODEM, IO_PTT_MASK_ALL);
+
+        txFrames++;
+        txState = TX_IDLE;
+        InfoUpdate();
+    }
+}
+
+uint8_t * Modem_TxBuffer(uint16_t * size)
+{
+    if ((modemState != SETTINGS_REG_INFO_MODEM2_STATE_RUN_ENUM) || (txState != TX_IDLE)) {
+        return NULL;
+    }
+
+    *size = HDLC_FRAME_MAXLEN - HDLC_FCS_LEN;
+    return txFrame;
+}
+
+void Modem_TxStart(uint16_t length)
+{
+    txLength = length;
+    txState = TX_PENDING;
+}
+
+bool Modem_TxSample(int16_t * sample)
+{
+    /* Called at audio interrupt priority */
+    if (txState != TX_ACTIVE) {
+        return false;
+    }
+
+    bool active = (modemMode == SETTINGS_REG_MODEM_CTRL_MODE_G3RUH9600_ENUM) ? G3ruh_TxSample(sample) : Afsk_TxSample(sample);
+
+    if (!active) {
+        txState = TX_DONE;
+    }
+
+    return true;
+}
+
+int8_t Modem_TxBit(void)
+{
+    return Hdlc_TxBit(&hdlcTx);
+}
+
+void Modem_Task(void)
+{
+    if (modemState != SETTINGS_REG_INFO_MODEM2_STATE_RUN_ENUM) {
+        return;
+    }
+
+    TxTask();
+
+    uint32_t sampleRate = USB_AudioRxSampleRate();
+
+    if (sampleRate != rxSampleRate) {
+        RxConfig(sampleRate);
+    }
+
+    bool processed = false;
+
+    const int16_t * block;
+
+    while ((block = Dsp_RingRead(&rxRing)) != NULL) {
+        uint32_t startCycles = DWT->CYCCNT;
+
+        if (!rxRateSupported) {
+            /* Discard */
+        } else if (modemMode == SETTINGS_REG_MODEM_CTRL_MODE_G3RUH9600_ENUM) {
+            G3ruh_RxProcess(block, MODEM_BLOCK_LEN);
+        } else {
+            Afsk_RxProcess(block, MODEM_BLOCK_LEN);
+        }
+
+        uint32_t cycles = DWT->CYCCNT - startCycles;
+
+        rxCyclesAvg = rxCyclesAvg - (rxCyclesAvg >> 4) + cycles;
+        if (cycles > rxCyclesMax) rxCyclesMax = cycles;
+
+        Dsp_RingRelease(&rxRing);
+        processed = true;
+    }
+
+    if (processed) {
+        InfoUpdate();
+    }
+}
+
+bool Modem_Enabled(void)
+{
+    return modemState == SETTINGS_REG_INFO_MODEM2_STATE_RUN_ENUM;
+}
@@ -0,0 +1,35 @@
+#ifndef MODEM_H_
+#define MODEM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* On-device packet modem. Capture samples are taken from the ADC interrupt (alongside USB audio),
+ * decimated and collected into blocks which are demodulated from the main loop.
+ * Received frames are forwarded via KISS. Frames from KISS are modulated directly in the DAC interrupt,
+ * keying the PTT outputs that are routed to the virtual PTT. Buffers are taken from the audio pool partition. */
+#define MODEM_BLOCK_LEN         96  /* Samples per processing block */
+#define MODEM_RX_BLOCKS         3
+#define MODEM_AFSK_MINRATE      9600 /* AFSK is demodulated at the capture rate, decimated to no less than this. G3RUH at the full capture rate */
+
+void Modem_Init(void);
+void Modem_Task(void);
+bool Modem_Enabled(void);
+
+/* Called by the ADC interrupt for every capture sample */
+void Modem_RxSample(int16_t sample);
+
+/* Called by the demodulators for every recovered line level (before NRZI decoding) */
+void Modem_RxLevel(uint8_t level);
+
+/* Frame buffer for the next transmission (without FCS) or NULL while a transmission is in progress */
+uint8_t * Modem_TxBuffer(uint16_t * size);
+void Modem_TxStart(uint16_t length);
+
+/* Called by the DAC interrupt for every playback sample. Returns true if the sample was replaced by the modem */
+bool Modem_TxSample(int16_t * sample);
+
+/* Called by the modulators for every bit (before NRZI encoding). Returns -1 after the last bit */
+int8_t Modem_TxBit(void);
+
+#endif /* MODEM_H_ */
@@ -0,0 +1,88 @@
+#include "pool.h"
+#include "settings.h"
+#include "tusb.h"
+#include <stddef.h>
+
+/* Partition sizes in bytes for each pool mode. Each row must add up to at most POOL_SIZE */
+static const uint16_t poolPartitions[][POOL_CLIENT_COUNT] = {
+    [SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_BALANCED_ENUM] = {
+        [POOL_CLIENT_SERIALRX] = 128,
+        [POOL_CLIENT_CAPTURE] = 128,
+        [POOL_CLIENT_AUDIO] = 1280
+    },
+    [SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_SERIAL_ENUM] = {
+        [POOL_CLIENT_SERIALRX] = 1024,
+        [POOL_CLIENT_CAPTURE] = 256,
+        [POOL_CLIENT_AUDIO] = 256
+    },
+    [SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_AUDIO_ENUM] = {
+        [POOL_CLIENT_SERIALRX] = 64,
+        [POOL_CLIENT_CAPTURE] = 0,
+        [POOL_CLIENT_AUDIO] = 1472
+    }
+};
+
+static uint8_t pool[POOL_SIZE] __attribute__((aligned(POOL_ALIGN)));
+static uint8_t * partitionBase[POOL_CLIENT_COUNT];
+static uint16_t partitionSize[POOL_CLIENT_COUNT];
+static uint16_t partitionUsed[POOL_CLIENT_COUNT];
+static uint8_t poolMode;
+
+static void InfoUpdate(void)
+{
+    settingsRegMap[SETTINGS_REG_INFO_AIOC2] =
+            (((uint32_t) partitionSize[POOL_CLIENT_SERIALRX] << SETTINGS_REG_INFO_AIOC2_SERIALRX_OFFS) & SETTINGS_REG_INFO_AIOC2_SERIALRX_MASK) |
+            (((uint32_t) partitionSize[POOL_CLIENT_CAPTURE] << SETTINGS_REG_INFO_AIOC2_CAPTURE_OFFS) & SETTINGS_REG_INFO_AIOC2_CAPTURE_MASK) |
+            (((uint32_t) poolMode << SETTINGS_REG_INFO_AIOC2_POOLMODE_OFFS) & SETTINGS_REG_INFO_AIOC2_POOLMODE_MASK);
+    settingsRegMap[SETTINGS_REG_INFO_AIOC3] =
+            (((uint32_t) partitionSize[POOL_CLIENT_AUDIO] << SETTINGS_REG_INFO_AIOC3_AUDIO_OFFS) & SETTINGS_REG_INFO_AIOC3_AUDIO_MASK) |
+            (((uint32_t) partitionUsed[POOL_CLIENT_AUDIO] << SETTINGS_REG_INFO_AIOC3_AUDIOUSED_OFFS) & SETTINGS_REG_INFO_AIOC3_AUDIOUSED_MASK);
+}
+
+void Pool_Init(void)
+{
+    /* Clients hold on to their buffers (e.g. for DMA), so the partitioning is latched until next reboot */
+    poolMode = SETTINGS_GET(SETTINGS_REG_AIOC_MEMCTRL, POOLMODE);
+
+    if (poolMode >= sizeof(poolPartitions) / sizeof(poolPartitions[0])) {
+        poolMode = SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_BALANCED_ENUM;
+    }
+
+    uint8_t * base = pool;
+
+    for (uint8_t i = 0; i < POOL_CLIENT_COUNT; i++) {
+        partitionBase[i] = base;
+        partitionSize[i] = poolPartitions[poolMode][i];
+        partitionUsed[i] = 0;
+        base += partitionSize[i];
+    }
+
+    TU_ASSERT(base <= &pool[POOL_SIZE], /**/);
+
+    InfoUpdate();
+}
+
+uint16_t Pool_Size(pool_client_t client)
+{
+    return partitionSize[client];
+}
+
+uint16_t Pool_Available(pool_client_t client)
+{
+    return partitionSize[client] - partitionUsed[client];
+}
+
+void * Pool_Alloc(pool_client_t client, uint16_t size)
+{
+    /* Bump allocation only, buffers are never returned */
+    uint16_t offset = (partitionUsed[client] + (POOL_ALIGN - 1)) & ~(POOL_ALIGN - 1);
+
+    if ((size == 0) || (offset + size > partitionSize[client])) {
+        return NULL;
+    }
+
+    partitionUsed[client] = offset + size;
+    InfoUpdate();
+
+    return &partitionBase[client][offset];
+}
@@ -0,0 +1,23 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdint.h>
+
+/* Shared buffer pool. A fixed budget of RAM is partitioned between the clients once at boot,
+ * according to the POOLMODE setting. Each client then allocates its buffers from its own partition. */
+#define POOL_SIZE               1536 /* Total pool budget in bytes */
+#define POOL_ALIGN              4
+
+typedef enum {
+    POOL_CLIENT_SERIALRX = 0,   /* Serial receive DMA ring */
+    POOL_CLIENT_CAPTURE,        /* Serial capture ring (power of 2 or 0) */
+    POOL_CLIENT_AUDIO,          /* Audio processing (modems, filters, delay lines) */
+    POOL_CLIENT_COUNT
+} pool_client_t;
+
+void Pool_Init(void);
+uint16_t Pool_Size(pool_client_t client);
+uint16_t Pool_Available(pool_client_t client);
+void * Pool_Alloc(pool_client_t client, uint16_t size);
+
+#endif /* POOL_H_ */
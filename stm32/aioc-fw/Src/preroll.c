@@ -0,0 +1,153 @@
+#include "preroll.h"
+#include "stm32f3xx_hal.h"
+#include "settings.h"
+#include "pool.h"
+#include "dsp.h"
+#include "usb_audio.h"
+#include <stddef.h>
+#include <string.h>
+
+#define PREROLL_SILENCE     0xFF /* mu-law code of zero */
+
+static uint8_t prerollState = SETTINGS_REG_INFO_PREROLL0_STATE_OFF_ENUM;
+static uint8_t * delayLine = NULL;
+static uint16_t delayCapacity = 0; /* in bytes */
+
+/* Delay line parameters, prepared by the main loop */
+static uint32_t configRate = 0;
+static uint16_t configDelay = 0;
+static dsp_decim_t txDecim;
+static volatile uint16_t delayLength = 0;
+
+/* Delay line state, owned by the DAC interrupt */
+static uint16_t delayPos = 0;
+static int16_t previous = 0;
+static int16_t current = 0;
+
+static void InfoUpdate(void)
+{
+    uint32_t depth = (configRate != 0) ? (uint32_t) delayLength * 1000 * txDecim.factor / configRate : 0;
+
+    settingsRegMap[SETTINGS_REG_INFO_PREROLL0] =
+            ((depth << SETTINGS_REG_INFO_PREROLL0_DEPTH_OFFS) & SETTINGS_REG_INFO_PREROLL0_DEPTH_MASK) |
+            (((uint32_t) delayCapacity << SETTINGS_REG_INFO_PREROLL0_MEMORY_OFFS) & SETTINGS_REG_INFO_PREROLL0_MEMORY_MASK) |
+            (((uint32_t) prerollState << SETTINGS_REG_INFO_PREROLL0_STATE_OFFS) & SETTINGS_REG_INFO_PREROLL0_STATE_MASK);
+}
+
+static uint16_t EffectiveDelay(void)
+{
+    /* The storage rate never exceeds PREROLL_RATE, so the allocated memory holds at least this delay */
+    uint32_t delay = SETTINGS_GET(SETTINGS_REG_PREROLL_CTRL, DELAY);
+    uint32_t maxDelay = (uint32_t) delayCapacity * 1000 / PREROLL_RATE;
+
+    return (delay < maxDelay) ? delay : maxDelay;
+}
+
+static void Configure(uint32_t sampleRate, uint16_t delay)
+{
+    /* Smallest decimation factor that brings the storage rate down to PREROLL_RATE (e.g. 22050 Hz is stored at 7350 Hz) */
+    uint8_t factor = (sampleRate + PREROLL_RATE - 1) / PREROLL_RATE;
+    uint16_t length = (uint32_t) delay * (sampleRate / factor) / 1000;
+
+    NVIC_DisableIRQ(TIM6_DAC1_IRQn);
+    Dsp_DecimInit(&txDecim, factor);
+    memset(delayLine, PREROLL_SILENCE, delayCapacity);
+    delayPos = 0;
+    previous = 0;
+    current = 0;
+    delayLength = length;
+    NVIC_EnableIRQ(TIM6_DAC1_IRQn);
+}
+
+void Preroll_Init(void)
+{
+    /* Memory is allocated once, so the delay line is latched until next reboot */
+    uint32_t size = (uint32_t) SETTINGS_GET(SETTINGS_REG_PREROLL_CTRL, DELAY) * PREROLL_RATE / 1000;
+
+    if (size == 0) {
+        prerollState = SETTINGS_REG_INFO_PREROLL0_STATE_OFF_ENUM;
+        InfoUpdate();
+        return;
+    }
+
+    /* Take what is left of the audio partition, if it does not hold the full delay */
+    uint16_t available = Pool_Available(POOL_CLIENT_AUDIO) & ~(POOL_ALIGN - 1);
+
+    if (size > available) {
+        size = available;
+    }
+
+    delayLine = Pool_Alloc(POOL_CLIENT_AUDIO, size);
+
+    if (delayLine == NULL) {
+        prerollState = SETTINGS_REG_INFO_PREROLL0_STATE_NOMEM_ENUM;
+        InfoUpdate();
+        return;
+    }
+
+    delayCapacity = size;
+    prerollState = SETTINGS_REG_INFO_PREROLL0_STATE_RUN_ENUM;
+    InfoUpdate();
+}
+
+void Preroll_Task(void)
+{
+    if (prerollState != SETTINGS_REG_INFO_PREROLL0_STATE_RUN_ENUM) {
+        return;
+    }
+
+    /* Follow the playback sample rate and the configured delay */
+    uint32_t sampleRate = USB_AudioTxSampleRate();
+    uint16_t delay = EffectiveDelay();
+
+    if ((sampleRate != configRate) || (delay != configDelay)) {
+        if (sampleRate != 0) {
+            Configure(sampleRate, delay);
+        }
+
+        configRate = sampleRate;
+        configDelay = delay;
+        InfoUpdate();
+    }
+}
+
+bool Preroll_Enabled(void)
+{
+    return prerollState == SETTINGS_REG_INFO_PREROLL0_STATE_RUN_ENUM;
+}
+
+uint16_t Preroll_Delay(void)
+{
+    return Preroll_Enabled() ? EffectiveDelay() : 0;
+}
+
+uint16_t Preroll_PttTimeout(uint32_t timeout)
+{
+    if (timeout >= 0xFFFF) {
+        return 0xFFFF;
+    }
+
+    uint32_t extended = timeout + ((uint32_t) Preroll_Delay() << 4);
+
+    return extended > 0xFFFF ? 0xFFFF : extended;
+}
+
+int16_t Preroll_TxSample(int16_t sample)
+{
+    /* Called at audio interrupt priority */
+    if (delayLength == 0) {
+        return sample;
+    }
+
+    int16_t decimated;
+
+    if (Dsp_Decimate(&txDecim, sample, &decimated)) {
+        previous = current;
+        current = Dsp_UlawDecode(delayLine[delayPos]);
+        delayLine[delayPos] = Dsp_UlawEncode(decimated);
+        delayPos = (delayPos + 1 < delayLength) ? delayPos + 1 : 0;
+    }
+
+    /* Linear interpolation back to the playback sample rate */
+    return previous + (int16_t) (((int32_t) current - previous) * txDecim.count / txDecim.factor);
+}
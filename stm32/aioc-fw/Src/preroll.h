@@ -0,0 +1,26 @@
+#ifndef PREROLL_H_
+#define PREROLL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Playback pre-roll. The host audio is sent through a delay line, while the virtual PTT is triggered by the undelayed audio,
+ * so the radio is keyed before the first sample reaches it. To fit a few hundred milliseconds into the audio pool partition,
+ * the delay line holds the audio decimated to at most PREROLL_RATE and mu-law compressed to 8 bits.
+ * The output is linearly interpolated back to the playback sample rate. */
+#define PREROLL_RATE            8000 /* Maximum storage sample rate in Hz, i.e. bytes of memory per second of delay */
+
+void Preroll_Init(void);
+void Preroll_Task(void);
+bool Preroll_Enabled(void);
+
+/* Effective delay in milliseconds, by which the virtual PTT timeout is extended */
+uint16_t Preroll_Delay(void);
+
+/* Virtual PTT timeout (12.4 format in milliseconds) extended by the delay, saturated to the 16 bit timer range */
+uint16_t Preroll_PttTimeout(uint32_t timeout);
+
+/* Called by the DAC interrupt for every playback sample. Returns the delayed sample */
+int16_t Preroll_TxSample(int16_t sample);
+
+#endif /* PREROLL_H_ */
@@ -1,113 +1,488 @@
 #include "settings.h"
 #include <assert.h>
+#include <string.h>
 #include "stm32f3xx_hal.h"
 
+#define SETTINGS_PAGE_WORDS (FLASH_PAGE_SIZE / sizeof(uint32_t))
+
+/* Every stored image carries a trailer right after the register map, consisting of the layout version
+ * and a CRC32 covering the register map and the version word. Images written before the trailer existed
+ * read back as erased flash there and are treated as layout version 0. */
+#define SETTINGS_IMAGE_VERSION_IDX  (SETTINGS_REGMAP_SIZE + 0)
+#define SETTINGS_IMAGE_CRC_IDX      (SETTINGS_REGMAP_SIZE + 1)
+#define SETTINGS_IMAGE_WORDS        (SETTINGS_REGMAP_SIZE + 2)
+#define SETTINGS_LAYOUT_LEGACY      0
+
+/* A transaction that sees no activity for this long is assumed to be left behind by a host that went away */
+#define SETTINGS_TRANSACTION_TIMEOUT 2000 /* ms */
+
+/* Each image occupies its own flash page, so that a single profile can be stored
+ * without touching the others. Profile images use the same layout as the register map,
+ * with the magic in word 0 and the profile registers at their register address. */
+typedef struct {
+    uint32_t regMap[SETTINGS_PAGE_WORDS];
+    uint32_t profile[SETTINGS_PROFILE_COUNT][SETTINGS_PAGE_WORDS];
+} settings_rom_t;
+
+static_assert(SETTINGS_IMAGE_WORDS <= SETTINGS_PAGE_WORDS, "Register map does not fit into a flash page");
+
 /* Define this, so that each time the AIOC is programmed, the EEPROM is cleared.
  * This is inconvenient, but settings might not be portable across versions. */
-uint32_t settingsRegMapROM[SETTINGS_REGMAP_SIZE] __attribute__ ((section (".eeprom"))) = {[0 ... (SETTINGS_REGMAP_SIZE-1)] = 0xFFFFFFFFUL};
+settings_rom_t settingsROM __attribute__ ((section (".eeprom"))) = {
+    .regMap = {[0 ... (SETTINGS_PAGE_WORDS-1)] = 0xFFFFFFFFUL},
+    .profile = {[0 ... (SETTINGS_PROFILE_COUNT-1)] = {[0 ... (SETTINGS_PAGE_WORDS-1)] = 0xFFFFFFFFUL}}
+};
 
 uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE] = {[0 ... (SETTINGS_REGMAP_SIZE-1)] = 0};
 
-void Settings_Init()
+/* Staged writes between Settings_Begin() and Settings_Commit() go here instead of the live register map */
+static uint32_t settingsShadow[SETTINGS_REGMAP_READONLYADDR];
+/* One bit per staged register, so that commit leaves registers the firmware changed meanwhile alone */
+static uint32_t transactionDirty[(SETTINGS_REGMAP_READONLYADDR + 31) / 32];
+static volatile uint8_t transactionActive = 0;
+static uint32_t transactionTick;
+
+static uint32_t Crc32(const uint32_t * data, uint32_t wordCount)
 {
-    Settings_Recall();
+    /* Plain bitwise CRC-32 (IEEE 802.3). Only used when storing and recalling, so speed does not matter */
+    uint32_t crc = 0xFFFFFFFFUL;
+
+    while (wordCount--) {
+        uint32_t word = *data++;
+
+        for (uint8_t i=0; i<32; i++) {
+            uint32_t bit = (crc ^ word) & 0x01;
+            crc = (crc >> 1) ^ (bit ? 0xEDB88320UL : 0);
+            word >>= 1;
+        }
+    }
+
+    return ~crc;
 }
 
-uint8_t Settings_RegWrite(uint8_t address, uint32_t data)
+static uint8_t LegacyValid(const uint32_t * image)
 {
-    if (address < SETTINGS_REGMAP_READONLYADDR) {
-        __disable_irq();
-        settingsRegMap[address] = data;
-        __enable_irq();
+    /* Legacy firmware wrote the register map only, so the CRC word must still be erased */
+    if (image[SETTINGS_IMAGE_CRC_IDX] != 0xFFFFFFFFUL) {
+        return 0;
+    }
 
-        return 1;
+    uint32_t usbId = image[SETTINGS_REG_USBID];
+    uint32_t vid = (usbId & SETTINGS_REG_USBID_VID_MASK) >> SETTINGS_REG_USBID_VID_OFFS;
+    uint32_t pid = (usbId & SETTINGS_REG_USBID_PID_MASK) >> SETTINGS_REG_USBID_PID_OFFS;
+
+    if ( (vid == 0) || (vid == 0xFFFF) || (pid == 0) || (pid == 0xFFFF) ) {
+        return 0;
     }
 
-    return 0;
+    uint32_t rxGain = (image[SETTINGS_REG_AUDIO_RX] & SETTINGS_REG_AUDIO_RX_RXGAIN_MASK) >> SETTINGS_REG_AUDIO_RX_RXGAIN_OFFS;
+
+    if (rxGain > SETTINGS_REG_AUDIO_RX_RXGAIN_16X_ENUM) {
+        return 0;
+    }
+
+    return 1;
 }
 
-uint8_t Settings_RegRead(uint8_t address, uint32_t * data)
+static uint32_t ImageVersion(const uint32_t * image)
 {
-    if (address < SETTINGS_REGMAP_SIZE) {
-        __disable_irq();
-        *data = settingsRegMap[address];
-        __enable_irq();
+    if (image[SETTINGS_REG_MAGIC] != SETTINGS_REG_MAGIC_DEFAULT) {
+        /* Unprogrammed or unknown */
+        return UINT32_MAX;
+    }
 
-        return 1;
+    uint32_t version = image[SETTINGS_IMAGE_VERSION_IDX];
+
+    if (version == 0xFFFFFFFFUL) {
+        /* Image from before the trailer was introduced. There is no CRC to check against,
+         * so at least make sure the image does not carry values the firmware cannot work with */
+        return LegacyValid(image) ? SETTINGS_LAYOUT_LEGACY : UINT32_MAX;
     }
 
-    return 0;
+    if ( (version > SETTINGS_LAYOUT_VERSION) || (version == SETTINGS_LAYOUT_LEGACY) ||
+         (image[SETTINGS_IMAGE_CRC_IDX] != Crc32(image, SETTINGS_IMAGE_CRC_IDX)) ) {
+        return UINT32_MAX;
+    }
+
+    return version;
 }
 
-void Settings_Store(void)
+static uint8_t ImageWrite(const uint32_t * image, const uint32_t * data, uint32_t wordCount)
 {
-    HAL_FLASH_Unlock();
-
+    uint8_t success = 1;
     uint32_t pageError = 0;
-    extern uint32_t * _eeprom;
-    uint32_t pageAddress = (uint32_t) &_eeprom;
+    uint32_t wordAddress = (uint32_t) image;
 
     FLASH_EraseInitTypeDef eraseInitStruct = {
         .TypeErase = FLASH_TYPEERASE_PAGES,
-        .PageAddress = pageAddress,
-        .NbPages = (SETTINGS_REGMAP_SIZE * sizeof(uint32_t) + FLASH_PAGE_SIZE-1) / FLASH_PAGE_SIZE
+        .PageAddress = wordAddress,
+        .NbPages = 1
     };
 
+    HAL_FLASH_Unlock();
 
     if (HAL_FLASHEx_Erase(&eraseInitStruct, &pageError) != HAL_OK) {
-        uint32_t flashError = HAL_FLASH_GetError();
-        return;
+        success = 0;
     }
 
-    extern uint32_t * _eeprom;
-    uint32_t wordAddress = (uint32_t) &_eeprom;
-    uint32_t wordCount = SETTINGS_REGMAP_SIZE;
-    uint32_t * wordPtr = settingsRegMap;
+    for (uint32_t i = 0; success && (i < wordCount); i++) {
+        uint32_t word = data[i];
 
-    while (wordCount--) {
-        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, wordAddress, *wordPtr) != HAL_OK) {
-            uint32_t flashError = HAL_FLASH_GetError();
-            return;
+        if (i == SETTINGS_REG_SERIAL_BENCH) {
+            /* Command bit, must not start a test after recalling */
+            word &= ~SETTINGS_REG_SERIAL_BENCH_RUN_MASK;
+        }
+
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, wordAddress, word) != HAL_OK) {
+            success = 0;
         }
 
-        wordPtr++;
         wordAddress += sizeof(uint32_t);
     }
 
+    /* The register map may change while programming (e.g. debug registers), so the CRC is calculated
+     * over what actually ended up in flash */
+    if (success && (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, (uint32_t) &image[SETTINGS_IMAGE_VERSION_IDX], SETTINGS_LAYOUT_VERSION) != HAL_OK)) {
+        success = 0;
+    }
+
+    if (success && (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, (uint32_t) &image[SETTINGS_IMAGE_CRC_IDX], Crc32(image, SETTINGS_IMAGE_CRC_IDX)) != HAL_OK)) {
+        success = 0;
+    }
+
     HAL_FLASH_Lock();
+
+    return success;
 }
 
-void Settings_Recall(void)
+static void FilterDefault(uint8_t address, uint8_t count, uint32_t b0)
+{
+    /* Pass-through: b0 of every section is one, all other coefficients are zero */
+    for (uint8_t i = 0; i < count; i++) {
+        settingsRegMap[address + i] = (i % 5 == 0) ? b0 : 0;
+    }
+}
+
+static void Migrate(uint32_t version)
+{
+    /* Bring an image of an older layout up to date, one version at a time.
+     * Registers that did not exist in that layout get their default value. */
+    switch (version) {
+    case SETTINGS_LAYOUT_LEGACY:
+        settingsRegMap[SETTINGS_REG_PROFILE] = SETTINGS_REG_PROFILE_DEFAULT;
+        settingsRegMap[SETTINGS_REG_HID_TELEMETRY] = SETTINGS_REG_HID_TELEMETRY_DEFAULT;
+        /* fall through */
+    case 1:
+        settingsRegMap[SETTINGS_REG_SERIAL_FLUSH] = SETTINGS_REG_SERIAL_FLUSH_DEFAULT;
+        /* fall through */
+    case 2:
+        settingsRegMap[SETTINGS_REG_SERIAL_BENCH] = SETTINGS_REG_SERIAL_BENCH_DEFAULT;
+        /* fall through */
+    case 3:
+        settingsRegMap[SETTINGS_REG_CTLCDC_CTRL] = SETTINGS_REG_CTLCDC_CTRL_DEFAULT;
+        /* fall through */
+    case 4:
+        settingsRegMap[SETTINGS_REG_AIOC_MEMCTRL] = SETTINGS_REG_AIOC_MEMCTRL_DEFAULT;
+        /* fall through */
+    case 5:
+        settingsRegMap[SETTINGS_REG_MODEM_CTRL] = SETTINGS_REG_MODEM_CTRL_DEFAULT;
+        /* fall through */
+    case 6:
+        settingsRegMap[SETTINGS_REG_MODEM_TXCTRL] = SETTINGS_REG_MODEM_TXCTRL_DEFAULT;
+        /* fall through */
+    case 7:
+        settingsRegMap[SETTINGS_REG_DTMF_CTRL] = SETTINGS_REG_DTMF_CTRL_DEFAULT;
+        /* fall through */
+    case 8:
+        settingsRegMap[SETTINGS_REG_CTCSS_CTRL] = SETTINGS_REG_CTCSS_CTRL_DEFAULT;
+        /* fall through */
+    case 9:
+        settingsRegMap[SETTINGS_REG_TXTONE_CTRL] = SETTINGS_REG_TXTONE_CTRL_DEFAULT;
+        settingsRegMap[SETTINGS_REG_TXTONE_CODE] = SETTINGS_REG_TXTONE_CODE_DEFAULT;
+        /* fall through */
+    case 10:
+        /* Keep the peak detector these images were tuned for, only fresh defaults use the envelope detector */
+        settingsRegMap[SETTINGS_REG_VPTT_VOXCTRL] = (SETTINGS_REG_VPTT_VOXCTRL_DEFAULT & ~SETTINGS_REG_VPTT_VOXCTRL_MODE_MASK) |
+                SETTINGS_REG_VPTT_VOXCTRL_MODE_PEAK_ENUM;
+        settingsRegMap[SETTINGS_REG_VCOS_VOXCTRL] = (SETTINGS_REG_VCOS_VOXCTRL_DEFAULT & ~SETTINGS_REG_VCOS_VOXCTRL_MODE_MASK) |
+                SETTINGS_REG_VCOS_VOXCTRL_MODE_PEAK_ENUM;
+        /* fall through */
+    case 11:
+        settingsRegMap[SETTINGS_REG_PREROLL_CTRL] = SETTINGS_REG_PREROLL_CTRL_DEFAULT;
+        /* fall through */
+    case 12:
+        settingsRegMap[SETTINGS_REG_RXFILT_CTRL] = SETTINGS_REG_RXFILT_CTRL_DEFAULT;
+        settingsRegMap[SETTINGS_REG_TXFILT_CTRL] = SETTINGS_REG_TXFILT_CTRL_DEFAULT;
+        FilterDefault(SETTINGS_REG_RXFILT_COEF0, SETTINGS_REG_RXFILT_COEF_COUNT, SETTINGS_REG_RXFILT_COEF_B0_DEFAULT);
+        FilterDefault(SETTINGS_REG_TXFILT_COEF0, SETTINGS_REG_TXFILT_COEF_COUNT, SETTINGS_REG_TXFILT_COEF_B0_DEFAULT);
+        /* fall through */
+    case 13:
+        settingsRegMap[SETTINGS_REG_LIMIT_CTRL] = SETTINGS_REG_LIMIT_CTRL_DEFAULT;
+        settingsRegMap[SETTINGS_REG_LIMIT_COMP] = SETTINGS_REG_LIMIT_COMP_DEFAULT;
+        /* fall through */
+    default:
+        break;
+    }
+}
+
+static void InfoUpdate(uint32_t recallStatus)
+{
+    uint32_t validMask = 0;
+
+    for (uint8_t i=0; i<SETTINGS_PROFILE_COUNT; i++) {
+        /* Profiles are only accepted in the current layout */
+        if (ImageVersion(settingsROM.profile[i]) == SETTINGS_LAYOUT_VERSION) {
+            validMask |= 1UL << i;
+        }
+    }
+
+    uint32_t info = settingsRegMap[SETTINGS_REG_INFO_AIOC1];
+
+    if (recallStatus != UINT32_MAX) {
+        info &= ~SETTINGS_REG_INFO_AIOC1_RECALL_MASK;
+        info |= (recallStatus << SETTINGS_REG_INFO_AIOC1_RECALL_OFFS) & SETTINGS_REG_INFO_AIOC1_RECALL_MASK;
+    }
+
+    info &= ~SETTINGS_REG_INFO_AIOC1_PROFILEVALID_MASK;
+    info |= (validMask << SETTINGS_REG_INFO_AIOC1_PROFILEVALID_OFFS) & SETTINGS_REG_INFO_AIOC1_PROFILEVALID_MASK;
+
+    settingsRegMap[SETTINGS_REG_INFO_AIOC1] = info;
+}
+
+static void TransactionState(uint32_t state)
+{
+    uint32_t info = settingsRegMap[SETTINGS_REG_INFO_AIOC1];
+
+    info &= ~SETTINGS_REG_INFO_AIOC1_TRANSACTION_MASK;
+    info |= (state << SETTINGS_REG_INFO_AIOC1_TRANSACTION_OFFS) & SETTINGS_REG_INFO_AIOC1_TRANSACTION_MASK;
+
+    settingsRegMap[SETTINGS_REG_INFO_AIOC1] = info;
+}
+
+void Settings_Init()
+{
+    Settings_Recall();
+}
+
+void Settings_Task(void)
+{
+    if (transactionActive && ((HAL_GetTick() - transactionTick) >= SETTINGS_TRANSACTION_TIMEOUT)) {
+        /* Do not keep buffering every later write, when the host that opened the transaction went away */
+        transactionActive = 0;
+        TransactionState(SETTINGS_REG_INFO_AIOC1_TRANSACTION_EXPIRED_ENUM);
+    }
+}
+
+static void Stage(uint8_t address, uint32_t data)
+{
+    settingsShadow[address] = data;
+    transactionDirty[address / 32] |= 1UL << (address % 32);
+}
+
+static uint8_t ProfileApply(uint8_t slot, uint8_t staged)
+{
+    if (slot >= SETTINGS_PROFILE_COUNT) {
+        return 0;
+    }
+
+    /* Validity has been checked when recalling or storing, so that switching does not need to run the CRC */
+    const uint32_t * image = settingsROM.profile[slot];
+    uint8_t valid = (SETTINGS_GET(SETTINGS_REG_INFO_AIOC1, PROFILEVALID) >> slot) & 0x01;
+    uint32_t profileReg = ((uint32_t) slot << SETTINGS_REG_PROFILE_ACTIVE_OFFS) & SETTINGS_REG_PROFILE_ACTIVE_MASK;
+
+    if (staged) {
+        if (valid) {
+            for (uint8_t i = SETTINGS_PROFILE_FIRSTADDR; i < SETTINGS_REGMAP_READONLYADDR; i++) {
+                Stage(i, image[i]);
+            }
+            settingsShadow[SETTINGS_REG_SERIAL_BENCH] &= ~SETTINGS_REG_SERIAL_BENCH_RUN_MASK;
+        }
+        Stage(SETTINGS_REG_PROFILE, profileReg);
+        transactionTick = HAL_GetTick();
+
+        return 1;
+    }
+
+    /* Apply the whole profile at once, so that no interrupt handler ever sees a mix of two profiles */
+    __disable_irq();
+    if (valid) {
+        memcpy(&settingsRegMap[SETTINGS_PROFILE_FIRSTADDR], &image[SETTINGS_PROFILE_FIRSTADDR],
+                (SETTINGS_REGMAP_READONLYADDR - SETTINGS_PROFILE_FIRSTADDR) * sizeof(uint32_t));
+        /* Images stored by older firmware may still carry the command bit */
+        settingsRegMap[SETTINGS_REG_SERIAL_BENCH] &= ~SETTINGS_REG_SERIAL_BENCH_RUN_MASK;
+    }
+    settingsRegMap[SETTINGS_REG_PROFILE] = profileReg;
+    __enable_irq();
+
+    return 1;
+}
+
+static uint8_t RegWrite(uint8_t address, uint32_t data, uint8_t staged)
 {
-    /* From linker script */
-    extern uint32_t * _eeprom;
+    if (address == SETTINGS_REG_PROFILE) {
+        /* Selecting a profile applies it immediately (or stages it, inside a transaction) */
+        return ProfileApply((data & SETTINGS_REG_PROFILE_ACTIVE_MASK) >> SETTINGS_REG_PROFILE_ACTIVE_OFFS, staged);
+    }
 
-    uint32_t wordAddress = (uint32_t) &_eeprom;
-    uint32_t wordCount = SETTINGS_REGMAP_SIZE;
-    uint32_t * wordPtr = settingsRegMap;
+    if (address < SETTINGS_REGMAP_READONLYADDR) {
+        if (staged) {
+            Stage(address, data);
+            transactionTick = HAL_GetTick();
+        } else {
+            __disable_irq();
+            settingsRegMap[address] = data;
+            __enable_irq();
+        }
 
-    uint32_t magic = (*(__IO uint32_t *) wordAddress);
+        return 1;
+    }
+
+    return 0;
+}
+
+uint8_t Settings_RegWrite(uint8_t address, uint32_t data)
+{
+    return RegWrite(address, data, transactionActive);
+}
+
+uint8_t Settings_RegWriteImmediate(uint8_t address, uint32_t data)
+{
+    /* For writes that are not part of the host transaction, e.g. from the control CDC or KISS parameters */
+    return RegWrite(address, data, 0);
+}
 
-    if ( magic == SETTINGS_REG_MAGIC_DEFAULT ) {
-        while (wordCount--) {
-            *wordPtr++ = *(__IO uint32_t *) wordAddress;
-            wordAddress += sizeof(uint32_t);
+uint8_t Settings_RegWriteBlock(uint8_t address, const uint32_t * data, uint16_t count)
+{
+    /* Apply a block of registers atomically, unless it is already part of an open transaction */
+    uint8_t nested = transactionActive;
+    uint8_t success = 1;
+
+    if (!nested) {
+        Settings_Begin();
+    }
+
+    for (uint16_t i = 0; (i < count) && ((address + i) < SETTINGS_REGMAP_SIZE); i++) {
+        success &= Settings_RegWrite(address + i, data[i]);
+    }
+
+    if (!nested) {
+        Settings_Commit();
+    }
+
+    return success;
+}
+
+uint8_t Settings_RegRead(uint8_t address, uint32_t * data)
+{
+    if (address < SETTINGS_REGMAP_SIZE) {
+        __disable_irq();
+        *data = settingsRegMap[address];
+        __enable_irq();
+
+        return 1;
+    }
+
+    return 0;
+}
+
+void Settings_Begin(void)
+{
+    /* Only registers written in the transaction are committed, all others stay untouched.
+     * Beginning again while a transaction is open discards the staged writes. */
+    __disable_irq();
+    memset(transactionDirty, 0, sizeof(transactionDirty));
+    transactionActive = 1;
+    __enable_irq();
+
+    transactionTick = HAL_GetTick();
+    TransactionState(SETTINGS_REG_INFO_AIOC1_TRANSACTION_OPEN_ENUM);
+}
+
+void Settings_Commit(void)
+{
+    if (transactionActive) {
+        /* Swap in all staged registers at once */
+        __disable_irq();
+        for (uint8_t i = 0; i < SETTINGS_REGMAP_READONLYADDR; i++) {
+            if (transactionDirty[i / 32] & (1UL << (i % 32))) {
+                settingsRegMap[i] = settingsShadow[i];
+            }
         }
+        transactionActive = 0;
+        __enable_irq();
+
+        TransactionState(SETTINGS_REG_INFO_AIOC1_TRANSACTION_COMMITTED_ENUM);
+    }
+}
+
+void Settings_Abort(void)
+{
+    if (transactionActive) {
+        /* The staged writes are simply dropped, the live register map has not been touched */
+        transactionActive = 0;
+        TransactionState(SETTINGS_REG_INFO_AIOC1_TRANSACTION_ABORTED_ENUM);
+    }
+}
+
+void Settings_Store(void)
+{
+    ImageWrite(settingsROM.regMap, settingsRegMap, SETTINGS_REGMAP_SIZE);
+}
+
+void Settings_Recall(void)
+{
+    uint32_t version = ImageVersion(settingsROM.regMap);
+
+    transactionActive = 0;
+
+    if (version == SETTINGS_LAYOUT_VERSION) {
+        memcpy(settingsRegMap, settingsROM.regMap, sizeof(settingsRegMap));
+        InfoUpdate(SETTINGS_REG_INFO_AIOC1_RECALL_OK_ENUM);
+    } else if (version != UINT32_MAX) {
+        memcpy(settingsRegMap, settingsROM.regMap, sizeof(settingsRegMap));
+        Migrate(version);
+        InfoUpdate(SETTINGS_REG_INFO_AIOC1_RECALL_MIGRATED_ENUM);
+    } else if (settingsROM.regMap[SETTINGS_REG_MAGIC] == SETTINGS_REG_MAGIC_DEFAULT) {
+        /* Magic token found, but the image did not pass the integrity check */
+        Settings_Default();
+        InfoUpdate(SETTINGS_REG_INFO_AIOC1_RECALL_CORRUPT_ENUM);
     } else {
         /* Magic token not found, assume flash is unprogrammed */
         Settings_Default();
     }
 
+    /* Images stored by older firmware may still carry the command bit */
+    settingsRegMap[SETTINGS_REG_SERIAL_BENCH] &= ~SETTINGS_REG_SERIAL_BENCH_RUN_MASK;
+}
+
+uint8_t Settings_ProfileLoad(uint8_t slot)
+{
+    return ProfileApply(slot, transactionActive);
+}
+
+void Settings_ProfileStore(void)
+{
+    uint8_t slot = SETTINGS_GET(SETTINGS_REG_PROFILE, ACTIVE);
+
+    if (slot < SETTINGS_PROFILE_COUNT) {
+        ImageWrite(settingsROM.profile[slot], settingsRegMap, SETTINGS_REGMAP_READONLYADDR);
+        InfoUpdate(UINT32_MAX);
+    }
 }
 
 void Settings_Default(void)
 {
+    /* Defaults override anything that has been staged */
+    transactionActive = 0;
+
     settingsRegMap[SETTINGS_REG_MAGIC] = SETTINGS_REG_MAGIC_DEFAULT;
+    settingsRegMap[SETTINGS_REG_PROFILE] = SETTINGS_REG_PROFILE_DEFAULT;
     settingsRegMap[SETTINGS_REG_USBID] = SETTINGS_REG_USBID_DEFAULT;
 
     /* AIOC registers */
     settingsRegMap[SETTINGS_REG_AIOC_IOMUX0] = SETTINGS_REG_AIOC_IOMUX0_DEFAULT;
     settingsRegMap[SETTINGS_REG_AIOC_IOMUX1] = SETTINGS_REG_AIOC_IOMUX1_DEFAULT;
+    settingsRegMap[SETTINGS_REG_AIOC_MEMCTRL] = SETTINGS_REG_AIOC_MEMCTRL_DEFAULT;
 
     /* CM108 registers */
     settingsRegMap[SETTINGS_REG_CM108_IOMUX0] = SETTINGS_REG_CM108_IOMUX0_DEFAULT;
@@ -115,8 +490,16 @@ void Settings_Default(void)
     settingsRegMap[SETTINGS_REG_CM108_IOMUX2] = SETTINGS_REG_CM108_IOMUX2_DEFAULT;
     settingsRegMap[SETTINGS_REG_CM108_IOMUX3] = SETTINGS_REG_CM108_IOMUX3_DEFAULT;
 
+    /* HID registers */
+    settingsRegMap[SETTINGS_REG_HID_TELEMETRY] = SETTINGS_REG_HID_TELEMETRY_DEFAULT;
+
+    /* Control CDC registers */
+    settingsRegMap[SETTINGS_REG_CTLCDC_CTRL] = SETTINGS_REG_CTLCDC_CTRL_DEFAULT;
+
     /* Serial (CDC) registers */
     settingsRegMap[SETTINGS_REG_SERIAL_CTRL] = SETTINGS_REG_SERIAL_CTRL_DEFAULT;
+    settingsRegMap[SETTINGS_REG_SERIAL_FLUSH] = SETTINGS_REG_SERIAL_FLUSH_DEFAULT;
+    settingsRegMap[SETTINGS_REG_SERIAL_BENCH] = SETTINGS_REG_SERIAL_BENCH_DEFAULT;
     settingsRegMap[SETTINGS_REG_SERIAL_IOMUX0] = SETTINGS_REG_SERIAL_IOMUX0_DEFAULT;
     settingsRegMap[SETTINGS_REG_SERIAL_IOMUX1] = SETTINGS_REG_SERIAL_IOMUX1_DEFAULT;
     settingsRegMap[SETTINGS_REG_SERIAL_IOMUX2] = SETTINGS_REG_SERIAL_IOMUX2_DEFAULT;
@@ -126,12 +509,24 @@ void Settings_Default(void)
     settingsRegMap[SETTINGS_REG_AUDIO_RX] = SETTINGS_REG_AUDIO_RX_DEFAULT;
     settingsRegMap[SETTINGS_REG_AUDIO_TX] = SETTINGS_REG_AUDIO_TX_DEFAULT;
 
+    /* Audio filter registers */
+    settingsRegMap[SETTINGS_REG_RXFILT_CTRL] = SETTINGS_REG_RXFILT_CTRL_DEFAULT;
+    settingsRegMap[SETTINGS_REG_TXFILT_CTRL] = SETTINGS_REG_TXFILT_CTRL_DEFAULT;
+    FilterDefault(SETTINGS_REG_RXFILT_COEF0, SETTINGS_REG_RXFILT_COEF_COUNT, SETTINGS_REG_RXFILT_COEF_B0_DEFAULT);
+    FilterDefault(SETTINGS_REG_TXFILT_COEF0, SETTINGS_REG_TXFILT_COEF_COUNT, SETTINGS_REG_TXFILT_COEF_B0_DEFAULT);
+
+    /* Limiter registers */
+    settingsRegMap[SETTINGS_REG_LIMIT_CTRL] = SETTINGS_REG_LIMIT_CTRL_DEFAULT;
+    settingsRegMap[SETTINGS_REG_LIMIT_COMP] = SETTINGS_REG_LIMIT_COMP_DEFAULT;
+
     /* Virtual PTT registers */
     settingsRegMap[SETTINGS_REG_VPTT_LVLCTRL] = SETTINGS_REG_VPTT_LVLCTRL_DEFAULT;
+    settingsRegMap[SETTINGS_REG_VPTT_VOXCTRL] = SETTINGS_REG_VPTT_VOXCTRL_DEFAULT;
     settingsRegMap[SETTINGS_REG_VPTT_TIMCTRL] = SETTINGS_REG_VPTT_TIMCTRL_DEFAULT;
 
     /* Virtual COS registers */
     settingsRegMap[SETTINGS_REG_VCOS_LVLCTRL] = SETTINGS_REG_VCOS_LVLCTRL_DEFAULT;
+    settingsRegMap[SETTINGS_REG_VCOS_VOXCTRL] = SETTINGS_REG_VCOS_VOXCTRL_DEFAULT;
     settingsRegMap[SETTINGS_REG_VCOS_TIMCTRL] = SETTINGS_REG_VCOS_TIMCTRL_DEFAULT;
 
     /* Fox Hunt registers */
@@ -141,8 +536,33 @@ void Settings_Default(void)
     settingsRegMap[SETTINGS_REG_FOXHUNT_MSG2] = SETTINGS_REG_FOXHUNT_MSG2_DEFAULT;
     settingsRegMap[SETTINGS_REG_FOXHUNT_MSG3] = SETTINGS_REG_FOXHUNT_MSG3_DEFAULT;
 
+    /* Modem registers */
+    settingsRegMap[SETTINGS_REG_MODEM_CTRL] = SETTINGS_REG_MODEM_CTRL_DEFAULT;
+    settingsRegMap[SETTINGS_REG_MODEM_TXCTRL] = SETTINGS_REG_MODEM_TXCTRL_DEFAULT;
+
+    /* Tone detection registers */
+    settingsRegMap[SETTINGS_REG_DTMF_CTRL] = SETTINGS_REG_DTMF_CTRL_DEFAULT;
+    settingsRegMap[SETTINGS_REG_CTCSS_CTRL] = SETTINGS_REG_CTCSS_CTRL_DEFAULT;
+    settingsRegMap[SETTINGS_REG_TXTONE_CTRL] = SETTINGS_REG_TXTONE_CTRL_DEFAULT;
+    settingsRegMap[SETTINGS_REG_TXTONE_CODE] = SETTINGS_REG_TXTONE_CODE_DEFAULT;
+
+    /* Pre-roll registers */
+    settingsRegMap[SETTINGS_REG_PREROLL_CTRL] = SETTINGS_REG_PREROLL_CTRL_DEFAULT;
+
     /* AIOC Debug registers */
     settingsRegMap[SETTINGS_REG_INFO_AIOC0] = SETTINGS_REG_INFO_AIOC0_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_AIOC1] = SETTINGS_REG_INFO_AIOC1_DEFAULT;
+    /* INFO_AIOC2/3 describe the buffer pool, which is partitioned once at boot and is left untouched */
+
+    /* Serial Debug registers */
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL0] = SETTINGS_REG_INFO_SERIAL0_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL1] = SETTINGS_REG_INFO_SERIAL1_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL2] = SETTINGS_REG_INFO_SERIAL2_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL3] = SETTINGS_REG_INFO_SERIAL3_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL4] = SETTINGS_REG_INFO_SERIAL4_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL5] = SETTINGS_REG_INFO_SERIAL5_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL6] = SETTINGS_REG_INFO_SERIAL6_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL7] = SETTINGS_REG_INFO_SERIAL7_DEFAULT;
 
     /* Audio Debug registers */
     settingsRegMap[SETTINGS_REG_INFO_AUDIO0] = SETTINGS_REG_INFO_AUDIO0_DEFAULT;
@@ -161,4 +581,30 @@ void Settings_Default(void)
     settingsRegMap[SETTINGS_REG_INFO_AUDIO13] = SETTINGS_REG_INFO_AUDIO13_DEFAULT;
     settingsRegMap[SETTINGS_REG_INFO_AUDIO14] = SETTINGS_REG_INFO_AUDIO14_DEFAULT;
     settingsRegMap[SETTINGS_REG_INFO_AUDIO15] = SETTINGS_REG_INFO_AUDIO15_DEFAULT;
+
+    /* Modem Debug registers */
+    settingsRegMap[SETTINGS_REG_INFO_MODEM0] = SETTINGS_REG_INFO_MODEM0_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_MODEM1] = SETTINGS_REG_INFO_MODEM1_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_MODEM2] = SETTINGS_REG_INFO_MODEM2_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_MODEM3] = SETTINGS_REG_INFO_MODEM3_DEFAULT;
+
+    /* Tone Debug registers */
+    settingsRegMap[SETTINGS_REG_INFO_TONE0] = SETTINGS_REG_INFO_TONE0_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_TONE1] = SETTINGS_REG_INFO_TONE1_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_DTMF0] = SETTINGS_REG_INFO_DTMF0_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_CTCSS0] = SETTINGS_REG_INFO_CTCSS0_DEFAULT;
+
+    /* Pre-roll Debug registers */
+    settingsRegMap[SETTINGS_REG_INFO_PREROLL0] = SETTINGS_REG_INFO_PREROLL0_DEFAULT;
+
+    /* Audio filter Debug registers */
+    settingsRegMap[SETTINGS_REG_INFO_FILTER0] = SETTINGS_REG_INFO_FILTER0_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_FILTER1] = SETTINGS_REG_INFO_FILTER1_DEFAULT;
+
+    /* Limiter Debug registers */
+    settingsRegMap[SETTINGS_REG_INFO_LIMIT0] = SETTINGS_REG_INFO_LIMIT0_DEFAULT;
+    settingsRegMap[SETTINGS_REG_INFO_LIMIT1] = SETTINGS_REG_INFO_LIMIT1_DEFAULT;
+
+    /* Reflect the profile slots present in flash */
+    InfoUpdate(SETTINGS_REG_INFO_AIOC1_RECALL_DEFAULT_ENUM);
 }
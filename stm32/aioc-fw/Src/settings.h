@@ -10,6 +10,15 @@
 #define SETTINGS_REGMAP_SIZE     256
 #define SETTINGS_REGMAP_READONLYADDR 0xC0
 
+/* Number of profile slots in flash. A profile holds the registers from SETTINGS_PROFILE_FIRSTADDR
+ * up to the read-only area, i.e. everything except the device-wide registers below. */
+#define SETTINGS_PROFILE_COUNT       4
+#define SETTINGS_PROFILE_FIRSTADDR   0x10
+
+/* Layout version of the stored settings image. Increment when registers are added or their meaning changes,
+ * and add the corresponding step to the migration in settings.c */
+#define SETTINGS_LAYOUT_VERSION      14
+
 extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 
 /* Magic number register. Mainly used to see if flash data is valid */
@@ -19,6 +28,14 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
                                                               (((uint32_t) 'O') << 16) | \
                                                               (((uint32_t) 'C') << 24) )
 
+/* Settings profile register */
+#define SETTINGS_REG_PROFILE                                0x04
+#define SETTINGS_REG_PROFILE_DEFAULT                        (SETTINGS_REG_PROFILE_ACTIVE_DFLT)
+/* ACTIVE: Active profile slot. Writing applies the stored profile immediately. Selecting an empty slot keeps the current settings */
+#define SETTINGS_REG_PROFILE_ACTIVE_DFLT                    ((uint32_t) 0 << SETTINGS_REG_PROFILE_ACTIVE_OFFS)
+#define SETTINGS_REG_PROFILE_ACTIVE_OFFS                    0
+#define SETTINGS_REG_PROFILE_ACTIVE_MASK                    0x000000FFUL
+
 /* USB ID register. The default USB VID and PID can be overwritten. Use with caution */
 #define SETTINGS_REG_USBID                                  0x08
 #define SETTINGS_REG_USBID_DEFAULT                          (SETTINGS_REG_USBID_VID_DFLT | SETTINGS_REG_USBID_PID_DFLT)
@@ -31,6 +48,12 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 #define SETTINGS_REG_USBID_PID_OFFS                         16
 #define SETTINGS_REG_USBID_PID_MASK                         0xFFFF0000UL
 
+/* Capture filter coefficient registers. Three biquad sections of b0, b1, b2, a1, a2 (in this order) in signed Q3.28 format,
+ * with H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2). Used by the CUSTOM preset. Default is pass-through */
+#define SETTINGS_REG_RXFILT_COEF0                           0x10
+#define SETTINGS_REG_RXFILT_COEF_COUNT                      15
+#define SETTINGS_REG_RXFILT_COEF_B0_DEFAULT                 ((uint32_t) 1 << 28)
+
 /* AIOC IOMUX0 register */
 #define SETTINGS_REG_AIOC_IOMUX0                            0x24
 #define SETTINGS_REG_AIOC_IOMUX0_DEFAULT                    (SETTINGS_REG_AIOC_IOMUX0_OUT1SRC_DFLT)
@@ -67,6 +90,23 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 #define SETTINGS_REG_AIOC_IOMUX1_OUT2SRC_SERIALNDTRRTS_MASK SETTINGS_REG_AIOC_IOMUX0_OUT1SRC_SERIALNDTRRTS_MASK
 #define SETTINGS_REG_AIOC_IOMUX1_OUT2SRC_VPTT_MASK          SETTINGS_REG_AIOC_IOMUX0_OUT1SRC_VPTT_MASK
 
+/* AIOC memory control register */
+#define SETTINGS_REG_AIOC_MEMCTRL                           0x28
+#define SETTINGS_REG_AIOC_MEMCTRL_DEFAULT                   (SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_DFLT)
+/* POOLMODE: Partitioning of the shared buffer pool. Takes effect on next reboot */
+#define SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_DFLT             (SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_BALANCED_ENUM << SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_OFFS)
+#define SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_OFFS             0
+#define SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_MASK             0x0000000FUL
+#define SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_BALANCED_ENUM    0x0 /* Serial and audio processing */
+#define SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_SERIAL_ENUM      0x1 /* Deep serial buffers, e.g. for radio programming */
+#define SETTINGS_REG_AIOC_MEMCTRL_POOLMODE_AUDIO_ENUM       0x2 /* Most memory for audio processing, e.g. for modem use */
+
+/* Playback filter coefficient registers. Three biquad sections of b0, b1, b2, a1, a2 (in this order) in signed Q3.28 format,
+ * with H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2). Used by the CUSTOM preset. Default is pass-through */
+#define SETTINGS_REG_TXFILT_COEF0                           0x30
+#define SETTINGS_REG_TXFILT_COEF_COUNT                      15
+#define SETTINGS_REG_TXFILT_COEF_B0_DEFAULT                 ((uint32_t) 1 << 28)
+
 /* CM108 IOMUX0 register */
 #define SETTINGS_REG_CM108_IOMUX0                           0x44
 #define SETTINGS_REG_CM108_IOMUX0_DEFAULT                   (SETTINGS_REG_CM108_IOMUX0_BTN1SRC_DFLT)
@@ -115,9 +155,40 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 #define SETTINGS_REG_CM108_IOMUX3_BTN4SRC_IN2_MASK          SETTINGS_REG_CM108_IOMUX0_BTN1SRC_IN2_MASK
 #define SETTINGS_REG_CM108_IOMUX3_BTN4SRC_VCOS_MASK         SETTINGS_REG_CM108_IOMUX0_BTN1SRC_VCOS_MASK
 
+/* HID telemetry control register */
+#define SETTINGS_REG_HID_TELEMETRY                          0x48
+#define SETTINGS_REG_HID_TELEMETRY_DEFAULT                  (SETTINGS_REG_HID_TELEMETRY_INTERVAL_DFLT)
+/* INTERVAL: Telemetry input report interval in milliseconds. 0 disables telemetry. Enabling/disabling takes effect on next reboot */
+#define SETTINGS_REG_HID_TELEMETRY_INTERVAL_DFLT            ((uint32_t) 0 << SETTINGS_REG_HID_TELEMETRY_INTERVAL_OFFS)
+#define SETTINGS_REG_HID_TELEMETRY_INTERVAL_OFFS            0
+#define SETTINGS_REG_HID_TELEMETRY_INTERVAL_MASK            0x0000FFFFUL
+
+/* Control CDC register */
+#define SETTINGS_REG_CTLCDC_CTRL                            0x50
+#define SETTINGS_REG_CTLCDC_CTRL_DEFAULT                    (SETTINGS_REG_CTLCDC_CTRL_ENABLE_DFLT | SETTINGS_REG_CTLCDC_CTRL_PROTOCOL_DFLT)
+/* ENABLE: Expose a second CDC interface with a line-based control protocol. Takes effect on next reboot */
+#define SETTINGS_REG_CTLCDC_CTRL_ENABLE_DFLT                ((uint32_t) 0 << SETTINGS_REG_CTLCDC_CTRL_ENABLE_OFFS)
+#define SETTINGS_REG_CTLCDC_CTRL_ENABLE_OFFS                0
+#define SETTINGS_REG_CTLCDC_CTRL_ENABLE_MASK                0x00000001UL
+/* PROTOCOL: Protocol spoken on the control CDC. KISS connects it to the on-device modem */
+#define SETTINGS_REG_CTLCDC_CTRL_PROTOCOL_DFLT              (SETTINGS_REG_CTLCDC_CTRL_PROTOCOL_LINE_ENUM << SETTINGS_REG_CTLCDC_CTRL_PROTOCOL_OFFS)
+#define SETTINGS_REG_CTLCDC_CTRL_PROTOCOL_OFFS              4
+#define SETTINGS_REG_CTLCDC_CTRL_PROTOCOL_MASK              0x000000F0UL
+#define SETTINGS_REG_CTLCDC_CTRL_PROTOCOL_LINE_ENUM         0x0
+#define SETTINGS_REG_CTLCDC_CTRL_PROTOCOL_KISS_ENUM         0x1
+
 /* Serial (CDC) Control register */
 #define SETTINGS_REG_SERIAL_CTRL                            0x60
-#define SETTINGS_REG_SERIAL_CTRL_DEFAULT                    (SETTINGS_REG_SERIAL_CTRL_TXFRCPTT_DFLT | SETTINGS_REG_SERIAL_CTRL_RXIGNPTT_DFLT)
+#define SETTINGS_REG_SERIAL_CTRL_DEFAULT                    (SETTINGS_REG_SERIAL_CTRL_DUPLEX_DFLT | SETTINGS_REG_SERIAL_CTRL_TXFRCPTT_DFLT | SETTINGS_REG_SERIAL_CTRL_RXIGNPTT_DFLT)
+/* DUPLEX: Full duplex on separate TX/RX pins, or half duplex on the TX pin only with self-echo suppressed. Applied when the host sets the line coding */
+#define SETTINGS_REG_SERIAL_CTRL_DUPLEX_DFLT                (SETTINGS_REG_SERIAL_CTRL_DUPLEX_FULL_ENUM << SETTINGS_REG_SERIAL_CTRL_DUPLEX_OFFS)
+#define SETTINGS_REG_SERIAL_CTRL_DUPLEX_OFFS                0
+#define SETTINGS_REG_SERIAL_CTRL_DUPLEX_MASK                0x0000000FUL
+#define SETTINGS_REG_SERIAL_CTRL_DUPLEX_FULL_ENUM           0x0
+#define SETTINGS_REG_SERIAL_CTRL_DUPLEX_HALF_ENUM           0x1
+/* CAPTURE: Records the serial traffic in both directions for readout via the vendor interface */
+#define SETTINGS_REG_SERIAL_CTRL_CAPTURE_OFFS               4
+#define SETTINGS_REG_SERIAL_CTRL_CAPTURE_MASK               0x00000010UL
 /* TXFRCPTT: Forces PTT signal(s) to zero when transmitting serial data to radio if enabled */
 #define SETTINGS_REG_SERIAL_CTRL_TXFRCPTT_DFLT              (SETTINGS_REG_SERIAL_CTRL_TXFRCPTT_PTT1_MASK)
 #define SETTINGS_REG_SERIAL_CTRL_TXFRCPTT_OFFS              8
@@ -133,6 +204,48 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 #define SETTINGS_REG_SERIAL_CTRL_RXIGNPTT_PTT1_MASK         0x00010000UL
 #define SETTINGS_REG_SERIAL_CTRL_RXIGNPTT_PTT2_MASK         0x00020000UL
 
+/* Serial receive flush policy register. Received data is flushed to the host on whichever condition comes first */
+#define SETTINGS_REG_SERIAL_FLUSH                           0x61
+#define SETTINGS_REG_SERIAL_FLUSH_DEFAULT                   (SETTINGS_REG_SERIAL_FLUSH_RXTIMEOUT_DFLT | SETTINGS_REG_SERIAL_FLUSH_FILL_DFLT | SETTINGS_REG_SERIAL_FLUSH_MAXLAT_DFLT)
+/* RXTIMEOUT: Idle time on the receive line in bit times */
+#define SETTINGS_REG_SERIAL_FLUSH_RXTIMEOUT_DFLT            ((uint32_t) 20 << SETTINGS_REG_SERIAL_FLUSH_RXTIMEOUT_OFFS)
+#define SETTINGS_REG_SERIAL_FLUSH_RXTIMEOUT_OFFS            0
+#define SETTINGS_REG_SERIAL_FLUSH_RXTIMEOUT_MASK            0x000000FFUL
+/* FILL: Number of pending bytes (0: full USB packet only) */
+#define SETTINGS_REG_SERIAL_FLUSH_FILL_DFLT                 ((uint32_t) 0 << SETTINGS_REG_SERIAL_FLUSH_FILL_OFFS)
+#define SETTINGS_REG_SERIAL_FLUSH_FILL_OFFS                 8
+#define SETTINGS_REG_SERIAL_FLUSH_FILL_MASK                 0x0000FF00UL
+/* MAXLAT: Maximum time in ms data is held back (0: disabled) */
+#define SETTINGS_REG_SERIAL_FLUSH_MAXLAT_DFLT               ((uint32_t) 0 << SETTINGS_REG_SERIAL_FLUSH_MAXLAT_OFFS)
+#define SETTINGS_REG_SERIAL_FLUSH_MAXLAT_OFFS               16
+#define SETTINGS_REG_SERIAL_FLUSH_MAXLAT_MASK               0x00FF0000UL
+
+/* Serial benchmark register. Runs a throughput and integrity test through a half duplex or an external (jumper TX to RX) loopback.
+ * Both drive the test pattern onto the TX pin, so the radio must be disconnected while the test runs */
+#define SETTINGS_REG_SERIAL_BENCH                           0x62
+#define SETTINGS_REG_SERIAL_BENCH_DEFAULT                   (SETTINGS_REG_SERIAL_BENCH_BAUD_DFLT | SETTINGS_REG_SERIAL_BENCH_PATTERN_DFLT | SETTINGS_REG_SERIAL_BENCH_LOOP_DFLT)
+/* BAUD: Baudrate for the test */
+#define SETTINGS_REG_SERIAL_BENCH_BAUD_DFLT                 ((uint32_t) 115200 << SETTINGS_REG_SERIAL_BENCH_BAUD_OFFS)
+#define SETTINGS_REG_SERIAL_BENCH_BAUD_OFFS                 0
+#define SETTINGS_REG_SERIAL_BENCH_BAUD_MASK                 0x00FFFFFFUL
+/* PATTERN: Test data pattern */
+#define SETTINGS_REG_SERIAL_BENCH_PATTERN_DFLT              (SETTINGS_REG_SERIAL_BENCH_PATTERN_PRBS9_ENUM << SETTINGS_REG_SERIAL_BENCH_PATTERN_OFFS)
+#define SETTINGS_REG_SERIAL_BENCH_PATTERN_OFFS              24
+#define SETTINGS_REG_SERIAL_BENCH_PATTERN_MASK              0x03000000UL
+#define SETTINGS_REG_SERIAL_BENCH_PATTERN_PRBS9_ENUM        0x0
+#define SETTINGS_REG_SERIAL_BENCH_PATTERN_COUNT_ENUM        0x1
+#define SETTINGS_REG_SERIAL_BENCH_PATTERN_ALT_ENUM          0x2
+/* LOOP: Loopback path. NORADIO loops back through the TX pin in half duplex mode, which needs no jumper but still
+ * drives the pin (the UART cannot loop back internally without it). Only use it with the radio unplugged. */
+#define SETTINGS_REG_SERIAL_BENCH_LOOP_DFLT                 (SETTINGS_REG_SERIAL_BENCH_LOOP_NORADIO_ENUM << SETTINGS_REG_SERIAL_BENCH_LOOP_OFFS)
+#define SETTINGS_REG_SERIAL_BENCH_LOOP_OFFS                 28
+#define SETTINGS_REG_SERIAL_BENCH_LOOP_MASK                 0x10000000UL
+#define SETTINGS_REG_SERIAL_BENCH_LOOP_NORADIO_ENUM         0x0
+#define SETTINGS_REG_SERIAL_BENCH_LOOP_EXTERNAL_ENUM        0x1
+/* RUN: Write 1 to start the test. Cleared when the test has finished, never stored to flash */
+#define SETTINGS_REG_SERIAL_BENCH_RUN_OFFS                  31
+#define SETTINGS_REG_SERIAL_BENCH_RUN_MASK                  0x80000000UL
+
 /* Serial (CDC) IOMUX0 register */
 #define SETTINGS_REG_SERIAL_IOMUX0                          0x64
 #define SETTINGS_REG_SERIAL_IOMUX0_DEFAULT                  (SETTINGS_REG_SERIAL_IOMUX0_DCDSRC_DFLT)
@@ -194,6 +307,23 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 #define SETTINGS_REG_AUDIO_RX_RXGAIN_8X_ENUM                0x3
 #define SETTINGS_REG_AUDIO_RX_RXGAIN_16X_ENUM               0x4
 
+/* Capture filter control register */
+#define SETTINGS_REG_RXFILT_CTRL                            0x74
+#define SETTINGS_REG_RXFILT_CTRL_DEFAULT                    (SETTINGS_REG_RXFILT_CTRL_PRESET_DFLT | SETTINGS_REG_RXFILT_CTRL_SECTIONS_DFLT)
+/* PRESET: Filter applied to the capture audio (in blocks of FILTER_BLOCK_LEN samples). Presets follow the sample rate */
+#define SETTINGS_REG_RXFILT_CTRL_PRESET_DFLT                (SETTINGS_REG_RXFILT_CTRL_PRESET_OFF_ENUM << SETTINGS_REG_RXFILT_CTRL_PRESET_OFFS)
+#define SETTINGS_REG_RXFILT_CTRL_PRESET_OFFS                0
+#define SETTINGS_REG_RXFILT_CTRL_PRESET_MASK                0x0000000FUL
+#define SETTINGS_REG_RXFILT_CTRL_PRESET_OFF_ENUM            0x0
+#define SETTINGS_REG_RXFILT_CTRL_PRESET_CUSTOM_ENUM         0x1 /* Coefficients from the RXFILT_COEF registers */
+#define SETTINGS_REG_RXFILT_CTRL_PRESET_DEEMPH_ENUM         0x2 /* -6 dB/oct de-emphasis between 300 Hz and 3 kHz, 0 dB at 1 kHz */
+#define SETTINGS_REG_RXFILT_CTRL_PRESET_PREEMPH_ENUM        0x3 /* +6 dB/oct pre-emphasis between 300 Hz and 3 kHz, 0 dB at 1 kHz */
+#define SETTINGS_REG_RXFILT_CTRL_PRESET_CTCSSREJECT_ENUM    0x4 /* 6th order Butterworth high pass at 300 Hz */
+/* SECTIONS: Number of biquad sections used by the CUSTOM preset */
+#define SETTINGS_REG_RXFILT_CTRL_SECTIONS_DFLT              ((uint32_t) 3 << SETTINGS_REG_RXFILT_CTRL_SECTIONS_OFFS)
+#define SETTINGS_REG_RXFILT_CTRL_SECTIONS_OFFS              8
+#define SETTINGS_REG_RXFILT_CTRL_SECTIONS_MASK              0x00000F00UL
+
 /* Audio TX settings register */
 #define SETTINGS_REG_AUDIO_TX                               0x78
 #define SETTINGS_REG_AUDIO_TX_DEFAULT                       0
@@ -201,14 +331,88 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 #define SETTINGS_REG_AUDIO_TX_TXBOOST_OFFS                  8
 #define SETTINGS_REG_AUDIO_TX_TXBOOST_MASK                  (1UL << SETTINGS_REG_AUDIO_TX_TXBOOST_OFFS)
 
+/* Playback filter control register */
+#define SETTINGS_REG_TXFILT_CTRL                            0x7A
+#define SETTINGS_REG_TXFILT_CTRL_DEFAULT                    (SETTINGS_REG_TXFILT_CTRL_PRESET_DFLT | SETTINGS_REG_TXFILT_CTRL_SECTIONS_DFLT)
+/* PRESET: Filter applied to the playback audio (in blocks of FILTER_BLOCK_LEN samples). Presets follow the sample rate */
+#define SETTINGS_REG_TXFILT_CTRL_PRESET_DFLT                (SETTINGS_REG_TXFILT_CTRL_PRESET_OFF_ENUM << SETTINGS_REG_TXFILT_CTRL_PRESET_OFFS)
+#define SETTINGS_REG_TXFILT_CTRL_PRESET_OFFS                0
+#define SETTINGS_REG_TXFILT_CTRL_PRESET_MASK                0x0000000FUL
+#define SETTINGS_REG_TXFILT_CTRL_PRESET_OFF_ENUM            0x0
+#define SETTINGS_REG_TXFILT_CTRL_PRESET_CUSTOM_ENUM         0x1 /* Coefficients from the TXFILT_COEF registers */
+#define SETTINGS_REG_TXFILT_CTRL_PRESET_DEEMPH_ENUM         0x2 /* -6 dB/oct de-emphasis between 300 Hz and 3 kHz, 0 dB at 1 kHz */
+#define SETTINGS_REG_TXFILT_CTRL_PRESET_PREEMPH_ENUM        0x3 /* +6 dB/oct pre-emphasis between 300 Hz and 3 kHz, 0 dB at 1 kHz */
+#define SETTINGS_REG_TXFILT_CTRL_PRESET_CTCSSREJECT_ENUM    0x4 /* 6th order Butterworth high pass at 300 Hz */
+/* SECTIONS: Number of biquad sections used by the CUSTOM preset */
+#define SETTINGS_REG_TXFILT_CTRL_SECTIONS_DFLT              ((uint32_t) 3 << SETTINGS_REG_TXFILT_CTRL_SECTIONS_OFFS)
+#define SETTINGS_REG_TXFILT_CTRL_SECTIONS_OFFS              8
+#define SETTINGS_REG_TXFILT_CTRL_SECTIONS_MASK              0x00000F00UL
+
+/* Playback limiter control register */
+#define SETTINGS_REG_LIMIT_CTRL                             0x7B
+#define SETTINGS_REG_LIMIT_CTRL_DEFAULT                     (SETTINGS_REG_LIMIT_CTRL_MODE_DFLT | SETTINGS_REG_LIMIT_CTRL_RELEASE_DFLT | SETTINGS_REG_LIMIT_CTRL_CEILING_DFLT)
+/* MODE: Dynamics processing of the playback audio after the USB volume, with 1 ms of lookahead */
+#define SETTINGS_REG_LIMIT_CTRL_MODE_DFLT                   (SETTINGS_REG_LIMIT_CTRL_MODE_OFF_ENUM << SETTINGS_REG_LIMIT_CTRL_MODE_OFFS)
+#define SETTINGS_REG_LIMIT_CTRL_MODE_OFFS                   0
+#define SETTINGS_REG_LIMIT_CTRL_MODE_MASK                   0x0000000FUL
+#define SETTINGS_REG_LIMIT_CTRL_MODE_OFF_ENUM               0x0
+#define SETTINGS_REG_LIMIT_CTRL_MODE_LIMIT_ENUM             0x1 /* Peak limiter */
+#define SETTINGS_REG_LIMIT_CTRL_MODE_COMPRESS_ENUM          0x2 /* Soft-knee compressor (LIMIT_COMP) followed by the peak limiter */
+/* RELEASE: Release time constant in milliseconds */
+#define SETTINGS_REG_LIMIT_CTRL_RELEASE_DFLT                ((uint32_t) 50 << SETTINGS_REG_LIMIT_CTRL_RELEASE_OFFS)
+#define SETTINGS_REG_LIMIT_CTRL_RELEASE_OFFS                8
+#define SETTINGS_REG_LIMIT_CTRL_RELEASE_MASK                0x0000FF00UL
+/* CEILING: Maximum peak amplitude in raw playback sample units, at most 32767 */
+#define SETTINGS_REG_LIMIT_CTRL_CEILING_DFLT                ((uint32_t) 29204 << SETTINGS_REG_LIMIT_CTRL_CEILING_OFFS) /* -1 dBFS */
+#define SETTINGS_REG_LIMIT_CTRL_CEILING_OFFS                16
+#define SETTINGS_REG_LIMIT_CTRL_CEILING_MASK                0xFFFF0000UL
+
+/* Playback compressor register */
+#define SETTINGS_REG_LIMIT_COMP                             0x7C
+#define SETTINGS_REG_LIMIT_COMP_DEFAULT                     (SETTINGS_REG_LIMIT_COMP_THRESHOLD_DFLT | SETTINGS_REG_LIMIT_COMP_RATIO_DFLT | SETTINGS_REG_LIMIT_COMP_KNEE_DFLT | SETTINGS_REG_LIMIT_COMP_MAKEUP_DFLT)
+/* THRESHOLD: Compression threshold in dB below full scale */
+#define SETTINGS_REG_LIMIT_COMP_THRESHOLD_DFLT              ((uint32_t) 18 << SETTINGS_REG_LIMIT_COMP_THRESHOLD_OFFS)
+#define SETTINGS_REG_LIMIT_COMP_THRESHOLD_OFFS              0
+#define SETTINGS_REG_LIMIT_COMP_THRESHOLD_MASK              0x000000FFUL
+/* RATIO: Compression ratio above the threshold in units of 0.1 (e.g. 40 for 4:1) */
+#define SETTINGS_REG_LIMIT_COMP_RATIO_DFLT                  ((uint32_t) 40 << SETTINGS_REG_LIMIT_COMP_RATIO_OFFS)
+#define SETTINGS_REG_LIMIT_COMP_RATIO_OFFS                  8
+#define SETTINGS_REG_LIMIT_COMP_RATIO_MASK                  0x0000FF00UL
+/* KNEE: Width of the soft knee around the threshold in dB. 0 is a hard knee */
+#define SETTINGS_REG_LIMIT_COMP_KNEE_DFLT                   ((uint32_t) 6 << SETTINGS_REG_LIMIT_COMP_KNEE_OFFS)
+#define SETTINGS_REG_LIMIT_COMP_KNEE_OFFS                   16
+#define SETTINGS_REG_LIMIT_COMP_KNEE_MASK                   0x00FF0000UL
+/* MAKEUP: Gain in dB applied after compression, at most 24 */
+#define SETTINGS_REG_LIMIT_COMP_MAKEUP_DFLT                 ((uint32_t) 0 << SETTINGS_REG_LIMIT_COMP_MAKEUP_OFFS)
+#define SETTINGS_REG_LIMIT_COMP_MAKEUP_OFFS                 24
+#define SETTINGS_REG_LIMIT_COMP_MAKEUP_MASK                 0xFF000000UL
+
 /* Virtual PTT level control register */
 #define SETTINGS_REG_VPTT_LVLCTRL                           0x82
 #define SETTINGS_REG_VPTT_LVLCTRL_DEFAULT                   (SETTINGS_REG_VPTT_LVLCTRL_THRSHLD_DFLT)
-/* THRSHLD: Virtual PTT threshold level */
+/* THRSHLD: Virtual PTT threshold level. In envelope mode, this is the attack level of the mean absolute value */
 #define SETTINGS_REG_VPTT_LVLCTRL_THRSHLD_DFLT              ((uint32_t) 16 << SETTINGS_REG_VPTT_LVLCTRL_THRSHLD_OFFS)
 #define SETTINGS_REG_VPTT_LVLCTRL_THRSHLD_OFFS              0
 #define SETTINGS_REG_VPTT_LVLCTRL_THRSHLD_MASK              0x0000FFFFUL
 
+/* Virtual VPTT voice operated switch control register */
+#define SETTINGS_REG_VPTT_VOXCTRL                           0x83
+#define SETTINGS_REG_VPTT_VOXCTRL_DEFAULT                   (SETTINGS_REG_VPTT_VOXCTRL_MODE_DFLT | SETTINGS_REG_VPTT_VOXCTRL_ATTACK_DFLT | SETTINGS_REG_VPTT_VOXCTRL_RELEASE_DFLT)
+/* MODE: Detector mode. Peak triggers on any single sample above the threshold, envelope uses the mean absolute value of 1 ms blocks */
+#define SETTINGS_REG_VPTT_VOXCTRL_MODE_DFLT                 SETTINGS_REG_VPTT_VOXCTRL_MODE_ENVELOPE_ENUM
+#define SETTINGS_REG_VPTT_VOXCTRL_MODE_OFFS                 0
+#define SETTINGS_REG_VPTT_VOXCTRL_MODE_MASK                 0x0000000FUL
+#define SETTINGS_REG_VPTT_VOXCTRL_MODE_PEAK_ENUM            ((uint32_t) 0 << SETTINGS_REG_VPTT_VOXCTRL_MODE_OFFS)
+#define SETTINGS_REG_VPTT_VOXCTRL_MODE_ENVELOPE_ENUM        ((uint32_t) 1 << SETTINGS_REG_VPTT_VOXCTRL_MODE_OFFS)
+/* ATTACK: Time in milliseconds the envelope has to stay above the threshold level before triggering */
+#define SETTINGS_REG_VPTT_VOXCTRL_ATTACK_DFLT               ((uint32_t) 1 << SETTINGS_REG_VPTT_VOXCTRL_ATTACK_OFFS)
+#define SETTINGS_REG_VPTT_VOXCTRL_ATTACK_OFFS               8
+#define SETTINGS_REG_VPTT_VOXCTRL_ATTACK_MASK               0x0000FF00UL
+/* RELEASE: Envelope level that retriggers the timeout (trailing) time while active. Should be below the threshold level for hysteresis */
+#define SETTINGS_REG_VPTT_VOXCTRL_RELEASE_DFLT              ((uint32_t) 8 << SETTINGS_REG_VPTT_VOXCTRL_RELEASE_OFFS)
+#define SETTINGS_REG_VPTT_VOXCTRL_RELEASE_OFFS              16
+#define SETTINGS_REG_VPTT_VOXCTRL_RELEASE_MASK              0xFFFF0000UL
+
 /* Virtual PTT timing control register */
 #define SETTINGS_REG_VPTT_TIMCTRL                           0x84
 #define SETTINGS_REG_VPTT_TIMCTRL_DEFAULT                   (SETTINGS_REG_VPTT_TIMCTRL_TIMEOUT_DFLT)
@@ -220,11 +424,29 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 /* Virtual COS level control register */
 #define SETTINGS_REG_VCOS_LVLCTRL                           0x92
 #define SETTINGS_REG_VCOS_LVLCTRL_DEFAULT                   (SETTINGS_REG_VCOS_LVLCTRL_THRSHLD_DFLT)
-/* THRSHLD: Virtual COS threshold level */
+/* THRSHLD: Virtual COS threshold level. In envelope mode, this is the attack level of the mean absolute value */
 #define SETTINGS_REG_VCOS_LVLCTRL_THRSHLD_DFLT              ((uint32_t) 256 << SETTINGS_REG_VCOS_LVLCTRL_THRSHLD_OFFS)
 #define SETTINGS_REG_VCOS_LVLCTRL_THRSHLD_OFFS              0
 #define SETTINGS_REG_VCOS_LVLCTRL_THRSHLD_MASK              0x0000FFFFUL
 
+/* Virtual VCOS voice operated switch control register */
+#define SETTINGS_REG_VCOS_VOXCTRL                           0x93
+#define SETTINGS_REG_VCOS_VOXCTRL_DEFAULT                   (SETTINGS_REG_VCOS_VOXCTRL_MODE_DFLT | SETTINGS_REG_VCOS_VOXCTRL_ATTACK_DFLT | SETTINGS_REG_VCOS_VOXCTRL_RELEASE_DFLT)
+/* MODE: Detector mode. Peak triggers on any single sample above the threshold, envelope uses the mean absolute value of 1 ms blocks */
+#define SETTINGS_REG_VCOS_VOXCTRL_MODE_DFLT                 SETTINGS_REG_VCOS_VOXCTRL_MODE_ENVELOPE_ENUM
+#define SETTINGS_REG_VCOS_VOXCTRL_MODE_OFFS                 0
+#define SETTINGS_REG_VCOS_VOXCTRL_MODE_MASK                 0x0000000FUL
+#define SETTINGS_REG_VCOS_VOXCTRL_MODE_PEAK_ENUM            ((uint32_t) 0 << SETTINGS_REG_VCOS_VOXCTRL_MODE_OFFS)
+#define SETTINGS_REG_VCOS_VOXCTRL_MODE_ENVELOPE_ENUM        ((uint32_t) 1 << SETTINGS_REG_VCOS_VOXCTRL_MODE_OFFS)
+/* ATTACK: Time in milliseconds the envelope has to stay above the threshold level before triggering */
+#define SETTINGS_REG_VCOS_VOXCTRL_ATTACK_DFLT               ((uint32_t) 5 << SETTINGS_REG_VCOS_VOXCTRL_ATTACK_OFFS)
+#define SETTINGS_REG_VCOS_VOXCTRL_ATTACK_OFFS               8
+#define SETTINGS_REG_VCOS_VOXCTRL_ATTACK_MASK               0x0000FF00UL
+/* RELEASE: Envelope level that retriggers the timeout (trailing) time while active. Should be below the threshold level for hysteresis */
+#define SETTINGS_REG_VCOS_VOXCTRL_RELEASE_DFLT              ((uint32_t) 128 << SETTINGS_REG_VCOS_VOXCTRL_RELEASE_OFFS)
+#define SETTINGS_REG_VCOS_VOXCTRL_RELEASE_OFFS              16
+#define SETTINGS_REG_VCOS_VOXCTRL_RELEASE_MASK              0xFFFF0000UL
+
 /* Virtual COS timing control register */
 #define SETTINGS_REG_VCOS_TIMCTRL                           0x94
 #define SETTINGS_REG_VCOS_TIMCTRL_DEFAULT                   (SETTINGS_REG_VCOS_TIMCTRL_TIMEOUT_DFLT)
@@ -297,6 +519,114 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 #define SETTINGS_REG_FOXHUNT_MSG3_CHAR15_OFFS               24
 #define SETTINGS_REG_FOXHUNT_MSG3_CHAR15_MASK               0xFF000000UL
 
+/* Modem control register */
+#define SETTINGS_REG_MODEM_CTRL                             0xB0
+#define SETTINGS_REG_MODEM_CTRL_DEFAULT                     (SETTINGS_REG_MODEM_CTRL_MODE_DFLT)
+/* MODE: On-device packet modem. Runs alongside USB audio. Takes effect on next reboot */
+#define SETTINGS_REG_MODEM_CTRL_MODE_DFLT                   (SETTINGS_REG_MODEM_CTRL_MODE_NONE_ENUM << SETTINGS_REG_MODEM_CTRL_MODE_OFFS)
+#define SETTINGS_REG_MODEM_CTRL_MODE_OFFS                   0
+#define SETTINGS_REG_MODEM_CTRL_MODE_MASK                   0x0000000FUL
+#define SETTINGS_REG_MODEM_CTRL_MODE_NONE_ENUM              0x0
+#define SETTINGS_REG_MODEM_CTRL_MODE_AFSK1200_ENUM          0x1
+#define SETTINGS_REG_MODEM_CTRL_MODE_G3RUH9600_ENUM         0x2 /* Receives at a capture rate of 48 kHz only, transmits at playback rates from 22.05 kHz */
+
+/* Modem transmit control register */
+#define SETTINGS_REG_MODEM_TXCTRL                           0xB1
+#define SETTINGS_REG_MODEM_TXCTRL_DEFAULT                   (SETTINGS_REG_MODEM_TXCTRL_TXDELAY_DFLT | SETTINGS_REG_MODEM_TXCTRL_TXTAIL_DFLT | SETTINGS_REG_MODEM_TXCTRL_LEVEL_DFLT)
+/* TXDELAY: Time between PTT assertion and the start of the frame in units of 10 ms (also set by the KISS TXDELAY command) */
+#define SETTINGS_REG_MODEM_TXCTRL_TXDELAY_DFLT              ((uint32_t) 30 << SETTINGS_REG_MODEM_TXCTRL_TXDELAY_OFFS)
+#define SETTINGS_REG_MODEM_TXCTRL_TXDELAY_OFFS              0
+#define SETTINGS_REG_MODEM_TXCTRL_TXDELAY_MASK              0x000000FFUL
+/* TXTAIL: Time between the end of the frame and PTT deassertion in units of 10 ms (also set by the KISS TXTAIL command) */
+#define SETTINGS_REG_MODEM_TXCTRL_TXTAIL_DFLT               ((uint32_t) 3 << SETTINGS_REG_MODEM_TXCTRL_TXTAIL_OFFS)
+#define SETTINGS_REG_MODEM_TXCTRL_TXTAIL_OFFS               8
+#define SETTINGS_REG_MODEM_TXCTRL_TXTAIL_MASK               0x0000FF00UL
+/* LEVEL: Transmit level (0.16 format) */
+#define SETTINGS_REG_MODEM_TXCTRL_LEVEL_DFLT                ((uint32_t) 32768 << SETTINGS_REG_MODEM_TXCTRL_LEVEL_OFFS)
+#define SETTINGS_REG_MODEM_TXCTRL_LEVEL_OFFS                16
+#define SETTINGS_REG_MODEM_TXCTRL_LEVEL_MASK                0xFFFF0000UL
+
+/* DTMF decoder register */
+#define SETTINGS_REG_DTMF_CTRL                              0xB8
+#define SETTINGS_REG_DTMF_CTRL_DEFAULT                      (SETTINGS_REG_DTMF_CTRL_ENABLE_DFLT | SETTINGS_REG_DTMF_CTRL_HIDEVENT_DFLT | SETTINGS_REG_DTMF_CTRL_CDCEVENT_DFLT | SETTINGS_REG_DTMF_CTRL_LEVEL_DFLT)
+/* ENABLE: Decode DTMF digits from the capture audio, also while the host is not recording. Takes effect on next reboot */
+#define SETTINGS_REG_DTMF_CTRL_ENABLE_DFLT                  ((uint32_t) 0 << SETTINGS_REG_DTMF_CTRL_ENABLE_OFFS)
+#define SETTINGS_REG_DTMF_CTRL_ENABLE_OFFS                  0
+#define SETTINGS_REG_DTMF_CTRL_ENABLE_MASK                  0x00000001UL
+/* HIDEVENT: Send a HID telemetry report for every digit, independent of the telemetry interval (requires telemetry) */
+#define SETTINGS_REG_DTMF_CTRL_HIDEVENT_DFLT                ((uint32_t) 1 << SETTINGS_REG_DTMF_CTRL_HIDEVENT_OFFS)
+#define SETTINGS_REG_DTMF_CTRL_HIDEVENT_OFFS                4
+#define SETTINGS_REG_DTMF_CTRL_HIDEVENT_MASK                0x00000010UL
+/* CDCEVENT: Report digits as "D tttttttt c" lines on the control CDC */
+#define SETTINGS_REG_DTMF_CTRL_CDCEVENT_DFLT                ((uint32_t) 1 << SETTINGS_REG_DTMF_CTRL_CDCEVENT_OFFS)
+#define SETTINGS_REG_DTMF_CTRL_CDCEVENT_OFFS                5
+#define SETTINGS_REG_DTMF_CTRL_CDCEVENT_MASK                0x00000020UL
+/* LEVEL: Minimum amplitude of each of the two tones in raw capture sample units */
+#define SETTINGS_REG_DTMF_CTRL_LEVEL_DFLT                   ((uint32_t) 300 << SETTINGS_REG_DTMF_CTRL_LEVEL_OFFS)
+#define SETTINGS_REG_DTMF_CTRL_LEVEL_OFFS                   16
+#define SETTINGS_REG_DTMF_CTRL_LEVEL_MASK                   0xFFFF0000UL
+
+/* CTCSS decoder register */
+#define SETTINGS_REG_CTCSS_CTRL                             0xB9
+#define SETTINGS_REG_CTCSS_CTRL_DEFAULT                     (SETTINGS_REG_CTCSS_CTRL_ENABLE_DFLT | SETTINGS_REG_CTCSS_CTRL_COSGATE_DFLT | SETTINGS_REG_CTCSS_CTRL_LEVEL_DFLT | SETTINGS_REG_CTCSS_CTRL_FREQ_DFLT)
+/* ENABLE: Detect CTCSS tones in the capture audio, also while the host is not recording. Takes effect on next reboot */
+#define SETTINGS_REG_CTCSS_CTRL_ENABLE_DFLT                 ((uint32_t) 0 << SETTINGS_REG_CTCSS_CTRL_ENABLE_OFFS)
+#define SETTINGS_REG_CTCSS_CTRL_ENABLE_OFFS                 0
+#define SETTINGS_REG_CTCSS_CTRL_ENABLE_MASK                 0x00000001UL
+/* COSGATE: Virtual COS is asserted by the configured tone instead of the capture level threshold */
+#define SETTINGS_REG_CTCSS_CTRL_COSGATE_DFLT                ((uint32_t) 0 << SETTINGS_REG_CTCSS_CTRL_COSGATE_OFFS)
+#define SETTINGS_REG_CTCSS_CTRL_COSGATE_OFFS                1
+#define SETTINGS_REG_CTCSS_CTRL_COSGATE_MASK                0x00000002UL
+/* LEVEL: Minimum tone amplitude in raw capture sample units */
+#define SETTINGS_REG_CTCSS_CTRL_LEVEL_DFLT                  ((uint32_t) 100 << SETTINGS_REG_CTCSS_CTRL_LEVEL_OFFS)
+#define SETTINGS_REG_CTCSS_CTRL_LEVEL_OFFS                  4
+#define SETTINGS_REG_CTCSS_CTRL_LEVEL_MASK                  0x0000FFF0UL
+/* FREQ: Configured tone in units of 0.1 Hz (nearest standard tone is used). 0 accepts any standard tone */
+#define SETTINGS_REG_CTCSS_CTRL_FREQ_DFLT                   ((uint32_t) 0 << SETTINGS_REG_CTCSS_CTRL_FREQ_OFFS)
+#define SETTINGS_REG_CTCSS_CTRL_FREQ_OFFS                   16
+#define SETTINGS_REG_CTCSS_CTRL_FREQ_MASK                   0xFFFF0000UL
+
+/* Sub-audible tone encoder control register */
+#define SETTINGS_REG_TXTONE_CTRL                            0xBA
+#define SETTINGS_REG_TXTONE_CTRL_DEFAULT                    (SETTINGS_REG_TXTONE_CTRL_MODE_DFLT | SETTINGS_REG_TXTONE_CTRL_TAIL_DFLT | SETTINGS_REG_TXTONE_CTRL_LEVEL_DFLT)
+/* MODE: Tone mixed into the playback audio while PTT is asserted. Takes effect on next reboot */
+#define SETTINGS_REG_TXTONE_CTRL_MODE_DFLT                  (SETTINGS_REG_TXTONE_CTRL_MODE_NONE_ENUM << SETTINGS_REG_TXTONE_CTRL_MODE_OFFS)
+#define SETTINGS_REG_TXTONE_CTRL_MODE_OFFS                  0
+#define SETTINGS_REG_TXTONE_CTRL_MODE_MASK                  0x0000000FUL
+#define SETTINGS_REG_TXTONE_CTRL_MODE_NONE_ENUM             0x0
+#define SETTINGS_REG_TXTONE_CTRL_MODE_CTCSS_ENUM            0x1
+#define SETTINGS_REG_TXTONE_CTRL_MODE_DCS_ENUM              0x2
+#define SETTINGS_REG_TXTONE_CTRL_MODE_DCSINV_ENUM           0x3 /* DCS with inverted polarity */
+/* TAIL: Time the PTT is held after release in units of 10 ms, sending the CTCSS reverse burst or DCS turn-off code. 0 disables */
+#define SETTINGS_REG_TXTONE_CTRL_TAIL_DFLT                  ((uint32_t) 0 << SETTINGS_REG_TXTONE_CTRL_TAIL_OFFS)
+#define SETTINGS_REG_TXTONE_CTRL_TAIL_OFFS                  8
+#define SETTINGS_REG_TXTONE_CTRL_TAIL_MASK                  0x0000FF00UL
+/* LEVEL: Tone amplitude in raw playback sample units (independent of the USB volume) */
+#define SETTINGS_REG_TXTONE_CTRL_LEVEL_DFLT                 ((uint32_t) 1500 << SETTINGS_REG_TXTONE_CTRL_LEVEL_OFFS)
+#define SETTINGS_REG_TXTONE_CTRL_LEVEL_OFFS                 16
+#define SETTINGS_REG_TXTONE_CTRL_LEVEL_MASK                 0xFFFF0000UL
+
+/* Sub-audible tone encoder code register */
+#define SETTINGS_REG_TXTONE_CODE                            0xBB
+#define SETTINGS_REG_TXTONE_CODE_DEFAULT                    (SETTINGS_REG_TXTONE_CODE_FREQ_DFLT | SETTINGS_REG_TXTONE_CODE_DCS_DFLT)
+/* FREQ: CTCSS tone in units of 0.1 Hz */
+#define SETTINGS_REG_TXTONE_CODE_FREQ_DFLT                  ((uint32_t) 1000 << SETTINGS_REG_TXTONE_CODE_FREQ_OFFS)
+#define SETTINGS_REG_TXTONE_CODE_FREQ_OFFS                  0
+#define SETTINGS_REG_TXTONE_CODE_FREQ_MASK                  0x0000FFFFUL
+/* DCS: DCS code as three octal digits, one per hex nibble (e.g. 0x023 for D023N) */
+#define SETTINGS_REG_TXTONE_CODE_DCS_DFLT                   ((uint32_t) 0x023 << SETTINGS_REG_TXTONE_CODE_DCS_OFFS)
+#define SETTINGS_REG_TXTONE_CODE_DCS_OFFS                   16
+#define SETTINGS_REG_TXTONE_CODE_DCS_MASK                   0x0FFF0000UL
+
+/* Playback pre-roll (transmit delay line) register */
+#define SETTINGS_REG_PREROLL_CTRL                           0xBC
+#define SETTINGS_REG_PREROLL_CTRL_DEFAULT                   (SETTINGS_REG_PREROLL_CTRL_DELAY_DFLT)
+/* DELAY: Delay of the playback audio in milliseconds, so the virtual PTT is keyed before the audio reaches the radio.
+ * Memory is allocated on next reboot when non-zero. Later changes take effect up to the allocated depth. 0 disables */
+#define SETTINGS_REG_PREROLL_CTRL_DELAY_DFLT                ((uint32_t) 0 << SETTINGS_REG_PREROLL_CTRL_DELAY_OFFS)
+#define SETTINGS_REG_PREROLL_CTRL_DELAY_OFFS                0
+#define SETTINGS_REG_PREROLL_CTRL_DELAY_MASK                0x0000FFFFUL
+
 /* AIOC debug register 0 */
 #define SETTINGS_REG_INFO_AIOC0                             0xC0
 #define SETTINGS_REG_INFO_AIOC0_DEFAULT                     0
@@ -304,6 +634,128 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 #define SETTINGS_REG_INFO_AIOC0_PTT1STATE_MASK              0x00010000UL
 #define SETTINGS_REG_INFO_AIOC0_PTT2STATE_MASK              0x00020000UL
 
+/* AIOC debug register 1 */
+#define SETTINGS_REG_INFO_AIOC1                             0xC1
+#define SETTINGS_REG_INFO_AIOC1_DEFAULT                     0
+/* Bitmask of profile slots holding a stored profile */
+#define SETTINGS_REG_INFO_AIOC1_PROFILEVALID_OFFS           0
+#define SETTINGS_REG_INFO_AIOC1_PROFILEVALID_MASK           0x000000FFUL
+/* Outcome of the last settings recall from flash */
+#define SETTINGS_REG_INFO_AIOC1_RECALL_OFFS                 8
+#define SETTINGS_REG_INFO_AIOC1_RECALL_MASK                 0x00000F00UL
+#define SETTINGS_REG_INFO_AIOC1_RECALL_OK_ENUM              0
+#define SETTINGS_REG_INFO_AIOC1_RECALL_DEFAULT_ENUM         1
+#define SETTINGS_REG_INFO_AIOC1_RECALL_MIGRATED_ENUM        2
+#define SETTINGS_REG_INFO_AIOC1_RECALL_CORRUPT_ENUM         3
+/* How the last register transaction ended */
+#define SETTINGS_REG_INFO_AIOC1_TRANSACTION_OFFS            12
+#define SETTINGS_REG_INFO_AIOC1_TRANSACTION_MASK            0x0000F000UL
+#define SETTINGS_REG_INFO_AIOC1_TRANSACTION_NONE_ENUM       0
+#define SETTINGS_REG_INFO_AIOC1_TRANSACTION_OPEN_ENUM       1
+#define SETTINGS_REG_INFO_AIOC1_TRANSACTION_COMMITTED_ENUM  2
+#define SETTINGS_REG_INFO_AIOC1_TRANSACTION_ABORTED_ENUM    3
+#define SETTINGS_REG_INFO_AIOC1_TRANSACTION_EXPIRED_ENUM    4 /* Discarded after SETTINGS_TRANSACTION_TIMEOUT without activity */
+
+/* AIOC debug register 2 */
+#define SETTINGS_REG_INFO_AIOC2                             0xC2
+#define SETTINGS_REG_INFO_AIOC2_DEFAULT                     0
+/* Buffer pool partition sizes in bytes and the active pool mode */
+#define SETTINGS_REG_INFO_AIOC2_SERIALRX_OFFS               0
+#define SETTINGS_REG_INFO_AIOC2_SERIALRX_MASK               0x00000FFFUL
+#define SETTINGS_REG_INFO_AIOC2_CAPTURE_OFFS                12
+#define SETTINGS_REG_INFO_AIOC2_CAPTURE_MASK                0x00FFF000UL
+#define SETTINGS_REG_INFO_AIOC2_POOLMODE_OFFS               28
+#define SETTINGS_REG_INFO_AIOC2_POOLMODE_MASK               0xF0000000UL
+
+/* AIOC debug register 3 */
+#define SETTINGS_REG_INFO_AIOC3                             0xC3
+#define SETTINGS_REG_INFO_AIOC3_DEFAULT                     0
+/* Audio processing partition size and the amount allocated from it in bytes */
+#define SETTINGS_REG_INFO_AIOC3_AUDIO_OFFS                  0
+#define SETTINGS_REG_INFO_AIOC3_AUDIO_MASK                  0x00000FFFUL
+#define SETTINGS_REG_INFO_AIOC3_AUDIOUSED_OFFS              12
+#define SETTINGS_REG_INFO_AIOC3_AUDIOUSED_MASK              0x00FFF000UL
+
+/* Serial debug register 0 */
+#define SETTINGS_REG_INFO_SERIAL0                           0xC8
+#define SETTINGS_REG_INFO_SERIAL0_DEFAULT                   0
+/* Number of flushes due to receiver timeout */
+#define SETTINGS_REG_INFO_SERIAL0_RTOFLUSH_OFFS             0
+#define SETTINGS_REG_INFO_SERIAL0_RTOFLUSH_MASK             0x0000FFFFUL
+/* Number of flushes due to fill level */
+#define SETTINGS_REG_INFO_SERIAL0_FILLFLUSH_OFFS            16
+#define SETTINGS_REG_INFO_SERIAL0_FILLFLUSH_MASK            0xFFFF0000UL
+
+/* Serial debug register 1 */
+#define SETTINGS_REG_INFO_SERIAL1                           0xC9
+#define SETTINGS_REG_INFO_SERIAL1_DEFAULT                   0
+/* Number of flushes due to maximum latency */
+#define SETTINGS_REG_INFO_SERIAL1_LATFLUSH_OFFS             0
+#define SETTINGS_REG_INFO_SERIAL1_LATFLUSH_MASK             0x0000FFFFUL
+/* Average number of bytes per flush */
+#define SETTINGS_REG_INFO_SERIAL1_FILLAVG_OFFS              16
+#define SETTINGS_REG_INFO_SERIAL1_FILLAVG_MASK              0xFFFF0000UL
+
+/* Serial debug register 2 */
+#define SETTINGS_REG_INFO_SERIAL2                           0xCA
+#define SETTINGS_REG_INFO_SERIAL2_DEFAULT                   0
+/* Sustained benchmark throughput in bytes per second */
+#define SETTINGS_REG_INFO_SERIAL2_BENCHRATE_OFFS            0
+#define SETTINGS_REG_INFO_SERIAL2_BENCHRATE_MASK            0xFFFFFFFFUL
+
+/* Serial debug register 3 */
+#define SETTINGS_REG_INFO_SERIAL3                           0xCB
+#define SETTINGS_REG_INFO_SERIAL3_DEFAULT                   0
+/* Number of wrong or missing bytes in the benchmark */
+#define SETTINGS_REG_INFO_SERIAL3_BENCHERR_OFFS             0
+#define SETTINGS_REG_INFO_SERIAL3_BENCHERR_MASK             0x00FFFFFFUL
+/* Benchmark status */
+#define SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_OFFS          28
+#define SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_MASK          0xF0000000UL
+#define SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_IDLE_ENUM     0
+#define SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_RUN_ENUM      1
+#define SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_DONE_ENUM     2
+#define SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_TIMEOUT_ENUM  3
+#define SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_INVALID_ENUM  4
+
+/* Serial debug register 4. Receive error counters, reset when a benchmark starts */
+#define SETTINGS_REG_INFO_SERIAL4                           0xCC
+#define SETTINGS_REG_INFO_SERIAL4_DEFAULT                   0
+#define SETTINGS_REG_INFO_SERIAL4_FRAMEERR_OFFS             0
+#define SETTINGS_REG_INFO_SERIAL4_FRAMEERR_MASK             0x000000FFUL
+#define SETTINGS_REG_INFO_SERIAL4_NOISEERR_OFFS             8
+#define SETTINGS_REG_INFO_SERIAL4_NOISEERR_MASK             0x0000FF00UL
+#define SETTINGS_REG_INFO_SERIAL4_OVERRUN_OFFS              16
+#define SETTINGS_REG_INFO_SERIAL4_OVERRUN_MASK              0x00FF0000UL
+/* Number of times the receive ring overflowed, because the host did not read fast enough. The unsent data was dropped */
+#define SETTINGS_REG_INFO_SERIAL4_RINGOVR_OFFS              24
+#define SETTINGS_REG_INFO_SERIAL4_RINGOVR_MASK              0xFF000000UL
+
+/* Serial debug register 5 */
+#define SETTINGS_REG_INFO_SERIAL5                           0xCD
+#define SETTINGS_REG_INFO_SERIAL5_DEFAULT                   0
+/* Latency from data received via USB to the start of UART transmission in us (last and maximum) */
+#define SETTINGS_REG_INFO_SERIAL5_TXLAT_OFFS                0
+#define SETTINGS_REG_INFO_SERIAL5_TXLAT_MASK                0x0000FFFFUL
+#define SETTINGS_REG_INFO_SERIAL5_TXLATMAX_OFFS             16
+#define SETTINGS_REG_INFO_SERIAL5_TXLATMAX_MASK             0xFFFF0000UL
+
+/* Serial debug register 6 */
+#define SETTINGS_REG_INFO_SERIAL6                           0xCE
+#define SETTINGS_REG_INFO_SERIAL6_DEFAULT                   0
+/* Baudrate requested by the host */
+#define SETTINGS_REG_INFO_SERIAL6_BAUDREQ_OFFS              0
+#define SETTINGS_REG_INFO_SERIAL6_BAUDREQ_MASK              0xFFFFFFFFUL
+
+/* Serial debug register 7 */
+#define SETTINGS_REG_INFO_SERIAL7                           0xCF
+#define SETTINGS_REG_INFO_SERIAL7_DEFAULT                   0
+/* Baudrate actually generated by the UART */
+#define SETTINGS_REG_INFO_SERIAL7_BAUDACT_OFFS              0
+#define SETTINGS_REG_INFO_SERIAL7_BAUDACT_MASK              0x0FFFFFFFUL
+/* 8x oversampling selected */
+#define SETTINGS_REG_INFO_SERIAL7_OVER8_MASK                0x80000000UL
+
 /* UAC audio debug register 0 */
 #define SETTINGS_REG_INFO_AUDIO0                            0xD0
 #define SETTINGS_REG_INFO_AUDIO0_DEFAULT                    0
@@ -424,12 +876,173 @@ extern uint32_t settingsRegMap[SETTINGS_REGMAP_SIZE];
 #define SETTINGS_REG_INFO_AUDIO15_PLAYFBMAX_OFFS            0
 #define SETTINGS_REG_INFO_AUDIO15_PLAYFBMAX_MASK            0xFFFFFFFFUL
 
+/* Modem debug register 0 */
+#define SETTINGS_REG_INFO_MODEM0                            0xE0
+#define SETTINGS_REG_INFO_MODEM0_DEFAULT                    0
+/* Number of received frames with valid and with invalid FCS */
+#define SETTINGS_REG_INFO_MODEM0_RXFRAMES_OFFS              0
+#define SETTINGS_REG_INFO_MODEM0_RXFRAMES_MASK              0x0000FFFFUL
+#define SETTINGS_REG_INFO_MODEM0_RXFCSERR_OFFS              16
+#define SETTINGS_REG_INFO_MODEM0_RXFCSERR_MASK              0xFFFF0000UL
+
+/* Modem debug register 1 */
+#define SETTINGS_REG_INFO_MODEM1                            0xE1
+#define SETTINGS_REG_INFO_MODEM1_DEFAULT                    0
+/* Average and maximum CPU cycles spent demodulating one block of MODEM_BLOCK_LEN samples */
+#define SETTINGS_REG_INFO_MODEM1_RXCYCLES_OFFS              0
+#define SETTINGS_REG_INFO_MODEM1_RXCYCLES_MASK              0x0000FFFFUL
+#define SETTINGS_REG_INFO_MODEM1_RXCYCLESMAX_OFFS           16
+#define SETTINGS_REG_INFO_MODEM1_RXCYCLESMAX_MASK           0xFFFF0000UL
+
+/* Modem debug register 2 */
+#define SETTINGS_REG_INFO_MODEM2                            0xE2
+#define SETTINGS_REG_INFO_MODEM2_DEFAULT                    0
+/* Sample blocks dropped because the main loop did not keep up */
+#define SETTINGS_REG_INFO_MODEM2_RXOVERRUN_OFFS             0
+#define SETTINGS_REG_INFO_MODEM2_RXOVERRUN_MASK             0x000000FFUL
+/* Received frames dropped because the KISS host did not keep up (or is not connected) */
+#define SETTINGS_REG_INFO_MODEM2_KISSDROP_OFFS              8
+#define SETTINGS_REG_INFO_MODEM2_KISSDROP_MASK              0x0000FF00UL
+/* Modem state */
+#define SETTINGS_REG_INFO_MODEM2_STATE_OFFS                 28
+#define SETTINGS_REG_INFO_MODEM2_STATE_MASK                 0xF0000000UL
+#define SETTINGS_REG_INFO_MODEM2_STATE_OFF_ENUM             0
+#define SETTINGS_REG_INFO_MODEM2_STATE_RUN_ENUM             1
+#define SETTINGS_REG_INFO_MODEM2_STATE_NOMEM_ENUM           2 /* Not enough memory in the audio pool partition */
+#define SETTINGS_REG_INFO_MODEM2_STATE_RATE_ENUM            3 /* Capture sample rate not supported by the modem (receiver stopped) */
+
+/* Modem debug register 3 */
+#define SETTINGS_REG_INFO_MODEM3                            0xE3
+#define SETTINGS_REG_INFO_MODEM3_DEFAULT                    0
+/* Number of transmitted frames */
+#define SETTINGS_REG_INFO_MODEM3_TXFRAMES_OFFS              0
+#define SETTINGS_REG_INFO_MODEM3_TXFRAMES_MASK              0x0000FFFFUL
+/* KISS frames from the host that were discarded (oversized or unsupported) */
+#define SETTINGS_REG_INFO_MODEM3_KISSERR_OFFS               16
+#define SETTINGS_REG_INFO_MODEM3_KISSERR_MASK               0x00FF0000UL
+/* Transmitter state */
+#define SETTINGS_REG_INFO_MODEM3_TXSTATE_OFFS               28
+#define SETTINGS_REG_INFO_MODEM3_TXSTATE_MASK               0xF0000000UL
+#define SETTINGS_REG_INFO_MODEM3_TXSTATE_IDLE_ENUM          0
+#define SETTINGS_REG_INFO_MODEM3_TXSTATE_ACTIVE_ENUM        1 /* PTT asserted by the modem */
+#define SETTINGS_REG_INFO_MODEM3_TXSTATE_RATE_ENUM          2 /* Playback sample rate not supported by the modem (last frame dropped) */
+
+/* Tone analysis debug register 0 */
+#define SETTINGS_REG_INFO_TONE0                             0xE4
+#define SETTINGS_REG_INFO_TONE0_DEFAULT                     0
+/* Average processing time per block in CPU cycles (all tone detectors) */
+#define SETTINGS_REG_INFO_TONE0_CYCLES_OFFS                 0
+#define SETTINGS_REG_INFO_TONE0_CYCLES_MASK                 0x0000FFFFUL
+/* Maximum processing time per block in CPU cycles */
+#define SETTINGS_REG_INFO_TONE0_CYCLESMAX_OFFS              16
+#define SETTINGS_REG_INFO_TONE0_CYCLESMAX_MASK              0xFFFF0000UL
+
+/* Tone analysis debug register 1 */
+#define SETTINGS_REG_INFO_TONE1                             0xE5
+#define SETTINGS_REG_INFO_TONE1_DEFAULT                     0
+/* Blocks lost, because the main loop did not keep up */
+#define SETTINGS_REG_INFO_TONE1_OVERRUN_OFFS                0
+#define SETTINGS_REG_INFO_TONE1_OVERRUN_MASK                0x000000FFUL
+/* Analysis sample rate in Hz (capture rate after decimation) */
+#define SETTINGS_REG_INFO_TONE1_RATE_OFFS                   8
+#define SETTINGS_REG_INFO_TONE1_RATE_MASK                   0x00FFFF00UL
+/* Tone analysis state */
+#define SETTINGS_REG_INFO_TONE1_STATE_OFFS                  28
+#define SETTINGS_REG_INFO_TONE1_STATE_MASK                  0xF0000000UL
+#define SETTINGS_REG_INFO_TONE1_STATE_OFF_ENUM              0
+#define SETTINGS_REG_INFO_TONE1_STATE_RUN_ENUM              1
+#define SETTINGS_REG_INFO_TONE1_STATE_NOMEM_ENUM            2 /* Not enough memory in the audio pool partition */
+
+/* DTMF debug register */
+#define SETTINGS_REG_INFO_DTMF0                             0xE8
+#define SETTINGS_REG_INFO_DTMF0_DEFAULT                     0
+/* Last decoded digit as ASCII character (0 if none) */
+#define SETTINGS_REG_INFO_DTMF0_DIGIT_OFFS                  0
+#define SETTINGS_REG_INFO_DTMF0_DIGIT_MASK                  0x000000FFUL
+/* Number of decoded digits */
+#define SETTINGS_REG_INFO_DTMF0_COUNT_OFFS                  8
+#define SETTINGS_REG_INFO_DTMF0_COUNT_MASK                  0x0000FF00UL
+/* Duration of the last completed digit in milliseconds */
+#define SETTINGS_REG_INFO_DTMF0_DURATION_OFFS               16
+#define SETTINGS_REG_INFO_DTMF0_DURATION_MASK               0xFFFF0000UL
+
+/* CTCSS debug register */
+#define SETTINGS_REG_INFO_CTCSS0                            0xE9
+#define SETTINGS_REG_INFO_CTCSS0_DEFAULT                    0
+/* Detected tone in units of 0.1 Hz (0 if none) */
+#define SETTINGS_REG_INFO_CTCSS0_TONE_OFFS                  0
+#define SETTINGS_REG_INFO_CTCSS0_TONE_MASK                  0x0000FFFFUL
+/* Amplitude of the detected tone in raw capture sample units */
+#define SETTINGS_REG_INFO_CTCSS0_LEVEL_OFFS                 16
+#define SETTINGS_REG_INFO_CTCSS0_LEVEL_MASK                 0xFFFF0000UL
+
+/* Pre-roll debug register */
+#define SETTINGS_REG_INFO_PREROLL0                          0xEA
+#define SETTINGS_REG_INFO_PREROLL0_DEFAULT                  0
+/* Effective delay in milliseconds */
+#define SETTINGS_REG_INFO_PREROLL0_DEPTH_OFFS               0
+#define SETTINGS_REG_INFO_PREROLL0_DEPTH_MASK               0x0000FFFFUL
+/* Delay line memory in bytes allocated from the audio pool partition */
+#define SETTINGS_REG_INFO_PREROLL0_MEMORY_OFFS              16
+#define SETTINGS_REG_INFO_PREROLL0_MEMORY_MASK              0x0FFF0000UL
+/* Pre-roll state */
+#define SETTINGS_REG_INFO_PREROLL0_STATE_OFFS               28
+#define SETTINGS_REG_INFO_PREROLL0_STATE_MASK               0xF0000000UL
+#define SETTINGS_REG_INFO_PREROLL0_STATE_OFF_ENUM           0
+#define SETTINGS_REG_INFO_PREROLL0_STATE_RUN_ENUM           1
+#define SETTINGS_REG_INFO_PREROLL0_STATE_NOMEM_ENUM         2 /* Not enough memory in the audio pool partition */
+
+/* Audio filter debug register 0 */
+#define SETTINGS_REG_INFO_FILTER0                           0xEB
+#define SETTINGS_REG_INFO_FILTER0_DEFAULT                   0
+/* Average processing time per block of the capture filter in CPU cycles */
+#define SETTINGS_REG_INFO_FILTER0_RXCYCLES_OFFS             0
+#define SETTINGS_REG_INFO_FILTER0_RXCYCLES_MASK             0x0000FFFFUL
+/* Average processing time per block of the playback filter in CPU cycles */
+#define SETTINGS_REG_INFO_FILTER0_TXCYCLES_OFFS             16
+#define SETTINGS_REG_INFO_FILTER0_TXCYCLES_MASK             0xFFFF0000UL
+
+/* Audio filter debug register 1 */
+#define SETTINGS_REG_INFO_FILTER1                           0xEC
+#define SETTINGS_REG_INFO_FILTER1_DEFAULT                   0
+/* Maximum processing time per block of the capture filter in CPU cycles */
+#define SETTINGS_REG_INFO_FILTER1_RXCYCLESMAX_OFFS          0
+#define SETTINGS_REG_INFO_FILTER1_RXCYCLESMAX_MASK          0x0000FFFFUL
+/* Maximum processing time per block of the playback filter in CPU cycles */
+#define SETTINGS_REG_INFO_FILTER1_TXCYCLESMAX_OFFS          16
+#define SETTINGS_REG_INFO_FILTER1_TXCYCLESMAX_MASK          0xFFFF0000UL
+
+/* Limiter debug register 0 */
+#define SETTINGS_REG_INFO_LIMIT0                            0xED
+#define SETTINGS_REG_INFO_LIMIT0_DEFAULT                    0
+/* Highest gain reduction of the peak limiter during the last second in units of 0.1 dB */
+#define SETTINGS_REG_INFO_LIMIT0_LIMITGR_OFFS               0
+#define SETTINGS_REG_INFO_LIMIT0_LIMITGR_MASK               0x0000FFFFUL
+/* Highest gain reduction of the compressor (without makeup gain) during the last second in units of 0.1 dB */
+#define SETTINGS_REG_INFO_LIMIT0_COMPGR_OFFS                16
+#define SETTINGS_REG_INFO_LIMIT0_COMPGR_MASK                0xFFFF0000UL
+
+/* Limiter debug register 1 */
+#define SETTINGS_REG_INFO_LIMIT1                            0xEE
+#define SETTINGS_REG_INFO_LIMIT1_DEFAULT                    0
+/* Milliseconds of playback audio with gain reduction by the peak limiter */
+#define SETTINGS_REG_INFO_LIMIT1_LIMITMS_OFFS               0
+#define SETTINGS_REG_INFO_LIMIT1_LIMITMS_MASK               0xFFFFFFFFUL
+
 
 void Settings_Init();
+void Settings_Task(void);
 uint8_t Settings_RegWrite(uint8_t address, uint32_t data);
+uint8_t Settings_RegWriteImmediate(uint8_t address, uint32_t data);
+uint8_t Settings_RegWriteBlock(uint8_t address, const uint32_t * data, uint16_t count);
 uint8_t Settings_RegRead(uint8_t address, uint32_t * data);
+void Settings_Begin(void);
+void Settings_Commit(void);
+void Settings_Abort(void);
 void Settings_Store(void);
 void Settings_Recall(void);
 void Settings_Default(void);
+uint8_t Settings_ProfileLoad(uint8_t slot);
+void Settings_ProfileStore(void);
 
 #endif /* SETTINGS_H_ */
@@ -0,0 +1,171 @@
+#include "subtone.h"
+#include "stm32f3xx_hal.h"
+#include "settings.h"
+#include "dsp.h"
+#include "io.h"
+#include "usb_audio.h"
+
+static uint8_t subtoneMode = SETTINGS_REG_TXTONE_CTRL_MODE_NONE_ENUM;
+
+/* Generator parameters, prepared by the main loop */
+static uint32_t configRate = 0;
+static uint32_t configCtrl = 0;
+static uint32_t configCode = 0;
+static volatile uint32_t tonePhaseStep = 0;
+static volatile uint32_t bitPhaseStep = 0;
+static volatile uint32_t dcsCodeWord = 0;
+static volatile int32_t toneLevel = 0;
+static volatile uint8_t smoothShift = 0;
+static volatile uint32_t tailSamples = 0;
+
+/* Generator state, owned by the DAC interrupt */
+static uint32_t tonePhase = 0;
+static uint32_t bitPhase = 0;
+static uint8_t bitIndex = 0;
+static int32_t dcsLevel = 0;
+static volatile uint8_t releaseMask = IO_PTT_MASK_NONE;
+static volatile uint32_t tailRemaining = 0;
+
+static uint32_t DcsCodeWord(uint32_t digits)
+{
+    /* Golay (23,12) code word: 9 bit code (three octal digits), fixed bits 100 and 11 parity bits. Sent LSB first */
+    uint32_t data = (((digits >> 8) & 0x7) << 6) | (((digits >> 4) & 0x7) << 3) | ((digits >> 0) & 0x7) | 0x800;
+    uint32_t remainder = data << 11;
+
+    for (int8_t i = 22; i >= 11; i--) {
+        if (remainder & (1UL << i)) {
+            remainder ^= (uint32_t) SUBTONE_DCS_GOLAY_POLY << (i - 11);
+        }
+    }
+
+    return data | ((remainder & 0x7FF) << 12);
+}
+
+static void Configure(uint32_t sampleRate)
+{
+    uint32_t frequency = SETTINGS_GET(SETTINGS_REG_TXTONE_CODE, FREQ);
+    uint8_t shift = 0;
+
+    while ((sampleRate >> shift) > SUBTONE_DCS_CUTOFF) {
+        shift++;
+    }
+
+    tonePhaseStep = (uint32_t) (((uint64_t) frequency << 32) / (10 * sampleRate));
+    bitPhaseStep = (uint32_t) (((uint64_t) SUBTONE_DCS_BAUD_X10 << 32) / (10 * sampleRate));
+    dcsCodeWord = DcsCodeWord(SETTINGS_GET(SETTINGS_REG_TXTONE_CODE, DCS));
+    toneLevel = SETTINGS_GET(SETTINGS_REG_TXTONE_CTRL, LEVEL);
+    smoothShift = shift;
+    tailSamples = SETTINGS_GET(SETTINGS_REG_TXTONE_CTRL, TAIL) * sampleRate / 100;
+}
+
+void Subtone_Init(void)
+{
+    /* The DAC interrupt is kept running for the encoder, so the mode is latched until next reboot */
+    subtoneMode = SETTINGS_GET(SETTINGS_REG_TXTONE_CTRL, MODE);
+}
+
+void Subtone_Task(void)
+{
+    if (subtoneMode == SETTINGS_REG_TXTONE_CTRL_MODE_NONE_ENUM) {
+        return;
+    }
+
+    /* Follow the playback sample rate and the settings */
+    uint32_t sampleRate = USB_AudioTxSampleRate();
+    uint32_t ctrl = settingsRegMap[SETTINGS_REG_TXTONE_CTRL];
+    uint32_t code = settingsRegMap[SETTINGS_REG_TXTONE_CODE];
+
+    if ((sampleRate != configRate) || (ctrl != configCtrl) || (code != configCode)) {
+        if (sampleRate != 0) {
+            Configure(sampleRate);
+        }
+
+        configRate = sampleRate;
+        configCtrl = ctrl;
+        configCode = code;
+    }
+}
+
+bool Subtone_Enabled(void)
+{
+    return subtoneMode != SETTINGS_REG_TXTONE_CTRL_MODE_NONE_ENUM;
+}
+
+int16_t Subtone_TxMix(int16_t sample)
+{
+    /* Called at audio interrupt priority */
+    if (subtoneMode == SETTINGS_REG_TXTONE_CTRL_MODE_NONE_ENUM) {
+        return sample;
+    }
+
+    bool tail = (releaseMask != IO_PTT_MASK_NONE);
+
+    if (!tail && (IO_PTTStatus() == IO_PTT_MASK_NONE)) {
+        /* Every transmission starts at the beginning of the code word */
+        tonePhase = 0;
+        bitPhase = 0;
+        bitIndex = 0;
+        dcsLevel = 0;
+        return sample;
+    }
+
+    int32_t tone;
+
+    if (subtoneMode == SETTINGS_REG_TXTONE_CTRL_MODE_CTCSS_ENUM) {
+        tonePhase += tonePhaseStep;
+        tone = ((int32_t) Dsp_Sine(tonePhase) * toneLevel) >> 15;
+    } else {
+        bitPhase += bitPhaseStep;
+
+        if (bitPhase < bitPhaseStep) {
+            bitIndex = (bitIndex + 1 < SUBTONE_DCS_BITS) ? bitIndex + 1 : 0;
+        }
+
+        /* The turn-off code is a square wave at the bit rate */
+        bool high = tail ? (bitPhase & 0x80000000UL) != 0 : ((dcsCodeWord >> bitIndex) & 1) != 0;
+
+        if (subtoneMode == SETTINGS_REG_TXTONE_CTRL_MODE_DCSINV_ENUM) {
+            high = !high;
+        }
+
+        dcsLevel += ((high ? toneLevel : -toneLevel) - dcsLevel) >> smoothShift;
+        tone = dcsLevel;
+    }
+
+    if (tail && (--tailRemaining == 0)) {
+        IO_PTTDeassertImmediate(releaseMask);
+        releaseMask = IO_PTT_MASK_NONE;
+    }
+
+    int32_t mixed = (int32_t) sample + tone;
+
+    return (mixed > INT16_MAX) ? INT16_MAX : (mixed < INT16_MIN) ? INT16_MIN : (int16_t) mixed;
+}
+
+uint8_t Subtone_DeferRelease(uint8_t pttMask)
+{
+    /* Only outputs that are actually asserted are held */
+    pttMask &= IO_PTTStatus();
+
+    if ((subtoneMode == SETTINGS_REG_TXTONE_CTRL_MODE_NONE_ENUM) || (tailSamples == 0) || (pttMask == IO_PTT_MASK_NONE)) {
+        return IO_PTT_MASK_NONE;
+    }
+
+    if (releaseMask == IO_PTT_MASK_NONE) {
+        tailRemaining = tailSamples;
+
+        if (subtoneMode == SETTINGS_REG_TXTONE_CTRL_MODE_CTCSS_ENUM) {
+            /* Reverse burst */
+            tonePhase += 0x80000000UL;
+        }
+    }
+
+    releaseMask |= pttMask;
+
+    return pttMask;
+}
+
+void Subtone_CancelRelease(uint8_t pttMask)
+{
+    releaseMask &= ~pttMask;
+}
@@ -0,0 +1,29 @@
+#ifndef SUBTONE_H_
+#define SUBTONE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Sub-audible tone encoder. A CTCSS tone (phase accumulator) or a DCS code word (134.4 bps NRZ, smoothed by a one pole low pass)
+ * is mixed into the playback samples in the DAC interrupt while any PTT output is asserted.
+ * On PTT release, the PTT outputs are held for the configured tail, during which a CTCSS reverse burst (180 degree phase shift)
+ * or the DCS turn-off code (134.4 Hz square wave) is sent. */
+#define SUBTONE_DCS_BITS        23
+#define SUBTONE_DCS_BAUD_X10    1344
+#define SUBTONE_DCS_GOLAY_POLY  0xC75 /* x^11 + x^10 + x^6 + x^5 + x^4 + x^2 + 1 */
+#define SUBTONE_DCS_CUTOFF      1500  /* Smoothing time constant as a rate (sample rate / 2^n) */
+
+void Subtone_Init(void);
+void Subtone_Task(void);
+bool Subtone_Enabled(void);
+
+/* Called by the DAC interrupt for every playback sample */
+int16_t Subtone_TxMix(int16_t sample);
+
+/* Called with interrupts disabled by IO_PTTSourceRelease. Returns the PTT outputs whose release is deferred until the end of the tail */
+uint8_t Subtone_DeferRelease(uint8_t pttMask);
+
+/* Called with interrupts disabled by IO_PTTAssert and IO_PTTDeassertImmediate. Cancels a deferred release of these outputs */
+void Subtone_CancelRelease(uint8_t pttMask);
+
+#endif /* SUBTONE_H_ */
@@ -0,0 +1,158 @@
+#include "tone.h"
+#include "stm32f3xx_hal.h"
+#include "settings.h"
+#include "pool.h"
+#include "dsp.h"
+#include "dtmf.h"
+#include "ctcss.h"
+#include "usb_audio.h"
+#include <stddef.h>
+
+#define TONE_DC_SHIFT   10 /* DC removal time constant in samples (power of 2) */
+
+static uint8_t toneState = SETTINGS_REG_INFO_TONE1_STATE_OFF_ENUM;
+
+/* Block ring filled by the ADC interrupt */
+static dsp_ring_t rxRing;
+static dsp_decim_t rxDecim;
+static int32_t rxDcAccu = 0;
+static uint32_t rxSampleRate = 0;
+
+static uint32_t cyclesAvg = 0; /* 28.4 format */
+static uint32_t cyclesMax = 0;
+
+static void InfoUpdate(void)
+{
+    uint32_t cycles = cyclesAvg >> 4;
+    uint32_t rate = (rxSampleRate != 0) ? rxSampleRate / rxDecim.factor : 0;
+
+    settingsRegMap[SETTINGS_REG_INFO_TONE0] =
+            (((cycles > 0xFFFF ? 0xFFFF : cycles) << SETTINGS_REG_INFO_TONE0_CYCLES_OFFS) & SETTINGS_REG_INFO_TONE0_CYCLES_MASK) |
+            (((cyclesMax > 0xFFFF ? 0xFFFF : cyclesMax) << SETTINGS_REG_INFO_TONE0_CYCLESMAX_OFFS) & SETTINGS_REG_INFO_TONE0_CYCLESMAX_MASK);
+    settingsRegMap[SETTINGS_REG_INFO_TONE1] =
+            (((uint32_t) rxRing.overruns << SETTINGS_REG_INFO_TONE1_OVERRUN_OFFS) & SETTINGS_REG_INFO_TONE1_OVERRUN_MASK) |
+            ((rate << SETTINGS_REG_INFO_TONE1_RATE_OFFS) & SETTINGS_REG_INFO_TONE1_RATE_MASK) |
+            (((uint32_t) toneState << SETTINGS_REG_INFO_TONE1_STATE_OFFS) & SETTINGS_REG_INFO_TONE1_STATE_MASK);
+}
+
+static void RxConfig(uint32_t sampleRate)
+{
+    /* Follow the capture sample rate, which may be changed by the host at any time */
+    uint8_t decim = sampleRate / TONE_RATE;
+
+    if (decim == 0) {
+        decim = 1;
+    }
+
+    NVIC_DisableIRQ(ADC1_2_IRQn);
+    Dsp_DecimInit(&rxDecim, decim);
+    Dsp_RingReset(&rxRing);
+    NVIC_EnableIRQ(ADC1_2_IRQn);
+
+    if (Dtmf_Enabled()) {
+        Dtmf_Configure(sampleRate / decim);
+    }
+
+    if (Ctcss_Enabled()) {
+        Ctcss_Configure(sampleRate / decim);
+    }
+
+    rxSampleRate = sampleRate;
+    InfoUpdate();
+}
+
+void Tone_RxSample(int16_t sample)
+{
+    /* Called at audio interrupt priority */
+    if (toneState != SETTINGS_REG_INFO_TONE1_STATE_RUN_ENUM) {
+        return;
+    }
+
+    if (Dsp_Decimate(&rxDecim, sample, &sample)) {
+        /* Remove the DC offset of the capture path */
+        rxDcAccu += sample - (rxDcAccu >> TONE_DC_SHIFT);
+        Dsp_RingWrite(&rxRing, sample - (rxDcAccu >> TONE_DC_SHIFT));
+    }
+}
+
+void Tone_Init(void)
+{
+    Dtmf_Init();
+    Ctcss_Init();
+
+    /* Buffers are allocated once, so the detectors are latched until next reboot */
+    if (!Dtmf_Enabled() && !Ctcss_Enabled()) {
+        toneState = SETTINGS_REG_INFO_TONE1_STATE_OFF_ENUM;
+        InfoUpdate();
+        return;
+    }
+
+    int16_t * rxBlocks = Pool_Alloc(POOL_CLIENT_AUDIO, TONE_RX_BLOCKS * TONE_BLOCK_LEN * sizeof(int16_t));
+
+    if (rxBlocks == NULL) {
+        toneState = SETTINGS_REG_INFO_TONE1_STATE_NOMEM_ENUM;
+        InfoUpdate();
+        return;
+    }
+
+    Dsp_RingInit(&rxRing, rxBlocks, TONE_BLOCK_LEN, TONE_RX_BLOCKS);
+    Dsp_DecimInit(&rxDecim, 1);
+
+    toneState = SETTINGS_REG_INFO_TONE1_STATE_RUN_ENUM;
+    InfoUpdate();
+}
+
+void Tone_Task(void)
+{
+    if (toneState != SETTINGS_REG_INFO_TONE1_STATE_RUN_ENUM) {
+        return;
+    }
+
+    uint32_t sampleRate = USB_AudioRxSampleRate();
+
+    if (sampleRate != rxSampleRate) {
+        RxConfig(sampleRate);
+    }
+
+    bool processed = false;
+    const int16_t * block;
+
+    while ((block = Dsp_RingRead(&rxRing)) != NULL) {
+        uint32_t startCycles = DWT->CYCCNT;
+
+        if (Dtmf_Enabled()) {
+            Dtmf_Process(block, TONE_BLOCK_LEN);
+        }
+
+        if (Ctcss_Enabled()) {
+            Ctcss_Process(block, TONE_BLOCK_LEN);
+        }
+
+        uint32_t cycles = DWT->CYCCNT - startCycles;
+
+        cyclesAvg = cyclesAvg - (cyclesAvg >> 4) + cycles;
+        if (cycles > cyclesMax) cyclesMax = cycles;
+
+        Dsp_RingRelease(&rxRing);
+        processed = true;
+
+        if (Tone_CosGate() && Ctcss_Match()) {
+            /* Keep the virtual COS asserted while the tone is present, its timeout provides the hang time */
+            USB_AudioVirtualCosTrigger();
+        }
+    }
+
+    if (processed) {
+        InfoUpdate();
+    }
+}
+
+bool Tone_Enabled(void)
+{
+    return toneState == SETTINGS_REG_INFO_TONE1_STATE_RUN_ENUM;
+}
+
+bool Tone_CosGate(void)
+{
+    return Tone_Enabled() && Ctcss_Enabled() && SETTINGS_GET(SETTINGS_REG_CTCSS_CTRL, COSGATE);
+}
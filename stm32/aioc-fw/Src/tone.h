@@ -0,0 +1,24 @@
+#ifndef TONE_H_
+#define TONE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* On-device tone analysis. Capture samples are taken from the ADC interrupt (alongside USB audio),
+ * decimated to a narrowband rate and collected into blocks which are handed to the tone detectors from the main loop.
+ * Runs whenever one of the detectors is enabled, independent of the host recording. Buffers are taken from the audio pool partition. */
+#define TONE_RATE               8000 /* Capture rate is decimated to no less than this */
+#define TONE_BLOCK_LEN          64   /* Samples per processing block */
+#define TONE_RX_BLOCKS          3
+
+void Tone_Init(void);
+void Tone_Task(void);
+bool Tone_Enabled(void);
+
+/* True, when the virtual COS is driven by the CTCSS detector instead of the capture level */
+bool Tone_CosGate(void);
+
+/* Called by the ADC interrupt for every capture sample */
+void Tone_RxSample(int16_t sample);
+
+#endif /* TONE_H_ */
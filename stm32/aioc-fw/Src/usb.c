@@ -5,6 +5,7 @@
 #include "usb_serial.h"
 #include "usb_audio.h"
 #include "usb_hid.h"
+#include "usb_control.h"
 
 // FIXME: Do all three need to be handled, or just the LP one?
 // USB high-priority interrupt (Channel 74): Triggered only by a correct
@@ -110,6 +111,7 @@ void USB_Init(void)
     USB_SerialInit();
     USB_AudioInit();
     USB_HIDInit();
+    USB_ControlInit();
 
     // Start USB Stack
     tud_init(BOARD_TUD_RHPORT);
@@ -121,6 +123,8 @@ void USB_Init(void)
 void USB_Task(void)
 {
     USB_SerialTask();
+    USB_HIDTask();
+    USB_ControlTask();
     tud_task();
 }
 
@@ -5,7 +5,15 @@
 #include "tusb.h"
 #include "usb.h"
 #include "cos.h"
+#include "modem.h"
+#include "tone.h"
+#include "subtone.h"
+#include "vox.h"
+#include "preroll.h"
+#include "filter.h"
+#include "limiter.h"
 #include <math.h>
+#include <string.h>
 
 /* The one and only supported sample rate */
 #define DEFAULT_SAMPLE_RATE   	48000
@@ -56,6 +64,14 @@ static volatile uint32_t microphoneSampleFreqCfg; /* Actual configured sample ra
 static volatile uint32_t speakerSampleFreqCfg; /* Actual configured sample rate in the timer hardware. May be different from requested for odd sample rates */
 static volatile state_t microphoneState = STATE_OFF;
 static volatile state_t speakerState = STATE_OFF;
+static vox_t vpttVox;
+static vox_t vcosVox;
+static volatile bool vpttState = false;
+static volatile bool vcosState = false;
+static int16_t rxFilterBlock[FILTER_BLOCK_LEN];
+static int16_t txFilterBlock[FILTER_BLOCK_LEN];
+static uint8_t rxFilterPos = 0;
+static uint8_t txFilterPos = FILTER_BLOCK_LEN;
 
 static audio_control_range_4_n_t(SAMPLERATE_COUNT) sampleFreqRng = {
     .wNumSubRanges = SAMPLERATE_COUNT,
@@ -76,6 +92,9 @@ static void Timer_ADC_Init(void);
 static void Timer_DAC_Init(void);
 static void ADC_Init(void);
 static void DAC_Init(void);
+static bool RX_Continuous(void);
+static bool TX_Continuous(void);
+static usb_audio_rxgain_t RX_GainSetting(void);
 static void RX_Config(usb_audio_rxgain_t rxGain);
 static void TX_Config(usb_audio_txboost_t txBoost);
 static void Timeout_Timers_Init(void);
@@ -519,18 +538,10 @@ bool tud_audio_tx_done_pre_load_cb(uint8_t rhport, uint8_t itf, uint8_t ep_in, u
 
     if (microphoneState == STATE_START) {
         /* Start ADC sampling as soon as device stacks starts loading data (will be a ZLP for first frame) */
-        uint8_t rxGainSetting = (settingsRegMap[SETTINGS_REG_AUDIO_RX] & SETTINGS_REG_AUDIO_RX_RXGAIN_MASK) >> SETTINGS_REG_AUDIO_RX_RXGAIN_OFFS;
-        usb_audio_rxgain_t rxGain =
-                (rxGainSetting == SETTINGS_REG_AUDIO_RX_RXGAIN_1X_ENUM) ? USB_AUDIO_RXGAIN_1X :
-                (rxGainSetting == SETTINGS_REG_AUDIO_RX_RXGAIN_2X_ENUM) ? USB_AUDIO_RXGAIN_2X :
-                (rxGainSetting == SETTINGS_REG_AUDIO_RX_RXGAIN_4X_ENUM) ? USB_AUDIO_RXGAIN_4X :
-                (rxGainSetting == SETTINGS_REG_AUDIO_RX_RXGAIN_8X_ENUM) ? USB_AUDIO_RXGAIN_8X :
-                (rxGainSetting == SETTINGS_REG_AUDIO_RX_RXGAIN_16X_ENUM) ? USB_AUDIO_RXGAIN_16X :
-                USB_AUDIO_RXGAIN_1X;
-
-        RX_Config(rxGain);
+        RX_Config(RX_GainSetting());
 
         NVIC_EnableIRQ(ADC1_2_IRQn);
+        rxFilterPos = 0; /* Start on a block boundary */
         microphoneState = STATE_RUN;
 
         /* Update debug register */
@@ -553,7 +564,8 @@ bool tud_audio_rx_done_post_read_cb(uint8_t rhport, uint16_t n_bytes_received, u
 
     if (speakerState == STATE_START) {
         if (count >= SPEAKER_BUFFERLVL_TARGET) {
-            /* Wait until we are at buffer target fill level, then start DAC output */
+            /* Wait until we are at buffer target fill level, then start DAC output on a block boundary */
+            txFilterPos = FILTER_BLOCK_LEN;
             speakerState = STATE_RUN;
             TX_Config((settingsRegMap[SETTINGS_REG_AUDIO_TX] & SETTINGS_REG_AUDIO_TX_TXBOOST_MASK) ? USB_AUDIO_TXBOOST_ON : USB_AUDIO_TXBOOST_OFF);
             NVIC_EnableIRQ(TIM6_DAC1_IRQn);
@@ -631,8 +643,10 @@ bool tud_audio_set_itf_close_EP_cb(uint8_t rhport, tusb_control_request_t const
 
     switch (itf) {
     case ITF_NUM_AUDIO_STREAMING_IN:
-        /* Microphone channel has been stopped */
-        NVIC_DisableIRQ(ADC1_2_IRQn);
+        /* Microphone channel has been stopped. Keep sampling, if the modem or the tone detectors are listening */
+        if (!RX_Continuous()) {
+            NVIC_DisableIRQ(ADC1_2_IRQn);
+        }
         microphoneState = STATE_OFF;
 
         /* Update debug register */
@@ -641,8 +655,10 @@ bool tud_audio_set_itf_close_EP_cb(uint8_t rhport, tusb_control_request_t const
         break;
 
     case ITF_NUM_AUDIO_STREAMING_OUT:
-        /* Speaker channel has been stopped */
-        NVIC_DisableIRQ(TIM6_DAC1_IRQn);
+        /* Speaker channel has been stopped. Keep the DAC running, if the modem or the tone encoder may transmit */
+        if (!TX_Continuous()) {
+            NVIC_DisableIRQ(TIM6_DAC1_IRQn);
+        }
         speakerState = STATE_OFF;
 
         /* Update debug register */
@@ -747,12 +763,27 @@ void ADC1_2_IRQHandler (void)
             sample = ((int32_t) ADC2->DR - 32768) & 0xFFFFU;
         }
 
-        /* Automatic COS */
-        uint16_t cosThreshold = (settingsRegMap[SETTINGS_REG_VCOS_LVLCTRL] & SETTINGS_REG_VCOS_LVLCTRL_THRSHLD_MASK) >> SETTINGS_REG_VCOS_LVLCTRL_THRSHLD_OFFS;
+        /* On-device modem and tone detectors get the raw sample independent of USB volume and mute */
+        Modem_RxSample(sample);
+        Tone_RxSample(sample);
 
-        if (!microphoneMute[1] && ( (sample > cosThreshold) || (sample < -cosThreshold) )) {
-            /* Reset timeout and make sure timer is enabled */
-            TIM17->EGR = TIM_EGR_UG; /* Generate an update event in the timer */
+        /* Automatic COS */
+        if (SETTINGS_GET(SETTINGS_REG_VCOS_VOXCTRL, MODE) == SETTINGS_REG_VCOS_VOXCTRL_MODE_ENVELOPE_ENUM) {
+            /* The timer is only touched on transitions of the envelope detector (unless the COS is driven by the CTCSS detector) */
+            vox_event_t event = Vox_Sample(&vcosVox, !microphoneMute[1] && !Tone_CosGate() ? sample : 0);
+
+            if (event == VOX_EVENT_ON) {
+                TIM17->EGR = TIM_EGR_UG; /* Generate an update event in the timer */
+            } else if (event == VOX_EVENT_OFF) {
+                TIM17->EGR = TIM_EGR_CC1G; /* Generate a compare event in the timer */
+            }
+        } else {
+            uint16_t cosThreshold = (settingsRegMap[SETTINGS_REG_VCOS_LVLCTRL] & SETTINGS_REG_VCOS_LVLCTRL_THRSHLD_MASK) >> SETTINGS_REG_VCOS_LVLCTRL_THRSHLD_OFFS;
+
+            if (!microphoneMute[1] && ( (sample > cosThreshold) || (sample < -cosThreshold) ) && !Tone_CosGate()) {
+                /* Reset timeout and make sure timer is enabled (unless the COS is driven by the CTCSS detector) */
+                TIM17->EGR = TIM_EGR_UG; /* Generate an update event in the timer */
+            }
         }
 
         /* Get volume */
@@ -762,7 +793,20 @@ void ADC1_2_IRQHandler (void)
         sample = (int16_t) (((int32_t) sample * volume + (sample > 0 ? 32768 : -32768)) / 65536);
 
         /* Store in FIFO */
-        tud_audio_write (&sample, sizeof(sample));
+        if (microphoneState == STATE_RUN) {
+            if (Filter_Enabled(FILTER_PATH_RX)) {
+                /* The filter runs on blocks, which are written to the FIFO at once */
+                rxFilterBlock[rxFilterPos++] = sample;
+
+                if (rxFilterPos >= FILTER_BLOCK_LEN) {
+                    Filter_Process(FILTER_PATH_RX, rxFilterBlock);
+                    tud_audio_write (rxFilterBlock, sizeof(rxFilterBlock));
+                    rxFilterPos = 0;
+                }
+            } else {
+                tud_audio_write (&sample, sizeof(sample));
+            }
+        }
     }
 }
 
@@ -773,21 +817,58 @@ void TIM6_DAC_IRQHandler(void)
         int16_t sample = 0x0000;
 
         /* Read from FIFO, leave sample at 0 if fifo empty */
-        tud_audio_read(&sample, sizeof(sample));
-
-        /* Automatic PTT */
-        uint16_t pttThreshold = (settingsRegMap[SETTINGS_REG_VPTT_LVLCTRL] & SETTINGS_REG_VPTT_LVLCTRL_THRSHLD_MASK) >> SETTINGS_REG_VPTT_LVLCTRL_THRSHLD_OFFS;
-
-        if (!speakerMute[1] && ( (sample > pttThreshold) || (sample < -pttThreshold) )) {
-            /* Reset timeout and make sure timer is enabled */
-            TIM16->EGR = TIM_EGR_UG; /* Generate an update event in the timer */
+        if (speakerState == STATE_RUN) {
+            if (Filter_Enabled(FILTER_PATH_TX)) {
+                /* The filter runs on blocks, which are read from the FIFO at once */
+                if (txFilterPos >= FILTER_BLOCK_LEN) {
+                    memset(txFilterBlock, 0, sizeof(txFilterBlock));
+                    tud_audio_read(txFilterBlock, sizeof(txFilterBlock));
+                    Filter_Process(FILTER_PATH_TX, txFilterBlock);
+                    txFilterPos = 0;
+                }
+
+                sample = txFilterBlock[txFilterPos++];
+            } else {
+                tud_audio_read(&sample, sizeof(sample));
+            }
         }
 
-        /* Get volume */
-        uint16_t volume = !speakerMute[1] ? speakerLinVolume[1] : 0;
+        /* While the on-device modem is transmitting, it replaces the host audio */
+        if (!Modem_TxSample(&sample)) {
+            /* Automatic PTT */
+            if (SETTINGS_GET(SETTINGS_REG_VPTT_VOXCTRL, MODE) == SETTINGS_REG_VPTT_VOXCTRL_MODE_ENVELOPE_ENUM) {
+                /* The timer is only touched on transitions of the envelope detector */
+                vox_event_t event = Vox_Sample(&vpttVox, !speakerMute[1] ? sample : 0);
+
+                if (event == VOX_EVENT_ON) {
+                    TIM16->EGR = TIM_EGR_UG; /* Generate an update event in the timer */
+                } else if (event == VOX_EVENT_OFF) {
+                    TIM16->EGR = TIM_EGR_CC1G; /* Generate a compare event in the timer */
+                }
+            } else {
+                uint16_t pttThreshold = (settingsRegMap[SETTINGS_REG_VPTT_LVLCTRL] & SETTINGS_REG_VPTT_LVLCTRL_THRSHLD_MASK) >> SETTINGS_REG_VPTT_LVLCTRL_THRSHLD_OFFS;
+
+                if (!speakerMute[1] && ( (sample > pttThreshold) || (sample < -pttThreshold) )) {
+                    /* Reset timeout and make sure timer is enabled */
+                    TIM16->EGR = TIM_EGR_UG; /* Generate an update event in the timer */
+                }
+            }
+
+            /* The PTT was triggered by the undelayed sample, the radio gets the delayed one */
+            sample = Preroll_TxSample(sample);
+
+            /* Get volume */
+            uint16_t volume = !speakerMute[1] ? speakerLinVolume[1] : 0;
+
+            /* Scale with 16-bit unsigned volume and round */
+            sample = (int16_t) (((int32_t) sample * volume + (sample > 0 ? 32768 : -32768)) / 65536);
+
+            /* Keep the host audio within the deviation limit */
+            sample = Limiter_TxSample(sample);
+        }
 
-        /* Scale with 16-bit unsigned volume and round */
-        sample = (int16_t) (((int32_t) sample * volume + (sample > 0 ? 32768 : -32768)) / 65536);
+        /* Sub-audible tone is added independent of USB volume and mute */
+        sample = Subtone_TxMix(sample);
 
         /* Load DAC holding register with sample */
         DAC1->DHR12L1 = ((int32_t) sample + 32768) & 0xFFFFU;
@@ -800,11 +881,14 @@ void TIM16_IRQHandler(void)
     uint32_t flags = TIM16->SR;
 
     if (flags & TIM_SR_UIF) {
-        /* Timer was reset (via the EGR register). */
+        /* Timer was reset (via the EGR register). In envelope mode the detector signals the release, so the timer is not counting */
         uint32_t cr = TIM16->CR1;
-        if (!(cr & TIM_CR1_CEN)) {
-            /* If timer was not enabled previously, enable timer and assert PTT */
-            TIM16->CR1 = cr | TIM_CR1_CEN;
+        bool envelope = SETTINGS_GET(SETTINGS_REG_VPTT_VOXCTRL, MODE) == SETTINGS_REG_VPTT_VOXCTRL_MODE_ENVELOPE_ENUM;
+        TIM16->CR1 = envelope ? cr & ~TIM_CR1_CEN : cr | TIM_CR1_CEN;
+
+        if (!vpttState) {
+            /* If PTT was not asserted previously, assert PTT */
+            vpttState = true;
 
             /* Update debug register */
             settingsRegMap[SETTINGS_REG_INFO_AUDIO0] |= SETTINGS_REG_INFO_AIOC0_VPTTSTATE_MASK;
@@ -814,21 +898,21 @@ void TIM16_IRQHandler(void)
             pttMask |= settingsRegMap[SETTINGS_REG_AIOC_IOMUX0] & SETTINGS_REG_AIOC_IOMUX0_OUT1SRC_VPTT_MASK ? IO_PTT_MASK_PTT1 : 0;
             pttMask |= settingsRegMap[SETTINGS_REG_AIOC_IOMUX1] & SETTINGS_REG_AIOC_IOMUX1_OUT2SRC_VPTT_MASK ? IO_PTT_MASK_PTT2 : 0;
 
-            IO_PTTAssert(pttMask);
+            IO_PTTSourceAssert(IO_PTT_SOURCE_VPTT, pttMask);
         }
     } else if (flags & TIM_SR_CC1IF) {
-        /* The idle timeout (without any action on the DAC) was reached. Disable timer and deassert PTT */
+        /* The idle timeout (without any action on the DAC) was reached or the envelope detector released. Disable timer and deassert PTT */
         TIM16->CR1 &= ~TIM_CR1_CEN;
 
-        /* Update debug register */
-        settingsRegMap[SETTINGS_REG_INFO_AUDIO0] &= ~SETTINGS_REG_INFO_AIOC0_VPTTSTATE_MASK;
+        if (vpttState) {
+            vpttState = false;
 
-        /* Deassert enabled PTTs */
-        uint8_t pttMask = IO_PTT_MASK_NONE;
-        pttMask |= settingsRegMap[SETTINGS_REG_AIOC_IOMUX0] & SETTINGS_REG_AIOC_IOMUX0_OUT1SRC_VPTT_MASK ? IO_PTT_MASK_PTT1 : 0;
-        pttMask |= settingsRegMap[SETTINGS_REG_AIOC_IOMUX1] & SETTINGS_REG_AIOC_IOMUX1_OUT2SRC_VPTT_MASK ? IO_PTT_MASK_PTT2 : 0;
+            /* Update debug register */
+            settingsRegMap[SETTINGS_REG_INFO_AUDIO0] &= ~SETTINGS_REG_INFO_AIOC0_VPTTSTATE_MASK;
 
-        IO_PTTDeassert(pttMask);
+            /* Deassert the PTTs asserted above, unless another source still holds them */
+            IO_PTTSourceRelease(IO_PTT_SOURCE_VPTT, IO_PTT_MASK_ALL);
+        }
     }
 
     TIM16->SR = ~flags;
@@ -840,11 +924,15 @@ void TIM17_IRQHandler(void)
     uint32_t flags = TIM17->SR;
 
     if (flags & TIM_SR_UIF) {
-        /* Timer was reset (via the EGR register). */
+        /* Timer was reset (via the EGR register). In envelope mode the detector signals the release, so the timer is not counting.
+         * The CTCSS detector has no release event and relies on the timeout, so the timer keeps counting while it drives the COS */
         uint32_t cr = TIM17->CR1;
-        if (!(cr & TIM_CR1_CEN)) {
-            /* If timer was not enabled previously, enable timer and notify host of COS */
-            TIM17->CR1 = cr | TIM_CR1_CEN;
+        bool envelope = (SETTINGS_GET(SETTINGS_REG_VCOS_VOXCTRL, MODE) == SETTINGS_REG_VCOS_VOXCTRL_MODE_ENVELOPE_ENUM) && !Tone_CosGate();
+        TIM17->CR1 = envelope ? cr & ~TIM_CR1_CEN : cr | TIM_CR1_CEN;
+
+        if (!vcosState) {
+            /* If COS was not set previously, notify host of COS */
+            vcosState = true;
 
             /* Update debug register */
             settingsRegMap[SETTINGS_REG_INFO_AUDIO0] |= SETTINGS_REG_INFO_AIOC0_VCOSSTATE_MASK;
@@ -853,14 +941,18 @@ void TIM17_IRQHandler(void)
             COS_VirtualSetState(0x01);
         }
     } else if (flags & TIM_SR_CC1IF) {
-        /* The idle timeout (without any action on the ADC) was reached. Disable timer and notify host */
+        /* The idle timeout (without any action on the ADC) was reached or the envelope detector released. Disable timer and notify host */
         TIM17->CR1 &= ~TIM_CR1_CEN;
 
-        /* Update debug register */
-        settingsRegMap[SETTINGS_REG_INFO_AUDIO0] &= ~SETTINGS_REG_INFO_AIOC0_VCOSSTATE_MASK;
+        if (vcosState) {
+            vcosState = false;
+
+            /* Update debug register */
+            settingsRegMap[SETTINGS_REG_INFO_AUDIO0] &= ~SETTINGS_REG_INFO_AIOC0_VCOSSTATE_MASK;
 
-        /* Set COS state */
-        COS_VirtualSetState(0x00);
+            /* Set COS state */
+            COS_VirtualSetState(0x00);
+        }
     }
 
     TIM17->SR = ~flags;
@@ -1034,6 +1126,30 @@ static void DAC_Init(void)
     DAC1->DHR12L1 = 32768;
 }
 
+static bool RX_Continuous(void)
+{
+    /* Capture runs independent of the host recording */
+    return Modem_Enabled() || Tone_Enabled();
+}
+
+static bool TX_Continuous(void)
+{
+    /* Playback runs independent of the host playing */
+    return Modem_Enabled() || Subtone_Enabled() || Preroll_Enabled();
+}
+
+static usb_audio_rxgain_t RX_GainSetting(void)
+{
+    uint8_t rxGainSetting = (settingsRegMap[SETTINGS_REG_AUDIO_RX] & SETTINGS_REG_AUDIO_RX_RXGAIN_MASK) >> SETTINGS_REG_AUDIO_RX_RXGAIN_OFFS;
+
+    return  (rxGainSetting == SETTINGS_REG_AUDIO_RX_RXGAIN_1X_ENUM) ? USB_AUDIO_RXGAIN_1X :
+            (rxGainSetting == SETTINGS_REG_AUDIO_RX_RXGAIN_2X_ENUM) ? USB_AUDIO_RXGAIN_2X :
+            (rxGainSetting == SETTINGS_REG_AUDIO_RX_RXGAIN_4X_ENUM) ? USB_AUDIO_RXGAIN_4X :
+            (rxGainSetting == SETTINGS_REG_AUDIO_RX_RXGAIN_8X_ENUM) ? USB_AUDIO_RXGAIN_8X :
+            (rxGainSetting == SETTINGS_REG_AUDIO_RX_RXGAIN_16X_ENUM) ? USB_AUDIO_RXGAIN_16X :
+            USB_AUDIO_RXGAIN_1X;
+}
+
 static void RX_Config(usb_audio_rxgain_t rxGain)
 {
     /* Disable OPAMPs */
@@ -1105,6 +1221,7 @@ static void Timeout_Timers_Init(void)
 {
     uint32_t timerFreq = (HAL_RCC_GetHCLKFreq() == HAL_RCC_GetPCLK2Freq()) ? HAL_RCC_GetPCLK2Freq() : 2 * HAL_RCC_GetPCLK2Freq();
     uint32_t pttTimeout = (settingsRegMap[SETTINGS_REG_VPTT_TIMCTRL] & SETTINGS_REG_VPTT_TIMCTRL_TIMEOUT_MASK) >> SETTINGS_REG_VPTT_TIMCTRL_TIMEOUT_OFFS;
+    pttTimeout = Preroll_PttTimeout(pttTimeout); /* Hold PTT until the delayed audio has been played */
     uint32_t cosTimeout = (settingsRegMap[SETTINGS_REG_VCOS_TIMCTRL] & SETTINGS_REG_VCOS_TIMCTRL_TIMEOUT_MASK) >> SETTINGS_REG_VCOS_TIMCTRL_TIMEOUT_OFFS;
 
     __HAL_RCC_TIM16_CLK_ENABLE();
@@ -1136,7 +1253,22 @@ void USB_AudioInit(void)
     ADC_Init();
     DAC_Init();
 
+    Vox_Init(&vpttVox, VOX_SOURCE_VPTT);
+    Vox_Init(&vcosVox, VOX_SOURCE_VCOS);
     Timeout_Timers_Init();
+
+    if (RX_Continuous()) {
+        /* The modem and the tone detectors listen continuously, not only while the host is recording */
+        RX_Config(RX_GainSetting());
+        NVIC_EnableIRQ(ADC1_2_IRQn);
+    }
+
+    if (TX_Continuous()) {
+        /* The modem may transmit and the tone encoder may follow the PTT at any time, not only while the host is playing.
+         * The pre-roll delay line has to play out the end of the audio after the host stopped */
+        TX_Config((settingsRegMap[SETTINGS_REG_AUDIO_TX] & SETTINGS_REG_AUDIO_TX_TXBOOST_MASK) ? USB_AUDIO_TXBOOST_ON : USB_AUDIO_TXBOOST_OFF);
+        NVIC_EnableIRQ(TIM6_DAC1_IRQn);
+    }
 }
 
 void USB_AudioGetSpeakerFeedbackStats(usb_audio_fbstats_t * status)
@@ -1157,3 +1289,30 @@ void USB_AudioGetSpeakerBufferStats(usb_audio_bufstats_t * status)
     };
 
 }
+
+void USB_AudioVirtualCosTrigger(void)
+{
+    if (!microphoneMute[1]) {
+        /* Same as the level based automatic COS: reset timeout and make sure timer is enabled */
+        TIM17->EGR = TIM_EGR_UG;
+    }
+}
+
+void USB_AudioFilterRestart(filter_path_t path)
+{
+    if (path == FILTER_PATH_RX) {
+        rxFilterPos = 0;
+    } else {
+        txFilterPos = FILTER_BLOCK_LEN;
+    }
+}
+
+uint32_t USB_AudioRxSampleRate(void)
+{
+    return microphoneSampleFreqCfg;
+}
+
+uint32_t USB_AudioTxSampleRate(void)
+{
+    return speakerSampleFreqCfg;
+}
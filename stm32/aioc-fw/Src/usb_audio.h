@@ -2,6 +2,7 @@
 #define USB_AUDIO_H_
 
 #include <stdint.h>
+#include "filter.h"
 
 typedef enum {
     USB_AUDIO_RXGAIN_1X,
@@ -31,5 +32,10 @@ typedef struct {
 void USB_AudioInit(void);
 void USB_AudioGetSpeakerFeedbackStats(usb_audio_fbstats_t * status);
 void USB_AudioGetSpeakerBufferStats(usb_audio_bufstats_t * status);
+void USB_AudioVirtualCosTrigger(void);
+/* Called with interrupts disabled, when the filter of a path is reconfigured. Drops the partially collected block */
+void USB_AudioFilterRestart(filter_path_t path);
+uint32_t USB_AudioRxSampleRate(void);
+uint32_t USB_AudioTxSampleRate(void);
 
 #endif /* USB_AUDIO_H_ */
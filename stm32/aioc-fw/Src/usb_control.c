@@ -0,0 +1,341 @@
+#include "usb_control.h"
+#include "stm32f3xx_hal.h"
+#include "tusb.h"
+#include "settings.h"
+#include "kiss.h"
+#include "dtmf.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define REGLINE_LEN     13 /* "aa=vvvvvvvv\r\n" */
+
+static bool controlEnabled = false;
+
+static char lineBuffer[USB_CONTROL_LINE_LEN];
+static uint8_t lineLength = 0;
+static bool lineOverflow = false;
+
+static bool dumpActive = false;
+static uint16_t dumpAddress;
+static uint16_t dumpEnd;
+
+static uint32_t traceInterval = 0;
+static uint32_t traceTick;
+static uint8_t traceRegs[USB_CONTROL_TRACE_REGS];
+static uint8_t traceCount;
+
+static uint8_t dtmfReported = 0;
+
+static char * FormatHex(char * p, uint32_t value, uint8_t digits)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    for (uint8_t i = 0; i < digits; i++) {
+        p[i] = hex[(value >> (4 * (digits - 1 - i))) & 0xF];
+    }
+
+    return p + digits;
+}
+
+static char * FormatReg(char * p, uint8_t address)
+{
+    uint32_t value = 0;
+    Settings_RegRead(address, &value);
+
+    p = FormatHex(p, address, 2);
+    *p++ = '=';
+    return FormatHex(p, value, 8);
+}
+
+static void WriteLine(const char * line)
+{
+    tud_cdc_n_write_str(USB_CONTROL_ITF, line);
+    tud_cdc_n_write_str(USB_CONTROL_ITF, "\r\n");
+}
+
+static char * NextToken(char ** cursor)
+{
+    char * p = *cursor;
+
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+
+    if (*p == '\0') {
+        return NULL;
+    }
+
+    char * token = p;
+
+    while (*p != '\0' && *p != ' ' && *p != '\t') {
+        p++;
+    }
+
+    if (*p != '\0') {
+        *p++ = '\0';
+    }
+
+    *cursor = p;
+    return token;
+}
+
+static bool ParseNumber(const char * token, uint32_t * value)
+{
+    char * end;
+    *value = strtoul(token, &end, 0);
+
+    return (end != token) && (*end == '\0');
+}
+
+static void DumpContinue(void)
+{
+    /* Emit as much as fits into the fifo, the remainder follows on the next task invocation */
+    while ((dumpAddress < dumpEnd) && (tud_cdc_n_write_available(USB_CONTROL_ITF) >= REGLINE_LEN)) {
+        char line[REGLINE_LEN];
+        char * p = FormatReg(line, dumpAddress++);
+        *p++ = '\r';
+        *p++ = '\n';
+        tud_cdc_n_write(USB_CONTROL_ITF, line, p - line);
+    }
+
+    if ((dumpAddress >= dumpEnd) && (tud_cdc_n_write_available(USB_CONTROL_ITF) >= 4)) {
+        WriteLine("OK");
+        dumpActive = false;
+    }
+}
+
+static void TraceTask(void)
+{
+    uint32_t nowTick = HAL_GetTick();
+
+    if ((traceInterval == 0) || ((nowTick - traceTick) < traceInterval)) {
+        return;
+    }
+
+    traceTick = nowTick;
+
+    char line[2 + 8 + USB_CONTROL_TRACE_REGS * (1 + REGLINE_LEN - 2) + 2];
+    char * p = line;
+
+    *p++ = 'T';
+    *p++ = ' ';
+    p = FormatHex(p, nowTick, 8);
+
+    for (uint8_t i = 0; i < traceCount; i++) {
+        *p++ = ' ';
+        p = FormatReg(p, traceRegs[i]);
+    }
+
+    *p++ = '\r';
+    *p++ = '\n';
+
+    /* Trace lines are dropped as a whole, when the host does not keep up */
+    if (tud_cdc_n_write_available(USB_CONTROL_ITF) >= (uint32_t) (p - line)) {
+        tud_cdc_n_write(USB_CONTROL_ITF, line, p - line);
+    }
+}
+
+static void DtmfTask(void)
+{
+    dtmf_event_t dtmf;
+    Dtmf_LastEvent(&dtmf);
+
+    if (dtmf.count == dtmfReported) {
+        return;
+    }
+
+    if (!SETTINGS_GET(SETTINGS_REG_DTMF_CTRL, CDCEVENT)) {
+        dtmfReported = dtmf.count;
+        return;
+    }
+
+    char line[2 + 8 + 2 + 2];
+    char * p = line;
+
+    *p++ = 'D';
+    *p++ = ' ';
+    p = FormatHex(p, dtmf.tick, 8);
+    *p++ = ' ';
+    *p++ = dtmf.digit;
+    *p++ = '\r';
+    *p++ = '\n';
+
+    /* Retried on the next task invocation, when the host does not keep up */
+    if (tud_cdc_n_write_available(USB_CONTROL_ITF) >= (uint32_t) (p - line)) {
+        tud_cdc_n_write(USB_CONTROL_ITF, line, p - line);
+        dtmfReported = dtmf.count;
+    }
+}
+
+static void Execute(char * line)
+{
+    char * cursor = line;
+    char * command = NextToken(&cursor);
+    uint32_t args[1 + USB_CONTROL_TRACE_REGS];
+    uint8_t argCount = 0;
+    char * token;
+
+    if (command == NULL) {
+        /* Empty line */
+        return;
+    }
+
+    while ((token = NextToken(&cursor)) != NULL) {
+        if (argCount >= sizeof(args) / sizeof(args[0])) {
+            WriteLine("ERR args");
+            return;
+        }
+
+        if (!ParseNumber(token, &args[argCount++])) {
+            WriteLine("ERR syntax");
+            return;
+        }
+    }
+
+    if (strcmp(command, "get") == 0) {
+        if ((argCount != 1) || (args[0] >= SETTINGS_REGMAP_SIZE)) {
+            WriteLine("ERR args");
+            return;
+        }
+
+        char reply[REGLINE_LEN];
+        *FormatReg(reply, args[0]) = '\0';
+        WriteLine(reply);
+    } else if (strcmp(command, "set") == 0) {
+        if ((argCount != 2) || (args[0] >= SETTINGS_REGMAP_SIZE)) {
+            WriteLine("ERR args");
+            return;
+        }
+
+        if (!Settings_RegWriteImmediate(args[0], args[1])) {
+            WriteLine("ERR readonly");
+            return;
+        }
+    } else if (strcmp(command, "dump") == 0) {
+        uint32_t address = (argCount > 0) ? args[0] : 0;
+        uint32_t count = (argCount > 1) ? args[1] : SETTINGS_REGMAP_SIZE - address;
+
+        if ((argCount > 2) || (address >= SETTINGS_REGMAP_SIZE) || (count == 0) || (count > SETTINGS_REGMAP_SIZE - address)) {
+            WriteLine("ERR args");
+            return;
+        }
+
+        dumpAddress = address;
+        dumpEnd = address + count;
+        dumpActive = true;
+        DumpContinue();
+        return;
+    } else if (strcmp(command, "stats") == 0) {
+        dumpAddress = SETTINGS_REGMAP_READONLYADDR;
+        dumpEnd = SETTINGS_REGMAP_SIZE;
+        dumpActive = true;
+        DumpContinue();
+        return;
+    } else if (strcmp(command, "trace") == 0) {
+        if ((argCount < 1) || ((args[0] != 0) && (args[0] < USB_CONTROL_TRACE_MINIVAL))) {
+            WriteLine("ERR args");
+            return;
+        }
+
+        for (uint8_t i = 1; i < argCount; i++) {
+            if (args[i] >= SETTINGS_REGMAP_SIZE) {
+                WriteLine("ERR args");
+                return;
+            }
+        }
+
+        if (argCount > 1) {
+            for (uint8_t i = 1; i < argCount; i++) {
+                traceRegs[i - 1] = args[i];
+            }
+            traceCount = argCount - 1;
+        } else {
+            /* Default to the signal states */
+            traceRegs[0] = SETTINGS_REG_INFO_AIOC0;
+            traceRegs[1] = SETTINGS_REG_INFO_AUDIO0;
+            traceCount = 2;
+        }
+
+        traceInterval = args[0];
+        traceTick = HAL_GetTick();
+    } else if (strcmp(command, "help") == 0) {
+        WriteLine("get <addr>");
+        WriteLine("set <addr> <value>");
+        WriteLine("dump [<addr> [<count>]]");
+        WriteLine("stats");
+        WriteLine("trace <ms> [<addr> ...]");
+    } else {
+        WriteLine("ERR command");
+        return;
+    }
+
+    WriteLine("OK");
+}
+
+void USB_ControlInit(void)
+{
+    /* The interface is part of the configuration descriptor, so it is latched until next reboot */
+    controlEnabled = SETTINGS_GET(SETTINGS_REG_CTLCDC_CTRL, ENABLE) != 0;
+}
+
+void USB_ControlTask(void)
+{
+    if (!controlEnabled) {
+        return;
+    }
+
+    if (!tud_cdc_n_connected(USB_CONTROL_ITF)) {
+        /* Start over with a clean session on the next connect */
+        lineLength = 0;
+        lineOverflow = false;
+        dumpActive = false;
+        traceInterval = 0;
+
+        /* Digits decoded before the session are not reported */
+        dtmf_event_t dtmf;
+        Dtmf_LastEvent(&dtmf);
+        dtmfReported = dtmf.count;
+        return;
+    }
+
+    if (SETTINGS_GET(SETTINGS_REG_CTLCDC_CTRL, PROTOCOL) == SETTINGS_REG_CTLCDC_CTRL_PROTOCOL_KISS_ENUM) {
+        /* The interface is handed to the modem */
+        Kiss_Task();
+        return;
+    }
+
+    if (dumpActive) {
+        /* Do not accept new commands, before the pending response is complete */
+        DumpContinue();
+    }
+
+    while (!dumpActive && (tud_cdc_n_available(USB_CONTROL_ITF) > 0)) {
+        int32_t c = tud_cdc_n_read_char(USB_CONTROL_ITF);
+
+        if ((c == '\r') || (c == '\n')) {
+            if (lineOverflow) {
+                WriteLine("ERR overflow");
+            } else {
+                lineBuffer[lineLength] = '\0';
+                Execute(lineBuffer);
+            }
+
+            lineLength = 0;
+            lineOverflow = false;
+        } else if (lineLength < (sizeof(lineBuffer) - 1)) {
+            lineBuffer[lineLength++] = (char) c;
+        } else {
+            lineOverflow = true;
+        }
+    }
+
+    TraceTask();
+    DtmfTask();
+
+    tud_cdc_n_write_flush(USB_CONTROL_ITF);
+}
+
+bool USB_ControlEnabled(void)
+{
+    return controlEnabled;
+}
@@ -0,0 +1,27 @@
+#ifndef USB_CONTROL_H_
+#define USB_CONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Line-based control protocol on the second CDC interface (unless it is switched to KISS).
+ * Commands are terminated by CR and/or LF, numbers are given in decimal or as 0x prefixed hex. Every command is answered by "OK" or "ERR <reason>",
+ * multi-line responses precede the final "OK".
+ *   get <addr>                   Read a register:           "aa=vvvvvvvv"
+ *   set <addr> <value>           Write a register
+ *   dump [<addr> [<count>]]      Read a range of registers (default: complete register map)
+ *   stats                        Read all info registers
+ *   trace <ms> [<addr> ...]      Stream up to USB_CONTROL_TRACE_REGS registers periodically (0 stops):
+ *                                "T tttttttt aa=vvvvvvvv ..." with tttttttt being the millisecond tick
+ * Decoded DTMF digits are reported asynchronously as "D tttttttt c" (see DTMF_CTRL register)
+ *   help                         List commands */
+#define USB_CONTROL_ITF             1
+#define USB_CONTROL_LINE_LEN        64
+#define USB_CONTROL_TRACE_REGS      4
+#define USB_CONTROL_TRACE_MINIVAL   10 /* Minimum trace interval in ms */
+
+void USB_ControlInit(void);
+void USB_ControlTask(void);
+bool USB_ControlEnabled(void);
+
+#endif /* USB_CONTROL_H_ */
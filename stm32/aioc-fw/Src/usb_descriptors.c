@@ -25,6 +25,9 @@
 #include "tusb.h"
 #include "usb_descriptors.h"
 #include "settings.h"
+#include "usb_hid.h"
+#include "usb_control.h"
+#include "usb_vendor.h"
 #include "stm32f3xx_hal.h"
 
 /* For quirk detection, borrowed from tinyusb uac2_speaker_fb example */
@@ -80,47 +83,70 @@ uint8_t const* tud_descriptor_device_cb(void) {
 // HID Report Descriptor
 //--------------------------------------------------------------------+
 
+#define DESC_HID_REPORT_CM108_INPUT                                         \
+      /* Volume Up/Dn */                                                    \
+      HID_LOGICAL_MIN ( 0x00                                    ),          \
+      HID_LOGICAL_MAX ( 0x01                                    ),          \
+      HID_USAGE       ( 0x00 /* Unassigned */                   ),          \
+      HID_USAGE       ( 0x00 /* Unassigned */                   ),          \
+      HID_REPORT_SIZE ( 1                                       ),          \
+      HID_REPORT_COUNT( 2                                       ),          \
+      HID_INPUT       ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE  ),          \
+      /* Mute */                                                            \
+      HID_USAGE       ( 0x00 /* Unassigned */                   ),          \
+      HID_USAGE       ( 0x00 /* Unassigned */                   ),          \
+      HID_INPUT       ( HID_DATA | HID_VARIABLE | HID_RELATIVE  ),          \
+      /* Hook Switch */                                                     \
+      HID_USAGE_PAGE  ( HID_USAGE_PAGE_TELEPHONY                ),          \
+      HID_USAGE       ( 0x00 /* Unassigned */                   ),          \
+      HID_REPORT_COUNT( 1                                       ),          \
+      HID_INPUT       ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE | HID_NULL_STATE), \
+      /* Filler */                                                          \
+      HID_USAGE_PAGE  ( HID_USAGE_PAGE_CONSUMER                 ),          \
+      HID_USAGE       ( 0x00 /* Unassigned */                   ),          \
+      HID_REPORT_COUNT( 3                                       ),          \
+      HID_INPUT       ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE  ),          \
+      /* GPIO and Status */                                                 \
+      HID_LOGICAL_MAX_N ( 0xFF, 2                               ),          \
+      HID_USAGE       ( 0x00 /* Unassigned */                   ),          \
+      HID_REPORT_SIZE ( 8                                       ),          \
+      HID_REPORT_COUNT( 3                                       ),          \
+      HID_INPUT       ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE  )
+
+#define DESC_HID_REPORT_CM108_OUTPUT_FEATURE                                \
+      /* Output */                                                          \
+      HID_USAGE       ( 0x00 /* Unassigned */                   ),          \
+      HID_REPORT_COUNT( 4                                       ),          \
+      HID_OUTPUT      ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE  ),          \
+      /* Feature for configuring AIOC */                                    \
+      HID_USAGE       ( 0x00 /* Unassigned */                   ),          \
+      HID_REPORT_COUNT( 6                                       ),          \
+      HID_FEATURE     ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE  )
+
 uint8_t const desc_hid_report[] = {
     /* CM108 emulation. */
     HID_USAGE_PAGE   ( HID_USAGE_PAGE_CONSUMER ),
     HID_USAGE        ( HID_USAGE_CONSUMER_CONTROL ),
     HID_COLLECTION   ( HID_COLLECTION_APPLICATION ),
-      /* Volume Up/Dn */
-      HID_LOGICAL_MIN ( 0x00                                    ),
-      HID_LOGICAL_MAX ( 0x01                                    ),
-      HID_USAGE       ( 0x00 /* Unassigned */                   ),
-      HID_USAGE       ( 0x00 /* Unassigned */                   ),
-      HID_REPORT_SIZE ( 1                                       ),
-      HID_REPORT_COUNT( 2                                       ),
+      DESC_HID_REPORT_CM108_INPUT,
+      DESC_HID_REPORT_CM108_OUTPUT_FEATURE,
+    HID_COLLECTION_END
+};
+
+uint8_t const desc_hid_report_telemetry[] = {
+    /* CM108 emulation with the input report extended by vendor defined telemetry.
+     * No report IDs are used, so the CM108 part of the reports stays where it is. */
+    HID_USAGE_PAGE   ( HID_USAGE_PAGE_CONSUMER ),
+    HID_USAGE        ( HID_USAGE_CONSUMER_CONTROL ),
+    HID_COLLECTION   ( HID_COLLECTION_APPLICATION ),
+      DESC_HID_REPORT_CM108_INPUT,
+      /* Telemetry */
+      HID_USAGE_PAGE_N( HID_USAGE_PAGE_VENDOR, 2                ),
+      HID_USAGE       ( 0x01                                    ),
+      HID_REPORT_COUNT( USB_HID_TELEMETRY_REPORT_LEN - USB_HID_INOUT_REPORT_LEN ),
       HID_INPUT       ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE  ),
-      /* Mute */
-      HID_USAGE       ( 0x00 /* Unassigned */                   ),
-      HID_USAGE       ( 0x00 /* Unassigned */                   ),
-      HID_INPUT       ( HID_DATA | HID_VARIABLE | HID_RELATIVE  ),
-      /* Hook Switch */
-      HID_USAGE_PAGE  ( HID_USAGE_PAGE_TELEPHONY                ),
-      HID_USAGE       ( 0x00 /* Unassigned */                   ),
-      HID_REPORT_COUNT( 1                                       ),
-      HID_INPUT       ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE | HID_NULL_STATE),
-      /* Filler */
       HID_USAGE_PAGE  ( HID_USAGE_PAGE_CONSUMER                 ),
-      HID_USAGE       ( 0x00 /* Unassigned */                   ),
-      HID_REPORT_COUNT( 3                                       ),
-      HID_INPUT       ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE  ),
-      /* GPIO and Status */
-      HID_LOGICAL_MAX_N ( 0xFF, 2                               ),
-      HID_USAGE       ( 0x00 /* Unassigned */                   ),
-      HID_REPORT_SIZE ( 8                                       ),
-      HID_REPORT_COUNT( 3                                       ),
-      HID_INPUT       ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE  ),
-      /* Output */
-      HID_USAGE       ( 0x00 /* Unassigned */                   ),
-      HID_REPORT_COUNT( 4                                       ),
-      HID_OUTPUT      ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE  ),
-      /* Feature for configuring AIOC */
-      HID_USAGE       ( 0x00 /* Unassigned */                   ),
-      HID_REPORT_COUNT( 6                                       ),
-      HID_FEATURE     ( HID_DATA | HID_VARIABLE | HID_ABSOLUTE  ),
+      DESC_HID_REPORT_CM108_OUTPUT_FEATURE,
     HID_COLLECTION_END
 };
 
@@ -130,7 +156,12 @@ uint8_t const desc_hid_report[] = {
 uint8_t const * tud_hid_descriptor_report_cb(uint8_t itf)
 {
     (void) itf;
-    return desc_hid_report;
+
+    if (USB_HIDTelemetryEnabled()) {
+        return desc_hid_report_telemetry;
+    } else {
+        return desc_hid_report;
+    }
 }
 
 //--------------------------------------------------------------------+
@@ -141,16 +172,20 @@ uint8_t const * tud_hid_descriptor_report_cb(uint8_t itf)
         AIOC_AUDIO_DESC_LEN + \
         AIOC_HID_DESC_LEN + \
         AIOC_CDC_DESC_LEN + \
-        AIOC_DFU_RT_DESC_LEN \
+        AIOC_DFU_RT_DESC_LEN + \
+        AIOC_VENDOR_DESC_LEN \
 )
 
-/* Make this as template, due to quirks necessary in feedback endpoint size */
-#define CONFIG_DESC(_quirk)                                                     \
+#define CONFIG_CONTROL_LEN AIOC_CDC_DESC_LEN
+
+/* Make this as template, due to quirks necessary in feedback endpoint size, optional HID telemetry
+ * and the optional control CDC. The latter is appended with CONFIG_DESC_CONTROL */
+#define CONFIG_DESC(_quirk, _telemetry, _control)                               \
     TUD_CONFIG_DESCRIPTOR(                                                      \
         /* config_num */    1,                                                  \
-        /* _itfcount */     ITF_NUM_TOTAL,                                      \
+        /* _itfcount */     ((_control) ? ITF_NUM_TOTAL : ITF_NUM_CDC_1),       \
         /* _stridx */       0x00,                                               \
-        /* _total_len */    CONFIG_TOTAL_LEN,                                   \
+        /* _total_len */    CONFIG_TOTAL_LEN + ((_control) ? CONFIG_CONTROL_LEN : 0), \
         /* _attribute */    0x00,                                               \
         /* _power_ma */     100                                                 \
     ),                                                                          \
@@ -170,9 +205,9 @@ uint8_t const * tud_hid_descriptor_report_cb(uint8_t itf)
         /* _itfnum */       ITF_NUM_HID,                                        \
         /* _stridx */       STR_IDX_HIDITF,                                     \
         /* _boot_protocol */HID_ITF_PROTOCOL_NONE,                              \
-        /*_report_desc_len*/sizeof(desc_hid_report),                            \
+        /*_report_desc_len*/((_telemetry) ? sizeof(desc_hid_report_telemetry) : sizeof(desc_hid_report)), \
         /* _epin */         EPNUM_HID_IN,                                       \
-        /* _epsize */       CFG_TUD_HID_EP_BUFSIZE,                             \
+        /* _epsize */       ((_telemetry) ? USB_HID_TELEMETRY_REPORT_LEN : 8),  \
         /* _ep_interval */  0x20                                                \
     ),                                                                          \
     AIOC_CDC_DESCRIPTOR(                                                        \
@@ -192,17 +227,60 @@ uint8_t const * tud_hid_descriptor_report_cb(uint8_t itf)
                             DFU_ATTR_CAN_DOWNLOAD,                              \
         /* _timeout */      255, /* not used if WILL_DETACH */                  \
         /* _xfer_size */    2048 /* max size for stm32 dfu bootloader */        \
+    ),                                                                          \
+    AIOC_VENDOR_DESCRIPTOR(                                                     \
+        /* _itfnum */       ITF_NUM_VENDOR,                                     \
+        /* _stridx */       STR_IDX_VENDORITF                                   \
+    )
+
+#define CONFIG_DESC_CONTROL                                                     \
+    AIOC_CDC_DESCRIPTOR(                                                        \
+        /* _itfnum */       ITF_NUM_CDC_1,                                      \
+        /* _stridx */       STR_IDX_CTLCDCITF,                                  \
+        /* _ep_notif */     EPNUM_CDC_1_NOTIF,                                  \
+        /* _ep_notif_size */ EPSIZE_CDC_1_NOTIF,                                \
+        /* _epout */        EPNUM_CDC_1_OUT,                                    \
+        /* _epin */         EPNUM_CDC_1_IN,                                     \
+        /* _epsize */       EPSIZE_CDC_1                                        \
     )
 
 uint8_t const desc_fs_configuration_quirk[] = {
     /* quirk is required for Windows, Linux doesn't care.
      * (see https://github.com/hathach/tinyusb/pull/2328/commits/6a67bac47c0f83eebd63ca99654ed26e51b21145) */
-    CONFIG_DESC(/* quirk */1)
+    CONFIG_DESC(/* quirk */1, /* telemetry */0, /* control */0)
 };
 
 uint8_t const desc_fs_configuration[] = {
     /* no quirk is required for MacOS, Linux doesn't care */
-    CONFIG_DESC(/* quirk */0)
+    CONFIG_DESC(/* quirk */0, /* telemetry */0, /* control */0)
+};
+
+uint8_t const desc_fs_configuration_quirk_telemetry[] = {
+    CONFIG_DESC(/* quirk */1, /* telemetry */1, /* control */0)
+};
+
+uint8_t const desc_fs_configuration_telemetry[] = {
+    CONFIG_DESC(/* quirk */0, /* telemetry */1, /* control */0)
+};
+
+uint8_t const desc_fs_configuration_quirk_control[] = {
+    CONFIG_DESC(/* quirk */1, /* telemetry */0, /* control */1),
+    CONFIG_DESC_CONTROL
+};
+
+uint8_t const desc_fs_configuration_control[] = {
+    CONFIG_DESC(/* quirk */0, /* telemetry */0, /* control */1),
+    CONFIG_DESC_CONTROL
+};
+
+uint8_t const desc_fs_configuration_quirk_telemetry_control[] = {
+    CONFIG_DESC(/* quirk */1, /* telemetry */1, /* control */1),
+    CONFIG_DESC_CONTROL
+};
+
+uint8_t const desc_fs_configuration_telemetry_control[] = {
+    CONFIG_DESC(/* quirk */0, /* telemetry */1, /* control */1),
+    CONFIG_DESC_CONTROL
 };
 
 // Invoked when received GET CONFIGURATION DESCRIPTOR
@@ -215,14 +293,72 @@ uint8_t const* tud_descriptor_configuration_cb(uint8_t index) {
 
     quirk_host_os_hint_desc_cb(TUSB_DESC_CONFIGURATION);
 
+    bool telemetry = USB_HIDTelemetryEnabled();
+
+    if (USB_ControlEnabled()) {
+        if (USB_DescUAC2Quirk()) {
+            return telemetry ? desc_fs_configuration_quirk_telemetry_control : desc_fs_configuration_quirk_control;
+        } else {
+            return telemetry ? desc_fs_configuration_telemetry_control : desc_fs_configuration_control;
+        }
+    }
+
     /* Try to guess the host OS so we can apply the quirk where needed */
     if (USB_DescUAC2Quirk()) {
-        return desc_fs_configuration_quirk;
+        return telemetry ? desc_fs_configuration_quirk_telemetry : desc_fs_configuration_quirk;
     } else {
-        return desc_fs_configuration;
+        return telemetry ? desc_fs_configuration_telemetry : desc_fs_configuration;
     }
 }
 
+//--------------------------------------------------------------------+
+// BOS Descriptor
+//--------------------------------------------------------------------+
+#define BOS_TOTAL_LEN      (TUD_BOS_DESC_LEN + TUD_BOS_MICROSOFT_OS_DESC_LEN)
+
+uint8_t const desc_bos[] = {
+    /* total length, number of device caps */
+    TUD_BOS_DESCRIPTOR(BOS_TOTAL_LEN, 1),
+    /* Microsoft OS 2.0 descriptor */
+    TUD_BOS_MS_OS_20_DESCRIPTOR(MS_OS_20_DESC_LEN, USB_VENDOR_REQ_MS_OS_20)
+};
+
+uint8_t const desc_ms_os_20[MS_OS_20_DESC_LEN] = {
+    /* Set header: length, type, windows version, total length */
+    U16_TO_U8S_LE(0x000A), U16_TO_U8S_LE(MS_OS_20_SET_HEADER_DESCRIPTOR), U32_TO_U8S_LE(0x06030000), U16_TO_U8S_LE(MS_OS_20_DESC_LEN),
+    /* Configuration subset header: length, type, configuration index, reserved, configuration total length */
+    U16_TO_U8S_LE(0x0008), U16_TO_U8S_LE(MS_OS_20_SUBSET_HEADER_CONFIGURATION), 0, 0, U16_TO_U8S_LE(MS_OS_20_DESC_LEN - 0x0A),
+    /* Function subset header: length, type, first interface, reserved, subset length */
+    U16_TO_U8S_LE(0x0008), U16_TO_U8S_LE(MS_OS_20_SUBSET_HEADER_FUNCTION), ITF_NUM_VENDOR, 0, U16_TO_U8S_LE(MS_OS_20_DESC_LEN - 0x0A - 0x08),
+    /* Compatible ID descriptor: length, type, compatible ID, sub compatible ID */
+    U16_TO_U8S_LE(0x0014), U16_TO_U8S_LE(MS_OS_20_FEATURE_COMPATBLE_ID), 'W', 'I', 'N', 'U', 'S', 'B', 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    /* Registry property descriptor: length, type, property data type, property name length */
+    U16_TO_U8S_LE(MS_OS_20_DESC_LEN - 0x0A - 0x08 - 0x08 - 0x14), U16_TO_U8S_LE(MS_OS_20_FEATURE_REG_PROPERTY),
+    U16_TO_U8S_LE(0x0007), U16_TO_U8S_LE(0x002A),
+    /* Property name "DeviceInterfaceGUIDs" in UTF-16 */
+    'D', 0x00, 'e', 0x00, 'v', 0x00, 'i', 0x00, 'c', 0x00, 'e', 0x00, 'I', 0x00, 'n', 0x00, 't', 0x00, 'e', 0x00,
+    'r', 0x00, 'f', 0x00, 'a', 0x00, 'c', 0x00, 'e', 0x00, 'G', 0x00, 'U', 0x00, 'I', 0x00, 'D', 0x00, 's', 0x00, 0x00, 0x00,
+    /* Property data length */
+    U16_TO_U8S_LE(0x0050),
+    /* Property data "{6A9D8F3E-2B71-4C5A-9E04-7F1D3C8B5A62}" in UTF-16 (multi-sz) */
+    '{', 0x00, '6', 0x00, 'A', 0x00, '9', 0x00, 'D', 0x00, '8', 0x00, 'F', 0x00, '3', 0x00, 'E', 0x00, '-', 0x00,
+    '2', 0x00, 'B', 0x00, '7', 0x00, '1', 0x00, '-', 0x00, '4', 0x00, 'C', 0x00, '5', 0x00, 'A', 0x00, '-', 0x00,
+    '9', 0x00, 'E', 0x00, '0', 0x00, '4', 0x00, '-', 0x00, '7', 0x00, 'F', 0x00, '1', 0x00, 'D', 0x00, '3', 0x00,
+    'C', 0x00, '8', 0x00, 'B', 0x00, '5', 0x00, 'A', 0x00, '6', 0x00, '2', 0x00, '}', 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+TU_VERIFY_STATIC(sizeof(desc_ms_os_20) == MS_OS_20_DESC_LEN, "Incorrect size");
+
+// Invoked when received GET BOS DESCRIPTOR request
+// Application return pointer to descriptor
+uint8_t const * tud_descriptor_bos_cb(void)
+{
+    quirk_host_os_hint_desc_cb(TUSB_DESC_BOS);
+
+    return desc_bos;
+}
+
 //--------------------------------------------------------------------+
 // String Descriptors
 //--------------------------------------------------------------------+
@@ -339,6 +475,14 @@ const uint16_t * tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
         len = ascii_to_utf16(ptr, len, USB_STRING_DFU_RT);
         break;
 
+    case STR_IDX_VENDORITF:
+        len = ascii_to_utf16(ptr, len, USB_STRING_VENDORITF);
+        break;
+
+    case STR_IDX_CTLCDCITF:
+        len = ascii_to_utf16(ptr, len, USB_STRING_CTLCDCITF);
+        break;
+
     default:
         TU_ASSERT(0, NULL);
         break;
@@ -2,6 +2,7 @@
 #define USB_DESCRIPTORS_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /* Interfaces */
 enum USB_DESCRIPTORS_ITF {
@@ -12,6 +13,9 @@ enum USB_DESCRIPTORS_ITF {
     ITF_NUM_CDC_0,
     ITF_NUM_CDC_0_DATA,
     ITF_NUM_DFU_RT,
+    ITF_NUM_VENDOR,
+    ITF_NUM_CDC_1, /* Optional control CDC, must stay last so the other interface numbers never change */
+    ITF_NUM_CDC_1_DATA,
     ITF_NUM_TOTAL
 };
 
@@ -30,12 +34,14 @@ enum USB_STRING_IDX {
     STR_IDX_AUDIOOUTCHAN,
     STR_IDX_HIDITF,
     STR_IDX_CDCITF,
-    STR_IDX_DFU_RT
+    STR_IDX_DFU_RT,
+    STR_IDX_VENDORITF,
+    STR_IDX_CTLCDCITF
 };
 
 #define USB_VID                     0x1209
 #define USB_PID                     0x7388
-#define USB_BCD                     0x0200
+#define USB_BCD                     0x0210 /* >= 2.01 required for BOS descriptor */
 
 #define USB_STRING_MANUFACTURER     "AIOC"
 #define USB_STRING_PRODUCT          "All-In-One-Cable"
@@ -49,6 +55,8 @@ enum USB_STRING_IDX {
 #define USB_STRING_CDCITF           "AIOC CDC"
 #define USB_STRING_HIDITF           "AIOC HID"
 #define USB_STRING_DFU_RT           "AIOC DFU Runtime"
+#define USB_STRING_VENDORITF        "AIOC Control"
+#define USB_STRING_CTLCDCITF        "AIOC Control CDC"
 
 /* Endpoints */
 #define EPNUM_AUDIO_IN      0x81
@@ -59,6 +67,13 @@ enum USB_STRING_IDX {
 #define EPNUM_CDC_0_OUT     0x04
 #define EPNUM_CDC_0_IN      0x84
 #define EPNUM_CDC_0_NOTIF   0x85
+#define EPNUM_CDC_1_NOTIF   0x86
+#define EPNUM_CDC_1_OUT     0x07
+#define EPNUM_CDC_1_IN      0x87
+
+/* The control CDC gets small endpoints, since packet memory is mostly taken by the audio endpoints */
+#define EPSIZE_CDC_1_NOTIF  8
+#define EPSIZE_CDC_1        16
 
 /* Custom Audio Descriptor.
  * Courtesy of https://github.com/hathach/tinyusb/issues/1249#issuecomment-1148727765 */
@@ -176,6 +191,18 @@ enum USB_STRING_IDX {
 
 #define AIOC_DFU_RT_DESCRIPTOR TUD_DFU_RT_DESCRIPTOR
 
+#define AIOC_VENDOR_DESC_LEN   9
+
+#define AIOC_VENDOR_DESCRIPTOR(_itfnum, _stridx) \
+  /* Interface without endpoints. Only used for binding WinUSB to issue vendor control requests */\
+  9, TUSB_DESC_INTERFACE, _itfnum, 0, 0, TUSB_CLASS_VENDOR_SPECIFIC, 0x00, 0x00, _stridx
+
+/* Microsoft OS 2.0 descriptor set, binds WinUSB to the vendor interface */
+#define MS_OS_20_DESC_LEN      0xB2
+#define MS_OS_20_DESC_INDEX    7
+
+extern uint8_t const desc_ms_os_20[MS_OS_20_DESC_LEN];
+
 bool USB_DescUAC2Quirk(void);
 
 #endif /* USB_DESCRIPTORS_H_ */
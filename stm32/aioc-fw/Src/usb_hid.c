@@ -3,29 +3,168 @@
 #include "tusb.h"
 #include "settings.h"
 #include "usb_descriptors.h"
+#include "dtmf.h"
 
-#define USB_HID_INOUT_REPORT_LEN  4
 #define USB_HID_FEATURE_REPORT_LEN 6
 
+/* Telemetry input report signal state bits */
+#define USB_HID_TELEMETRY_PTT1      0x01
+#define USB_HID_TELEMETRY_PTT2      0x02
+#define USB_HID_TELEMETRY_VPTT      0x04
+#define USB_HID_TELEMETRY_VCOS      0x08
+#define USB_HID_TELEMETRY_RECMUTE   0x10
+#define USB_HID_TELEMETRY_PLAYMUTE  0x20
+
+/* Number of button state changes that can be queued while the interrupt endpoint is busy. Power of 2 */
+#define USB_HID_EVENT_QUEUE_LEN     16
+
+/* Button states of all sources, USB_HID_SOURCE_BITS bits per source.
+ * Modified atomically from ISRs, the reported button state is the OR of all sources. */
+static volatile uint32_t buttonSources = 0;
+
+/* Event queue. Producers are ISRs, which reserve a slot and then fill it with the current button state.
+ * Since the consumer only ever runs in thread mode, it can never observe a reserved but unfilled slot. */
+static uint8_t eventQueue[USB_HID_EVENT_QUEUE_LEN];
+static volatile uint32_t eventHead = 0;
+static volatile uint32_t eventTail = 0;
+static volatile uint32_t eventOverflows = 0;
+
 static uint8_t buttonState = 0x00;
+static volatile bool reportPending = false;
 static uint8_t gpioState = 0x00;
 static uint8_t currentAddress = 0x0000;
+static bool telemetryEnabled = false;
+static uint16_t telemetrySequence = 0;
+static uint8_t dtmfReported = 0;
 
-static void MakeReport(uint8_t * buffer)
+static void PutLE16(uint8_t * buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t) (value >> 0);
+    buffer[1] = (uint8_t) (value >> 8);
+}
+
+static void PutLE32(uint8_t * buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t) (value >> 0);
+    buffer[1] = (uint8_t) (value >> 8);
+    buffer[2] = (uint8_t) (value >> 16);
+    buffer[3] = (uint8_t) (value >> 24);
+}
+
+static void MakeTelemetry(uint8_t * buffer)
+{
+    /* Telemetry is appended to the CM108 compatible part of the input report:
+     *  0..1  Sequence counter
+     *  2     Signal states (PTT1, PTT2, VPTT, VCOS, record mute, playback mute)
+     *  3     Record state (bits 0..3) and playback state (bits 4..7)
+     *  4..5  Record volume
+     *  6..7  Playback volume
+     *  8..9  Playback buffer level average
+     * 10..11 Playback buffer level minimum
+     * 12..13 Playback buffer level maximum
+     * 14..15 Button events coalesced due to a full event queue
+     * 16..19 Playback feedback average
+     * 20..23 Uptime in milliseconds
+     * 24     Last DTMF digit as ASCII character (0 if none)
+     * 25     DTMF digit counter
+     * 26..27 Millisecond tick of the last DTMF digit (lower 16 bits) */
+    uint32_t audio0 = settingsRegMap[SETTINGS_REG_INFO_AUDIO0];
+    dtmf_event_t dtmf;
+    uint8_t signals = (audio0 & SETTINGS_REG_INFO_AIOC0_PTT1STATE_MASK ? USB_HID_TELEMETRY_PTT1 : 0) |
+                      (audio0 & SETTINGS_REG_INFO_AIOC0_PTT2STATE_MASK ? USB_HID_TELEMETRY_PTT2 : 0) |
+                      (audio0 & SETTINGS_REG_INFO_AIOC0_VPTTSTATE_MASK ? USB_HID_TELEMETRY_VPTT : 0) |
+                      (audio0 & SETTINGS_REG_INFO_AIOC0_VCOSSTATE_MASK ? USB_HID_TELEMETRY_VCOS : 0) |
+                      (audio0 & SETTINGS_REG_INFO_AUDIO0_RECMUTE0_MASK ? USB_HID_TELEMETRY_RECMUTE : 0) |
+                      (audio0 & SETTINGS_REG_INFO_AUDIO0_PLAYMUTE0_MASK ? USB_HID_TELEMETRY_PLAYMUTE : 0);
+
+    PutLE16(&buffer[0], telemetrySequence);
+    buffer[2] = signals;
+    buffer[3] = (uint8_t) ( (SETTINGS_GET(SETTINGS_REG_INFO_AUDIO0, RECSTATE) << 0) |
+                            (SETTINGS_GET(SETTINGS_REG_INFO_AUDIO0, PLAYSTATE) << 4) );
+    PutLE16(&buffer[4], SETTINGS_GET(SETTINGS_REG_INFO_AUDIO3, RECVOL0));
+    PutLE16(&buffer[6], SETTINGS_GET(SETTINGS_REG_INFO_AUDIO9, PLAYVOL0));
+    PutLE16(&buffer[8], SETTINGS_GET(SETTINGS_REG_INFO_AUDIO10, PLAYBUFAVG));
+    PutLE16(&buffer[10], SETTINGS_GET(SETTINGS_REG_INFO_AUDIO11, PLAYBUFMIN));
+    PutLE16(&buffer[12], SETTINGS_GET(SETTINGS_REG_INFO_AUDIO12, PLAYBUFMAX));
+    PutLE16(&buffer[14], (uint16_t) eventOverflows);
+    PutLE32(&buffer[16], SETTINGS_GET(SETTINGS_REG_INFO_AUDIO13, PLAYFBAVG));
+    PutLE32(&buffer[20], HAL_GetTick());
+
+    Dtmf_LastEvent(&dtmf);
+    buffer[24] = (uint8_t) dtmf.digit;
+    buffer[25] = dtmf.count;
+    PutLE16(&buffer[26], (uint16_t) dtmf.tick);
+}
+
+static uint8_t ButtonState(void)
+{
+    uint32_t sources = buttonSources;
+    uint8_t buttons = 0x00;
+
+    for (uint8_t i=0; i<USB_HID_SOURCE_COUNT; i++) {
+        buttons |= (sources >> (i * USB_HID_SOURCE_BITS)) & USB_HID_BUTTON_MASK;
+    }
+
+    return buttons;
+}
+
+static uint16_t MakeReport(uint8_t * buffer)
 {
     /* TODO: Read the actual states of the GPIO input hardware pins. */
     buffer[0] = buttonState & 0x0F;
     buffer[1] = gpioState;
     buffer[2] = 0x00;
     buffer[3] = 0x00;
+
+    if (!telemetryEnabled) {
+        return USB_HID_INOUT_REPORT_LEN;
+    }
+
+    /* When telemetry is enabled, the input report is extended beyond the CM108 part */
+    MakeTelemetry(&buffer[USB_HID_INOUT_REPORT_LEN]);
+
+    return USB_HID_TELEMETRY_REPORT_LEN;
 }
 
 static bool SendReport(void)
 {
-    uint8_t reportBuffer[USB_HID_INOUT_REPORT_LEN];
-    MakeReport(reportBuffer);
+    uint8_t reportBuffer[USB_HID_TELEMETRY_REPORT_LEN];
+    uint16_t reportLen = MakeReport(reportBuffer);
+
+    if (!tud_hid_report(0, reportBuffer, reportLen)) {
+        return false;
+    }
 
-    return tud_hid_report(0, reportBuffer, sizeof(reportBuffer));
+    telemetrySequence++;
+
+    return true;
+}
+
+static void DrainEvents(void)
+{
+    /* Only called from thread mode (main loop and endpoint completion) */
+    if (!tud_hid_ready()) {
+        return;
+    }
+
+    uint32_t tail = eventTail;
+
+    if (tail != eventHead) {
+        /* Report queued button states in order, so that no edge gets lost */
+        buttonState = eventQueue[tail % USB_HID_EVENT_QUEUE_LEN];
+
+        if (SendReport()) {
+            eventTail = tail + 1;
+        }
+    } else if (reportPending || (buttonState != ButtonState())) {
+        /* Catches up on changes that did not fit into the queue, and on GPIO changes */
+        reportPending = false;
+        buttonState = ButtonState();
+
+        if (!SendReport()) {
+            reportPending = true;
+        }
+    }
 }
 
 static void ControlPTT(uint8_t gpio)
@@ -64,7 +203,7 @@ static void ControlPTT(uint8_t gpio)
         pttMask |= gpio & 0x08 ? IO_PTT_MASK_PTT2 : 0;
     }
 
-    IO_PTTControl(pttMask);
+    IO_PTTControl(IO_PTT_SOURCE_CM108, pttMask);
 }
 
 // Invoked when received GET_REPORT control request
@@ -79,10 +218,9 @@ uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t
 
     switch (report_type) {
         case HID_REPORT_TYPE_INPUT:
-            TU_ASSERT(reqlen >= USB_HID_INOUT_REPORT_LEN, 0);
+            TU_ASSERT(reqlen >= (telemetryEnabled ? USB_HID_TELEMETRY_REPORT_LEN : USB_HID_INOUT_REPORT_LEN), 0);
 
-            MakeReport(buffer);
-            return USB_HID_INOUT_REPORT_LEN;
+            return MakeReport(buffer);
 
         case HID_REPORT_TYPE_FEATURE:
             TU_ASSERT(reqlen >= USB_HID_FEATURE_REPORT_LEN, 0);
@@ -132,7 +270,8 @@ void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t rep
                  * interrupt pipe.
                  */
                 if (gpioChange) {
-                    SendReport();
+                    reportPending = true;
+                    DrainEvents();
                 }
             }
             break;
@@ -156,15 +295,35 @@ void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t rep
                 Settings_Recall();
             }
 
-            if (ctrlWord & 0x01UL) {
-                /* Write strobe */
-                Settings_RegWrite(address, data);
+            if ((ctrlWord & 0x07UL) == 0x06UL) {
+                /* Begin and commit without a write strobe: Abort transaction, discarding the staged writes */
+                Settings_Abort();
+            } else {
+                if (ctrlWord & 0x02UL) {
+                    /* Begin transaction. Following writes are staged until commit */
+                    Settings_Begin();
+                }
+
+                if (ctrlWord & 0x01UL) {
+                    /* Write strobe */
+                    Settings_RegWrite(address, data);
+                }
+
+                if (ctrlWord & 0x04UL) {
+                    /* Commit transaction */
+                    Settings_Commit();
+                }
             }
 
             if (ctrlWord & 0x80UL) {
                 Settings_Store();
             }
 
+            if (ctrlWord & 0x08UL) {
+                /* Store into the active profile slot */
+                Settings_ProfileStore();
+            }
+
             if (ctrlWord & 0x20UL) {
                 /* Reboot */
                 while(1) {
@@ -181,15 +340,84 @@ void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t rep
 }
 
 
+// Invoked when sent REPORT successfully to host
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len)
+{
+    (void) instance;
+    (void) report;
+    (void) len;
+
+    /* Endpoint is free again, send the next event right away */
+    DrainEvents();
+}
+
 void USB_HIDInit(void)
 {
+    /* The telemetry mode changes the report descriptor, so it is latched until next reboot */
+    telemetryEnabled = SETTINGS_GET(SETTINGS_REG_HID_TELEMETRY, INTERVAL) != 0;
+}
+
+void USB_HIDTask(void)
+{
+    static uint32_t lastTick = 0;
 
+    /* Button events take precedence over telemetry */
+    DrainEvents();
 
+    uint32_t interval = SETTINGS_GET(SETTINGS_REG_HID_TELEMETRY, INTERVAL);
+
+    if (!telemetryEnabled || (interval == 0)) {
+        return;
+    }
+
+    uint32_t nowTick = HAL_GetTick();
+    dtmf_event_t dtmf;
+
+    /* A new DTMF digit is reported right away */
+    Dtmf_LastEvent(&dtmf);
+    bool dtmfPending = (dtmf.count != dtmfReported) && SETTINGS_GET(SETTINGS_REG_DTMF_CTRL, HIDEVENT);
+
+    if (((nowTick - lastTick) >= interval) || dtmfPending) {
+        /* Only send, when no other report is pending on the interrupt endpoint */
+        if (tud_hid_ready() && SendReport()) {
+            lastTick = nowTick;
+            dtmfReported = dtmf.count;
+        }
+    }
+}
+
+bool USB_HIDTelemetryEnabled(void)
+{
+    return telemetryEnabled;
 }
 
-bool USB_HIDSendButtonState(uint8_t buttonMask)
+bool USB_HIDSendButtonState(uint8_t source, uint8_t buttonMask, bool state)
 {
-    buttonState = buttonMask;
+    /* May be called from any ISR. Only records the new state, the report is sent from the main loop */
+    if (source >= USB_HID_SOURCE_COUNT) {
+        return false;
+    }
+
+    uint32_t mask = (uint32_t) (buttonMask & USB_HID_BUTTON_MASK) << (source * USB_HID_SOURCE_BITS);
+
+    if (state) {
+        __atomic_fetch_or(&buttonSources, mask, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_and(&buttonSources, ~mask, __ATOMIC_RELAXED);
+    }
+
+    uint32_t head = eventHead;
+
+    do {
+        if ((head - eventTail) >= USB_HID_EVENT_QUEUE_LEN) {
+            /* Queue full. The final state is still reported once the queue has drained */
+            eventOverflows++;
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&eventHead, &head, head + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    /* Snapshot after reserving, so that a preempting producer can never leave an older state as the last entry */
+    eventQueue[head % USB_HID_EVENT_QUEUE_LEN] = ButtonState();
 
-    return SendReport();
+    return true;
 }
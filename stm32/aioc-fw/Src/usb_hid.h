@@ -8,8 +8,21 @@
 #define USB_HID_BUTTON_VOLDN    0x02
 #define USB_HID_BUTTON_PLAYMUTE 0x04
 #define USB_HID_BUTTON_RECMUTE  0x08
+#define USB_HID_BUTTON_MASK     0x0F
+
+/* Sources of button events. Each source holds its own button states, which are combined for the report */
+#define USB_HID_SOURCE_IN1      0
+#define USB_HID_SOURCE_IN2      1
+#define USB_HID_SOURCE_VCOS     2
+#define USB_HID_SOURCE_COUNT    3
+#define USB_HID_SOURCE_BITS     4
+
+#define USB_HID_INOUT_REPORT_LEN        4
+#define USB_HID_TELEMETRY_REPORT_LEN    32
 
 void USB_HIDInit(void);
-bool USB_HIDSendButtonState(uint8_t inputsMask);
+void USB_HIDTask(void);
+bool USB_HIDTelemetryEnabled(void);
+bool USB_HIDSendButtonState(uint8_t source, uint8_t buttonMask, bool state);
 
 #endif /* USB_HID_H_ */
@@ -6,126 +6,657 @@
 #include "led.h"
 #include "settings.h"
 #include "usb_descriptors.h"
+#include "device/usbd_pvt.h"
+#include "pool.h"
+
+/* Line states (DCD, DSR, ...) of all sources, USB_SERIAL_SOURCE_BITS bits per source.
+ * Modified atomically from ISRs, the notified state is the OR of all sources. */
+static volatile uint32_t lineStateSources = 0;
+static uint8_t lineStateSent = 0x00;
+static bool lineStateResend = true;
+
+/* SERIAL_STATE notification. Must stay valid until the transfer has completed */
+static uint8_t lineStateNotification[10] = {
+    /* bmRequestType */ 0xA1,
+    /* bNotification */ 0x20,
+    /* wValue */ 0x00, 0x00,
+    /* wIndex */ ITF_NUM_CDC_0, 0x00,
+    /* wLength */ 0x02, 0x00,
+    /* Data */ 0x00, 0x00
+};
+
+/* UART receive ring, continuously filled by DMA. The read position is only advanced by RxHandoff(),
+ * which is only ever executed at the serial interrupt priority. Besides the ring positions, the absolute
+ * number of bytes written and read are tracked, so that the DMA lapping the reader can be detected. */
+static uint8_t * rxBuffer; /* Circular DMA receive buffer from the buffer pool */
+static uint16_t rxBufferSize;
+static uint32_t rxReadPos = 0;
+static uint32_t rxReadTotal = 0;
+static uint32_t rxWritePos = 0;
+static uint32_t rxWriteTotal = 0;
+static uint8_t rxOverruns = 0;
+
+/* PTT output changes together with the receive byte count at which they happened. RXIGNPTT is applied
+ * to the bytes received while the PTT was asserted, no matter when they are handed off. */
+#define RX_PTTEDGE_COUNT 8
+static struct {
+    uint32_t total;
+    uint8_t status;
+} rxPttEdge[RX_PTTEDGE_COUNT];
+static volatile uint8_t rxPttEdgeHead = 0;
+static volatile uint8_t rxPttEdgeTail = 0;
+static uint8_t rxPttStatus = 0; /* PTT outputs in effect at the read position */
+
+static uint32_t RxWriteTotal(void)
+{
+    /* Advance the absolute write count by the distance the DMA moved since the last call. This is unambiguous,
+     * because the DMA half and full transfer interrupts call this at least once per half ring.
+     * May be called from any priority, also with interrupts already disabled. */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
 
-void USB_SERIAL_UART_IRQ(void)
+    uint32_t writePos = rxBufferSize - USB_SERIAL_UART_RXDMA->CNDTR;
+
+    if (writePos >= rxBufferSize) {
+        /* CNDTR reads 0 for a moment when wrapping around */
+        writePos = 0;
+    }
+
+    rxWriteTotal += (writePos - rxWritePos + rxBufferSize) % rxBufferSize;
+    rxWritePos = writePos;
+
+    uint32_t total = rxWriteTotal;
+    __set_PRIMASK(primask);
+
+    return total;
+}
+
+static void RxDiscard(void)
 {
-    uint32_t ISR = USB_SERIAL_UART->ISR;
+    /* Skip everything received so far */
+    rxReadTotal = RxWriteTotal();
+    rxReadPos = rxWritePos;
+}
 
-    if (ISR & USART_ISR_TC) {
-        /* Transmission complete and no new data queued to send.
-         * Clear interrupt flag and further processing inside TXE Bit Handler.
-         * This is safe, because TXE bit will always be set, when TC bit is also set. */
-        USB_SERIAL_UART->ICR = USART_ICR_TCCF;
+/* Flush policy state. Bytes handed to the CDC since the last flush and the time the first of them arrived */
+static uint32_t rxPending = 0;
+static uint32_t rxPendingTick = 0;
+static uint32_t rxFillAvg = 0; /* 12.4 fixed point */
+static uint16_t flushCount[3] = {0, 0, 0};
+
+typedef enum {
+    FLUSH_RTO = 0,
+    FLUSH_FILL,
+    FLUSH_LATENCY
+} flush_reason_t;
+
+static void RxFlush(flush_reason_t reason)
+{
+    tud_cdc_n_write_flush(0);
+
+    if (rxPending > 0) {
+        /* Statistics for tuning the policy */
+        rxFillAvg = rxFillAvg - (rxFillAvg >> 3) + ((rxPending << 4) >> 3);
+        flushCount[reason]++;
+        rxPending = 0;
+
+        settingsRegMap[SETTINGS_REG_INFO_SERIAL0] =
+                (((uint32_t) flushCount[FLUSH_RTO] << SETTINGS_REG_INFO_SERIAL0_RTOFLUSH_OFFS) & SETTINGS_REG_INFO_SERIAL0_RTOFLUSH_MASK) |
+                (((uint32_t) flushCount[FLUSH_FILL] << SETTINGS_REG_INFO_SERIAL0_FILLFLUSH_OFFS) & SETTINGS_REG_INFO_SERIAL0_FILLFLUSH_MASK);
+        settingsRegMap[SETTINGS_REG_INFO_SERIAL1] =
+                (((uint32_t) flushCount[FLUSH_LATENCY] << SETTINGS_REG_INFO_SERIAL1_LATFLUSH_OFFS) & SETTINGS_REG_INFO_SERIAL1_LATFLUSH_MASK) |
+                (((rxFillAvg + 8) >> 4 << SETTINGS_REG_INFO_SERIAL1_FILLAVG_OFFS) & SETTINGS_REG_INFO_SERIAL1_FILLAVG_MASK);
     }
+}
 
-    if (ISR & USART_ISR_TXE) {
-        /* TX register is empty, load up another character if there is one left in the buffer.
-         * Otherwise atomically shutdown the transmission. */
-        __disable_irq();
-        uint32_t available = tud_cdc_n_available(0);
-        if (available == 0) {
-            /* No char left in fifo. Disable the TX-empty interrupt and wait for transmission to complete */
-            USB_SERIAL_UART->CR1 &= (uint32_t) ~USART_CR1_TXEIE;
-
-            if (ISR & USART_ISR_TC) {
-                /* If TC is also set, all transmissions have completed, thus disable the transmitter. */
-                USB_SERIAL_UART->CR1 &= (uint32_t) ~(USART_CR1_TE | USART_CR1_TCIE);
-            }
+static void RxFlushPolicy(void)
+{
+    uint32_t fill = SETTINGS_GET(SETTINGS_REG_SERIAL_FLUSH, FILL);
+    uint32_t maxLatency = SETTINGS_GET(SETTINGS_REG_SERIAL_FLUSH, MAXLAT);
+
+    if (rxPending == 0) {
+        return;
+    }
+
+    if ((fill > 0) && (rxPending >= fill)) {
+        RxFlush(FLUSH_FILL);
+    } else if ((maxLatency > 0) && ((HAL_GetTick() - rxPendingTick) >= maxLatency)) {
+        RxFlush(FLUSH_LATENCY);
+    }
+}
+
+/* Benchmark state. Started from the main loop, run entirely at the serial interrupt priority */
+static volatile bool benchActive = false;
+static volatile bool benchAbort = false;
+static uint8_t benchPattern;
+static uint16_t benchTxLfsr;
+static uint16_t benchRxLfsr;
+static uint32_t benchLength;
+static uint32_t benchTxCount;
+static uint32_t benchRxCount;
+static uint32_t benchErrors;
+static uint32_t benchStartTick;
+static uint32_t benchTimeout;
+static uint32_t benchSavedRegs[6];
+
+/* Receive error counters and USB to UART latency measurement */
+static uint8_t uartErrors[3] = {0, 0, 0};
+static bool txLatencyPending = false;
+static uint32_t txLatencyStart = 0;
+static uint32_t txLatencyMax = 0;
+
+/* Capture ring of variable length records. Written only at serial interrupt priority,
+ * read only from the main loop, thus head and tail each have a single writer */
+static uint8_t * captureBuffer; /* From the buffer pool, power of 2 in size. Capture is unavailable without one */
+static uint16_t captureBufferSize;
+static volatile uint32_t captureHead = 0;
+static volatile uint32_t captureTail = 0;
+static bool captureLost = false;
+static uint32_t captureLastCycles = 0;
+static uint32_t captureCycles = 0;
+static uint32_t captureTime = 0;
+
+static uint32_t CaptureTime(void)
+{
+    /* Microsecond time derived from the cycle counter. Must be called at least once per cycle counter wrap-around */
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+    uint32_t cycles = DWT->CYCCNT;
+
+    captureCycles += cycles - captureLastCycles;
+    captureLastCycles = cycles;
+    captureTime += captureCycles / cyclesPerUs;
+    captureCycles %= cyclesPerUs;
+
+    return captureTime;
+}
+
+static void CapturePut(uint32_t pos, uint8_t data)
+{
+    captureBuffer[pos % captureBufferSize] = data;
+}
+
+static void CaptureWrite(uint8_t flags, const uint8_t * data, uint32_t length)
+{
+    if (!(settingsRegMap[SETTINGS_REG_SERIAL_CTRL] & SETTINGS_REG_SERIAL_CTRL_CAPTURE_MASK) || (captureBufferSize == 0)) {
+        return;
+    }
+
+    uint32_t head = captureHead;
+    uint32_t timestamp = CaptureTime();
+
+    length = TU_MIN(length, UINT8_MAX);
+
+    if ((USB_SERIAL_CAPTURE_HDRLEN + length) > (captureBufferSize - (head - captureTail))) {
+        /* Host does not read fast enough */
+        captureLost = true;
+        return;
+    }
+
+    CapturePut(head++, (uint8_t) (timestamp >> 0));
+    CapturePut(head++, (uint8_t) (timestamp >> 8));
+    CapturePut(head++, (uint8_t) (timestamp >> 16));
+    CapturePut(head++, (uint8_t) (timestamp >> 24));
+    CapturePut(head++, flags | (captureLost ? USB_SERIAL_CAPTURE_FLAG_LOST : 0));
+    CapturePut(head++, (uint8_t) length);
+
+    while (length--) {
+        CapturePut(head++, *data++);
+    }
+
+    /* Publish the record only once complete */
+    captureLost = false;
+    captureHead = head;
+}
+
+static uint8_t BenchNext(uint16_t * lfsr, uint32_t index)
+{
+    switch (benchPattern) {
+    case SETTINGS_REG_SERIAL_BENCH_PATTERN_COUNT_ENUM:
+        return (uint8_t) index;
+    case SETTINGS_REG_SERIAL_BENCH_PATTERN_ALT_ENUM:
+        return 0x55;
+    default:
+        /* PRBS9 (x^9 + x^5 + 1), advanced by one byte */
+        for (uint8_t i=0; i<8; i++) {
+            uint16_t bit = ((*lfsr >> 8) ^ (*lfsr >> 4)) & 0x01;
+            *lfsr = ((*lfsr << 1) | bit) & 0x1FF;
         }
+        return (uint8_t) *lfsr;
+    }
+}
+
+static void BenchStatus(uint32_t status)
+{
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL3] =
+            ((benchErrors << SETTINGS_REG_INFO_SERIAL3_BENCHERR_OFFS) & SETTINGS_REG_INFO_SERIAL3_BENCHERR_MASK) |
+            ((status << SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_OFFS) & SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_MASK);
+}
+
+static void BenchFinish(uint32_t status)
+{
+    /* Called at serial interrupt priority */
+    uint32_t duration = HAL_GetTick() - benchStartTick;
+
+    benchActive = false;
+    benchAbort = false;
+
+    /* Stop any transfer still in progress and restore the host's UART configuration */
+    USB_SERIAL_UART_TXDMA->CCR &= (uint32_t) ~DMA_CCR_EN;
+    USB_SERIAL_UART->CR1 &= (uint32_t) ~USART_CR1_UE;
+    USB_SERIAL_UART->BRR = benchSavedRegs[3];
+    USB_SERIAL_UART->CR3 = benchSavedRegs[2];
+    USB_SERIAL_UART->CR2 = benchSavedRegs[1];
+    USB_SERIAL_UART->CR1 = benchSavedRegs[0];
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL6] = benchSavedRegs[4];
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL7] = benchSavedRegs[5];
+
+    /* Discard whatever is left in the receive ring */
+    RxDiscard();
+
+    /* Bytes that never arrived count as errors */
+    benchErrors += benchLength - benchRxCount;
+
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL2] = (uint32_t) ((uint64_t) benchRxCount * 1000 / (duration > 0 ? duration : 1));
+    BenchStatus(status);
+    settingsRegMap[SETTINGS_REG_SERIAL_BENCH] &= ~SETTINGS_REG_SERIAL_BENCH_RUN_MASK;
+}
+
+static uint32_t SetBaudrate(uint32_t baud)
+{
+    /* Must be called while the UART is disabled. Selects the oversampling mode giving the
+     * smaller baudrate error (16x preferred on a tie for its better noise immunity).
+     * Returns the baudrate actually generated. */
+    uint32_t clock = HAL_RCCEx_GetPeriphCLKFreq(USB_SERIAL_UART_PERIPHCLK);
+    uint32_t div16 = (clock + baud/2) / baud;
+    uint32_t div8 = (2 * clock + baud/2) / baud;
+    uint32_t actual16 = 0;
+    uint32_t actual8;
+    uint32_t actual;
+
+    /* USARTDIV must be at least 16 in both modes */
+    div8 = TU_MAX(TU_MIN(div8, 0xFFFF), 16);
+    actual8 = 2 * clock / div8;
+
+    if ((div16 >= 16) && (div16 <= 0xFFFF)) {
+        actual16 = clock / div16;
+    }
+
+    if ( (actual16 != 0) && ((actual16 > baud ? actual16 - baud : baud - actual16) <= (actual8 > baud ? actual8 - baud : baud - actual8)) ) {
+        USB_SERIAL_UART->CR1 &= (uint32_t) ~USART_CR1_OVER8;
+        USB_SERIAL_UART->BRR = div16;
+        actual = actual16;
+    } else {
+        /* In 8x oversampling, BRR[2:0] holds USARTDIV[3:1] and BRR[3] must be kept cleared */
+        USB_SERIAL_UART->CR1 |= USART_CR1_OVER8;
+        USB_SERIAL_UART->BRR = (div8 & 0xFFF0) | ((div8 & 0x000F) >> 1);
+        actual = actual8;
+    }
+
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL6] = baud;
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL7] = (actual & SETTINGS_REG_INFO_SERIAL7_BAUDACT_MASK) |
+            (USB_SERIAL_UART->CR1 & USART_CR1_OVER8 ? SETTINGS_REG_INFO_SERIAL7_OVER8_MASK : 0);
+
+    return actual;
+}
+
+static void BenchStart(void)
+{
+    /* Called from main loop */
+    uint32_t baud = SETTINGS_GET(SETTINGS_REG_SERIAL_BENCH, BAUD);
+    uint32_t clock = HAL_RCCEx_GetPeriphCLKFreq(USB_SERIAL_UART_PERIPHCLK);
+
+    if ((baud == 0) || (baud > clock / 8)) {
+        benchErrors = 0;
+        BenchStatus(SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_INVALID_ENUM);
+        settingsRegMap[SETTINGS_REG_SERIAL_BENCH] &= ~SETTINGS_REG_SERIAL_BENCH_RUN_MASK;
+        return;
+    }
+
+    __disable_irq();
+    if ((USB_SERIAL_UART_TXDMA->CCR & DMA_CCR_EN) || (USB_SERIAL_UART->CR1 & USART_CR1_TE)) {
+        /* Host data still being transmitted, try again later */
         __enable_irq();
+        return;
+    }
+
+    benchSavedRegs[0] = USB_SERIAL_UART->CR1;
+    benchSavedRegs[1] = USB_SERIAL_UART->CR2;
+    benchSavedRegs[2] = USB_SERIAL_UART->CR3;
+    benchSavedRegs[3] = USB_SERIAL_UART->BRR;
+    benchSavedRegs[4] = settingsRegMap[SETTINGS_REG_INFO_SERIAL6];
+    benchSavedRegs[5] = settingsRegMap[SETTINGS_REG_INFO_SERIAL7];
+
+    /* 8N1 at the requested baudrate. In half duplex mode, the receiver sees the transmitter on the TX pin */
+    USB_SERIAL_UART->CR1 &= (uint32_t) ~USART_CR1_UE;
+    SetBaudrate(baud);
+    USB_SERIAL_UART->CR1 &= (uint32_t) ~(USART_CR1_PCE | USART_CR1_PS | USART_CR1_M | USART_CR1_M0);
+    USB_SERIAL_UART->CR2 &= (uint32_t) ~USART_CR2_STOP;
+
+    if (SETTINGS_GET(SETTINGS_REG_SERIAL_BENCH, LOOP) == SETTINGS_REG_SERIAL_BENCH_LOOP_NORADIO_ENUM) {
+        /* The receiver samples the TX pin, so the pattern also goes out to whatever is connected there */
+        USB_SERIAL_UART->CR3 |= USART_CR3_HDSEL;
+    } else {
+        USB_SERIAL_UART->CR3 &= (uint32_t) ~USART_CR3_HDSEL;
+    }
+
+    USB_SERIAL_UART->CR1 |= USART_CR1_RE | USART_CR1_UE;
+
+    /* About one second worth of data, but at least some hundred bytes */
+    benchLength = TU_MIN(TU_MAX(baud / 10, 256), 65536);
+    benchTimeout = 2 * (benchLength * 10 * 1000 / baud) + 100;
+    benchPattern = SETTINGS_GET(SETTINGS_REG_SERIAL_BENCH, PATTERN);
+    benchTxLfsr = 0x1FF;
+    benchRxLfsr = 0x1FF;
+    benchTxCount = 0;
+    benchRxCount = 0;
+    benchErrors = 0;
+    uartErrors[0] = uartErrors[1] = uartErrors[2] = 0;
+    rxOverruns = 0;
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL4] = 0;
+    RxDiscard();
+    benchStartTick = HAL_GetTick();
+    benchAbort = false;
+    benchActive = true;
+    BenchStatus(SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_RUN_ENUM);
+    __enable_irq();
+
+    /* UART interrupt starts the transmission */
+    NVIC_SetPendingIRQ(USART1_IRQn);
+}
+
+static void BenchCheck(uint32_t count)
+{
+    /* Compare received data against the expected pattern */
+    while (count--) {
+        if (rxBuffer[rxReadPos] != BenchNext(&benchRxLfsr, benchRxCount)) {
+            benchErrors++;
+        }
 
-        if (available > 0) {
-             /* Write char from fifo */
-            int32_t c = tud_cdc_n_read_char(0);
-            TU_ASSERT(c != -1, /**/);
-            USB_SERIAL_UART->TDR = (uint8_t) c;
-            LED_MODE(1, LED_MODE_FASTPULSE);
+        rxReadPos = (rxReadPos + 1) % rxBufferSize;
+        rxReadTotal++;
+
+        if (++benchRxCount >= benchLength) {
+            BenchFinish(SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_DONE_ENUM);
+            break;
         }
     }
+}
+
+static void ErrorUpdate(void)
+{
+    settingsRegMap[SETTINGS_REG_INFO_SERIAL4] =
+            (((uint32_t) uartErrors[0] << SETTINGS_REG_INFO_SERIAL4_FRAMEERR_OFFS) & SETTINGS_REG_INFO_SERIAL4_FRAMEERR_MASK) |
+            (((uint32_t) uartErrors[1] << SETTINGS_REG_INFO_SERIAL4_NOISEERR_OFFS) & SETTINGS_REG_INFO_SERIAL4_NOISEERR_MASK) |
+            (((uint32_t) uartErrors[2] << SETTINGS_REG_INFO_SERIAL4_OVERRUN_OFFS) & SETTINGS_REG_INFO_SERIAL4_OVERRUN_MASK) |
+            (((uint32_t) rxOverruns << SETTINGS_REG_INFO_SERIAL4_RINGOVR_OFFS) & SETTINGS_REG_INFO_SERIAL4_RINGOVR_MASK);
+}
 
-    if (ISR & USART_ISR_RXNE) {
-        /* RX register is not empty, get character and put into USB send buffer */
-        if (tud_cdc_n_write_available(0) > 0) {
-            uint8_t c = USB_SERIAL_UART->RDR;
-            uint8_t pttStatus = IO_PTTStatus();
-            uint8_t pttRxIgnoreMask = (settingsRegMap[SETTINGS_REG_SERIAL_CTRL] & SETTINGS_REG_SERIAL_CTRL_RXIGNPTT_MASK) >> SETTINGS_REG_SERIAL_CTRL_RXIGNPTT_OFFS;
+static void RxHandoff(void)
+{
+    /* Hand the data received since the last call over to the CDC FIFO, as large spans as possible */
+    uint32_t writeTotal = RxWriteTotal();
+    uint8_t pttRxIgnoreMask = (settingsRegMap[SETTINGS_REG_SERIAL_CTRL] & SETTINGS_REG_SERIAL_CTRL_RXIGNPTT_MASK) >> SETTINGS_REG_SERIAL_CTRL_RXIGNPTT_OFFS;
+
+    if ((writeTotal - rxReadTotal) > rxBufferSize) {
+        /* The CDC FIFO backed up for so long, that the DMA overwrote data not handed off yet.
+         * The ring now holds a mix of old and new data, so drop all of it (saturating count) */
+        if (rxOverruns < UINT8_MAX) {
+            rxOverruns++;
+        }
 
-            if (!(pttStatus & pttRxIgnoreMask) ) {
-                /* Only store character when none of the enabled PTTs are asserted (shares the same pin) */
-                tud_cdc_n_write(0, &c, 1);
-                LED_MODE(0, LED_MODE_FASTPULSE);
+        ErrorUpdate();
+        rxReadTotal = writeTotal;
+        rxReadPos = rxWritePos;
+    }
+
+    if (benchActive) {
+        /* Benchmark data is checked, not forwarded */
+        BenchCheck(writeTotal - rxReadTotal);
+        return;
+    }
+
+    while (rxReadTotal != writeTotal) {
+        /* Contiguous span up to the write position, the end of the buffer or the next PTT change */
+        uint32_t count = TU_MIN(writeTotal - rxReadTotal, rxBufferSize - rxReadPos);
+        uint8_t captureFlags = USB_SERIAL_CAPTURE_FLAG_IGNORED;
+
+        /* Apply PTT changes up to the read position. The IO layer may add or update entries at any time */
+        __disable_irq();
+        uint8_t tail = rxPttEdgeTail;
+
+        while ((tail != rxPttEdgeHead) && ((int32_t) (rxPttEdge[tail].total - rxReadTotal) <= 0)) {
+            rxPttStatus = rxPttEdge[tail].status;
+            tail = (tail + 1) % RX_PTTEDGE_COUNT;
+        }
+
+        rxPttEdgeTail = tail;
+
+        if (tail != rxPttEdgeHead) {
+            count = TU_MIN(count, rxPttEdge[tail].total - rxReadTotal);
+        }
+        __enable_irq();
+
+        if (!(rxPttStatus & pttRxIgnoreMask)) {
+            /* Only forward data received while none of the enabled PTTs were asserted (shares the same pin) */
+            uint32_t available = tud_cdc_n_write_available(0);
+
+            if (available == 0) {
+                /* No space in fifo currently. Data stays in the ring until the CDC has sent some data */
+                break;
+            }
+
+            count = TU_MIN(count, available);
+            tud_cdc_n_write(0, &rxBuffer[rxReadPos], count);
+            LED_MODE(0, LED_MODE_FASTPULSE);
+
+            if (rxPending == 0) {
+                rxPendingTick = HAL_GetTick();
             }
-        } else {
-            /* No space in fifo currently. Pause this interrupt and re-enable later */
-            __disable_irq();
-            USB_SERIAL_UART->CR1 &= (uint32_t) ~USART_CR1_RXNEIE;
-            __enable_irq();
+            rxPending += count;
+            captureFlags = 0;
+        }
+
+        CaptureWrite(captureFlags, &rxBuffer[rxReadPos], count);
+        rxReadPos = (rxReadPos + count) % rxBufferSize;
+        rxReadTotal += count;
+    }
+}
+
+/* UART transmit chunk. Filled from the CDC FIFO whenever the DMA is idle.
+ * Like the receive path, TxKick() only runs at the serial interrupt priority */
+static uint8_t txBuffer[USB_SERIAL_UART_TXBUFSIZE];
+
+static void TxKick(void)
+{
+    if (USB_SERIAL_UART_TXDMA->CCR & DMA_CCR_EN) {
+        /* Chunk still in progress */
+        return;
+    }
+
+    uint32_t count = 0;
+
+    if (benchActive) {
+        /* Benchmark pattern instead of host data */
+        while ((count < sizeof(txBuffer)) && (benchTxCount < benchLength)) {
+            txBuffer[count++] = BenchNext(&benchTxLfsr, benchTxCount++);
+        }
+    } else {
+        count = tud_cdc_n_read(0, txBuffer, sizeof(txBuffer));
+        if (count > 0) {
+            CaptureWrite(USB_SERIAL_CAPTURE_FLAG_TX, txBuffer, count);
+        }
+
+        if ((count > 0) && txLatencyPending) {
+            /* Time from the host data arriving until it goes out on the UART */
+            uint32_t latency = (DWT->CYCCNT - txLatencyStart) / (SystemCoreClock / 1000000);
+            latency = TU_MIN(latency, 0xFFFF);
+            txLatencyMax = TU_MAX(txLatencyMax, latency);
+            txLatencyPending = false;
+
+            settingsRegMap[SETTINGS_REG_INFO_SERIAL5] =
+                    ((latency << SETTINGS_REG_INFO_SERIAL5_TXLAT_OFFS) & SETTINGS_REG_INFO_SERIAL5_TXLAT_MASK) |
+                    ((txLatencyMax << SETTINGS_REG_INFO_SERIAL5_TXLATMAX_OFFS) & SETTINGS_REG_INFO_SERIAL5_TXLATMAX_MASK);
+        }
+    }
+
+    if (count > 0) {
+        if ((USB_SERIAL_UART->CR3 & USART_CR3_HDSEL) && !benchActive) {
+            /* Half duplex: Turn the single wire around to transmit. With the receiver disabled,
+             * our own transmission does not echo back to the host */
+            USB_SERIAL_UART->CR1 &= (uint32_t) ~USART_CR1_RE;
+        }
+
+        /* Make sure the transmitter is running and start the next chunk */
+        USB_SERIAL_UART->CR1 |= USART_CR1_TE | USART_CR1_TCIE;
+        USB_SERIAL_UART_TXDMA->CNDTR = count;
+        USB_SERIAL_UART_TXDMA->CCR |= DMA_CCR_EN;
+        LED_MODE(1, LED_MODE_FASTPULSE);
+    }
+}
+
+void USB_SERIAL_UART_TXDMA_IRQ(void)
+{
+    if (DMA1->ISR & USB_SERIAL_UART_TXDMA_FLAGS) {
+        /* Chunk has been moved into the UART. Queue the next one right away */
+        DMA1->IFCR = USB_SERIAL_UART_TXDMA_CLR;
+        USB_SERIAL_UART_TXDMA->CCR &= (uint32_t) ~DMA_CCR_EN;
+        TxKick();
+    }
+}
+
+void USB_SERIAL_UART_RXDMA_IRQ(void)
+{
+    if (DMA1->ISR & USB_SERIAL_UART_RXDMA_FLAGS) {
+        /* Half or full ring received. Hand off before the DMA catches up with the read position */
+        DMA1->IFCR = USB_SERIAL_UART_RXDMA_CLR;
+        RxHandoff();
+        RxFlushPolicy();
+    }
+}
+
+void USB_SERIAL_UART_IRQ(void)
+{
+    uint32_t ISR = USB_SERIAL_UART->ISR;
+
+    if (benchAbort && benchActive) {
+        BenchFinish(SETTINGS_REG_INFO_SERIAL3_BENCHSTATUS_TIMEOUT_ENUM);
+    }
+
+    /* Start transmitting data from the CDC FIFO, if not already running.
+     * This handler is pended whenever the host has sent new data */
+    TxKick();
+
+    if ( (ISR & USART_ISR_TC) && (USB_SERIAL_UART->CR1 & USART_CR1_TCIE) ) {
+        /* Transmission complete. Clear flag, this will be set again after the last chunk */
+        USB_SERIAL_UART->ICR = USART_ICR_TCCF;
+
+        if (!(USB_SERIAL_UART_TXDMA->CCR & DMA_CCR_EN)) {
+            /* No new data queued to send and the last chunk has left the shift register,
+             * thus disable the transmitter. */
+            USB_SERIAL_UART->CR1 &= (uint32_t) ~(USART_CR1_TE | USART_CR1_TCIE);
+
+            /* Half duplex: The line is released, turn around to receive again. No-op in full duplex */
+            USB_SERIAL_UART->CR1 |= USART_CR1_RE;
         }
     }
 
+    /* Received data is moved by DMA. Also pick up data left over from a full CDC FIFO,
+     * since this handler is pended once space becomes available again */
+    RxHandoff();
+
     if (ISR & USART_ISR_RTOF) {
         USB_SERIAL_UART->ICR = USART_ICR_RTOCF;
         /* Receiver timeout. Flush data via USB. */
-        tud_cdc_n_write_flush(0);
+        RxFlush(FLUSH_RTO);
+    } else {
+        RxFlushPolicy();
     }
 
-    if (ISR & USART_ISR_ORE) {
-        /* Overflow error */
-        USB_SERIAL_UART->ICR = USART_ICR_ORECF;
-        TU_ASSERT(0, /**/);
-    }
+    if (ISR & (USART_ISR_ORE | USART_ISR_FE | USART_ISR_NE)) {
+        /* Count receive errors (saturating) */
+        if ((ISR & USART_ISR_FE) && (uartErrors[0] < UINT8_MAX)) uartErrors[0]++;
+        if ((ISR & USART_ISR_NE) && (uartErrors[1] < UINT8_MAX)) uartErrors[1]++;
+        if ((ISR & USART_ISR_ORE) && (uartErrors[2] < UINT8_MAX)) uartErrors[2]++;
 
-    if (ISR & USART_ISR_FE) {
-        USB_SERIAL_UART->ICR = USART_ISR_FE;
-    }
+        USB_SERIAL_UART->ICR = USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NCF;
 
-    if (ISR & USART_ISR_NE) {
-        USB_SERIAL_UART->ICR = USART_ISR_NE;
+        CaptureWrite( ((ISR & USART_ISR_FE) ? USB_SERIAL_CAPTURE_FLAG_FE : 0) |
+                      ((ISR & USART_ISR_NE) ? USB_SERIAL_CAPTURE_FLAG_NE : 0) |
+                      ((ISR & USART_ISR_ORE) ? USB_SERIAL_CAPTURE_FLAG_ORE : 0), NULL, 0);
+
+        ErrorUpdate();
     }
 }
 
 // Invoked when CDC interface received data from host
 void tud_cdc_rx_cb(uint8_t itf)
 {
-    TU_ASSERT(itf == 0, /**/);
+    /* The control CDC (if enabled) is polled from the main loop */
+    TU_VERIFY(itf == 0, /**/);
 
     uint8_t pttStatus = IO_PTTStatus();
     uint8_t pttTxForceMask = (settingsRegMap[SETTINGS_REG_SERIAL_CTRL] & SETTINGS_REG_SERIAL_CTRL_TXFRCPTT_MASK) >> SETTINGS_REG_SERIAL_CTRL_TXFRCPTT_OFFS;
 
     if (pttStatus & pttTxForceMask) {
-        /* Make sure the selected PTTs are disabled, since they might share a signal with the UART lines */
-        IO_PTTControl(pttStatus & ~pttTxForceMask);
+        /* Make sure the selected PTTs are disabled, since they might share a signal with the UART lines.
+         * This must not wait for the tail of the sub-audible tone encoder */
+        IO_PTTDeassertImmediate(pttStatus & pttTxForceMask);
     }
 
-    /* This enables the transmitter and the TX-empty interrupt, which handles writing UART data */
-    __disable_irq();
-    USB_SERIAL_UART->CR1 |= USART_CR1_TE | USART_CR1_TXEIE | USART_CR1_TCIE;
-    __enable_irq();
+    if (!txLatencyPending) {
+        txLatencyStart = DWT->CYCCNT;
+        txLatencyPending = true;
+    }
+
+    /* The UART interrupt enables the transmitter and starts the transmit DMA */
+    NVIC_SetPendingIRQ(USART1_IRQn);
 
 }
 
 // Invoked when space becomes available in TX buffer
 void tud_cdc_tx_complete_cb(uint8_t itf)
 {
-    TU_ASSERT(itf == 0, /**/);
+    TU_VERIFY(itf == 0, /**/);
 
-    /* Re-enable UART RX-nonempty interrupt to handle reading UART data */
-    __disable_irq();
-    USB_SERIAL_UART->CR1 |= USART_CR1_RXNEIE;
-    __enable_irq();
+    /* Let the UART interrupt hand over data that did not fit into the fifo before */
+    NVIC_SetPendingIRQ(USART1_IRQn);
+}
+
+static void SetDuplex(void)
+{
+    /* Must be called while the UART is disabled */
+    GPIO_InitTypeDef SerialGpio = {
+        .Pin = USB_SERIAL_UART_PIN_TX,
+        .Mode = GPIO_MODE_AF_PP,
+        .Pull = GPIO_PULLUP,
+        .Speed = GPIO_SPEED_FREQ_LOW,
+        .Alternate = GPIO_AF7_USART1
+    };
+
+    if (SETTINGS_GET(SETTINGS_REG_SERIAL_CTRL, DUPLEX) == SETTINGS_REG_SERIAL_CTRL_DUPLEX_HALF_ENUM) {
+        /* Single wire on the TX pin. Open drain, so that the radio can drive the line while we are not transmitting */
+        SerialGpio.Mode = GPIO_MODE_AF_OD;
+        USB_SERIAL_UART->CR3 |= USART_CR3_HDSEL;
+    } else {
+        USB_SERIAL_UART->CR3 &= (uint32_t) ~USART_CR3_HDSEL;
+    }
+
+    HAL_GPIO_Init(USB_SERIAL_UART_GPIO, &SerialGpio);
 }
 
 // Invoked when line coding is change via SET_LINE_CODING
 void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const* p_line_coding)
 {
-    TU_ASSERT(itf == 0, /**/);
+    TU_VERIFY(itf == 0, /**/);
 
     /* Disable IRQs and UART */
     __disable_irq();
     USB_SERIAL_UART->CR1 &= (uint32_t) ~USART_CR1_UE;
 
     /* Calculate new baudrate */
-    USB_SERIAL_UART->BRR = (HAL_RCCEx_GetPeriphCLKFreq(USB_SERIAL_UART_PERIPHCLK) + p_line_coding->bit_rate/2) / p_line_coding->bit_rate;
+    if (p_line_coding->bit_rate > 0) {
+        SetBaudrate(p_line_coding->bit_rate);
+    }
 
     if (p_line_coding->data_bits == 8) {
     } else {
@@ -164,6 +695,11 @@ void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const* p_line_coding)
         TU_ASSERT(0, /**/);
     }
 
+    SetDuplex();
+
+    /* Receiver timeout is given in bit times, so it follows the baudrate */
+    USB_SERIAL_UART->RTOR = (SETTINGS_GET(SETTINGS_REG_SERIAL_FLUSH, RXTIMEOUT) << USART_RTOR_RTO_Pos) & USART_RTOR_RTO_Msk;
+
     /* Re-enable UART */
     USB_SERIAL_UART->CR1 |= USART_CR1_UE;
     __enable_irq();
@@ -172,7 +708,7 @@ void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const* p_line_coding)
 // Invoked when cdc when line state changed e.g connected/disconnected
 void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts)
 {
-    TU_ASSERT(itf == 0, /**/);
+    TU_VERIFY(itf == 0, /**/);
 
     uint8_t pttMask = IO_PTT_MASK_NONE;
 
@@ -210,7 +746,7 @@ void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts)
 
     if (! (USB_SERIAL_UART->CR1 & USART_CR1_TE) ) {
         /* Enable PTT only when UART transmitter is not currently transmitting */
-        IO_PTTControl(pttMask);
+        IO_PTTControl(IO_PTT_SOURCE_SERIAL, pttMask);
     }
 }
 
@@ -236,51 +772,194 @@ void USB_SerialInit(void)
     HAL_StatusTypeDef status = HAL_RCCEx_PeriphCLKConfig(&PeriphClk);
     TU_ASSERT(status == HAL_OK, /**/);
 
+    /* Buffers are sized by the pool mode */
+    rxBufferSize = Pool_Size(POOL_CLIENT_SERIALRX);
+    rxBuffer = Pool_Alloc(POOL_CLIENT_SERIALRX, rxBufferSize);
+    TU_ASSERT(rxBuffer != NULL, /**/);
+
+    captureBufferSize = Pool_Size(POOL_CLIENT_CAPTURE);
+    captureBuffer = Pool_Alloc(POOL_CLIENT_CAPTURE, captureBufferSize);
+    TU_ASSERT((captureBufferSize & (captureBufferSize - 1)) == 0, /**/);
+
+    /* Set up circular receive DMA from the UART data register into the ring buffer */
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    USB_SERIAL_UART_RXDMA->CCR = 0;
+    USB_SERIAL_UART_RXDMA->CPAR = (uint32_t) &USB_SERIAL_UART->RDR;
+    USB_SERIAL_UART_RXDMA->CMAR = (uint32_t) rxBuffer;
+    USB_SERIAL_UART_RXDMA->CNDTR = rxBufferSize;
+    USB_SERIAL_UART_RXDMA->CCR = DMA_MDATAALIGN_BYTE | DMA_PDATAALIGN_BYTE | DMA_MINC_ENABLE | DMA_CIRCULAR
+            | DMA_PERIPH_TO_MEMORY | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN;
+
+    /* Set up transmit DMA from the chunk buffer into the UART data register. Started on demand */
+    USB_SERIAL_UART_TXDMA->CCR = 0;
+    USB_SERIAL_UART_TXDMA->CPAR = (uint32_t) &USB_SERIAL_UART->TDR;
+    USB_SERIAL_UART_TXDMA->CMAR = (uint32_t) txBuffer;
+    USB_SERIAL_UART_TXDMA->CCR = DMA_MDATAALIGN_BYTE | DMA_PDATAALIGN_BYTE | DMA_MINC_ENABLE | DMA_NORMAL
+            | DMA_MEMORY_TO_PERIPH | DMA_CCR_TCIE | DMA_CCR_TEIE;
+
     /* Initialize UART */
     __HAL_RCC_USART1_CLK_ENABLE();
     USB_SERIAL_UART->CR1 = USART_CR1_RTOIE | UART_OVERSAMPLING_16 | UART_WORDLENGTH_8B
-            | UART_PARITY_NONE | USART_CR1_RXNEIE | UART_MODE_RX; /* Enable receiver only, transmitter will be enabled on-demand */
+            | UART_PARITY_NONE | UART_MODE_RX; /* Enable receiver only, transmitter will be enabled on-demand */
     USB_SERIAL_UART->CR2 = UART_RECEIVER_TIMEOUT_ENABLE | UART_STOPBITS_1;
-    USB_SERIAL_UART->CR3 = USART_CR3_EIE;
-    USB_SERIAL_UART->BRR = (HAL_RCCEx_GetPeriphCLKFreq(USB_SERIAL_UART_PERIPHCLK) + USB_SERIAL_UART_DEFBAUD/2) / USB_SERIAL_UART_DEFBAUD;
-    USB_SERIAL_UART->RTOR = ((uint32_t) USB_SERIAL_UART_RXTIMEOUT << USART_RTOR_RTO_Pos) & USART_RTOR_RTO_Msk;
+    USB_SERIAL_UART->CR3 = USART_CR3_EIE | USART_CR3_DMAR | USART_CR3_DMAT;
+    SetBaudrate(USB_SERIAL_UART_DEFBAUD);
+    USB_SERIAL_UART->RTOR = (SETTINGS_GET(SETTINGS_REG_SERIAL_FLUSH, RXTIMEOUT) << USART_RTOR_RTO_Pos) & USART_RTOR_RTO_Msk;
+    SetDuplex();
     USB_SERIAL_UART->CR1 |= USART_CR1_UE;
 
-    /* Enable interrupt */
+    /* Enable interrupts. All run at the same priority, so they never preempt each other */
     NVIC_SetPriority(USART1_IRQn, AIOC_IRQ_PRIO_SERIAL);
     NVIC_EnableIRQ(USART1_IRQn);
+    NVIC_SetPriority(USB_SERIAL_UART_RXDMA_IRQN, AIOC_IRQ_PRIO_SERIAL);
+    NVIC_EnableIRQ(USB_SERIAL_UART_RXDMA_IRQN);
+    NVIC_SetPriority(USB_SERIAL_UART_TXDMA_IRQN, AIOC_IRQ_PRIO_SERIAL);
+    NVIC_EnableIRQ(USB_SERIAL_UART_TXDMA_IRQN);
+}
+
+static uint8_t LineState(void)
+{
+    uint32_t sources = lineStateSources;
+    uint8_t lineState = 0x00;
+
+    for (uint8_t i=0; i<USB_SERIAL_SOURCE_COUNT; i++) {
+        lineState |= (sources >> (i * USB_SERIAL_SOURCE_BITS)) & USB_SERIAL_LINESTATE_MASK;
+    }
+
+    return lineState;
+}
+
+static void LineStateTask(void)
+{
+    uint8_t const rhport = 0;
+
+    if (!tud_mounted() || !tud_cdc_n_connected(0)) {
+        /* Nobody listening (or the endpoint is not even open yet). Send the current state once the host opens the port */
+        lineStateResend = true;
+        return;
+    }
+
+    uint8_t lineState = LineState();
+
+    if ((lineState == lineStateSent) && !lineStateResend) {
+        return;
+    }
+
+    /* If the endpoint is still busy with the previous notification, try again on the next call.
+     * Changes in the meantime are coalesced, only the latest state is sent. */
+    if (!usbd_edpt_claim(rhport, EPNUM_CDC_0_NOTIF)) {
+        return;
+    }
+
+    lineStateNotification[8] = lineState;
+    lineStateNotification[9] = 0x00;
+
+    if (usbd_edpt_xfer(rhport, EPNUM_CDC_0_NOTIF, lineStateNotification, sizeof(lineStateNotification))) {
+        lineStateSent = lineState;
+        lineStateResend = false;
+    } else {
+        usbd_edpt_release(rhport, EPNUM_CDC_0_NOTIF);
+    }
 }
 
 void USB_SerialTask(void)
 {
+    static uint32_t captureTick = 0;
+
+    LineStateTask();
+
+    if ((HAL_GetTick() - captureTick) >= 1000) {
+        /* Keep the capture time base running across cycle counter wrap-arounds */
+        captureTick = HAL_GetTick();
+        __disable_irq();
+        CaptureTime();
+        __enable_irq();
+    }
 
+    if (!benchActive && SETTINGS_GET(SETTINGS_REG_SERIAL_BENCH, RUN)) {
+        BenchStart();
+    } else if (benchActive && ((HAL_GetTick() - benchStartTick) > benchTimeout)) {
+        /* Data went missing. Let the UART interrupt finish the benchmark */
+        benchAbort = true;
+        NVIC_SetPendingIRQ(USART1_IRQn);
+    }
+
+    static uint32_t lastTick = 0;
+    uint32_t nowTick = HAL_GetTick();
+
+    if (SETTINGS_GET(SETTINGS_REG_SERIAL_FLUSH, MAXLAT) && (nowTick != lastTick)) {
+        /* Once per millisecond, let the UART interrupt pick up data still sitting in the receive ring
+         * and check the latency bound. Flushing is only ever done from there. */
+        lastTick = nowTick;
+
+        if ((rxPending > 0) || (rxReadPos != (rxBufferSize - USB_SERIAL_UART_RXDMA->CNDTR) % rxBufferSize)) {
+            NVIC_SetPendingIRQ(USART1_IRQn);
+        }
+    }
 }
 
-#include "device/usbd_pvt.h"
+void USB_SerialPTTChanged(uint8_t pttStatus)
+{
+    /* Called with interrupts disabled, whenever the PTT outputs change */
+    if (rxBufferSize == 0) {
+        /* Receive path not set up yet */
+        rxPttStatus = pttStatus;
+        return;
+    }
+
+    uint8_t head = rxPttEdgeHead;
+    uint8_t last = (head + RX_PTTEDGE_COUNT - 1) % RX_PTTEDGE_COUNT;
+    uint32_t total = RxWriteTotal();
+
+    if ( (head != rxPttEdgeTail) && ((rxPttEdge[last].total == total) || (((head + 1) % RX_PTTEDGE_COUNT) == rxPttEdgeTail)) ) {
+        /* Nothing received since the previous change, or no space left. Only the latest state counts */
+        rxPttEdge[last].status = pttStatus;
+        return;
+    }
 
-bool USB_SerialSendLineState(uint8_t lineState)
+    rxPttEdge[head].total = total;
+    rxPttEdge[head].status = pttStatus;
+    rxPttEdgeHead = (head + 1) % RX_PTTEDGE_COUNT;
+}
+
+bool USB_SerialSendLineState(uint8_t source, uint8_t lineMask, bool state)
 {
-#if 0
-    /* TODO: This causes issues with the stack if its being called before CDC was initialized? Crashes on terminal connect */
-    uint8_t const rhport = 0;
-    static uint8_t notification[10] = {
-        /* bmRequestType */ 0xA1,
-        /* bNotification */ 0x20,
-        /* wValue */ 0x00, 0x00,
-        /* wIndex */ ITF_NUM_CDC_0, 0x00,
-        /* wLength */ 0x02, 0x00,
-        /* Data */ 0x00, 0x00
-    };
+    /* May be called from any ISR. Only records the new state, the notification is sent from the main loop */
+    if (source >= USB_SERIAL_SOURCE_COUNT) {
+        return false;
+    }
 
-    notification[8] = lineState;
-    notification[9] = 0x00;
+    uint32_t mask = (uint32_t) (lineMask & USB_SERIAL_LINESTATE_MASK) << (source * USB_SERIAL_SOURCE_BITS);
 
-    // claim endpoint
-    TU_VERIFY( usbd_edpt_claim(rhport, EPNUM_CDC_0_NOTIF) );
+    if (state) {
+        __atomic_fetch_or(&lineStateSources, mask, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_and(&lineStateSources, ~mask, __ATOMIC_RELAXED);
+    }
 
-    return usbd_edpt_xfer(rhport, EPNUM_CDC_0_NOTIF, notification, sizeof(notification));
-#else
     return true;
-#endif
 }
 
+uint16_t USB_SerialCaptureRead(uint8_t * buffer, uint16_t bufferSize)
+{
+    /* Copy as many complete records as fit into the buffer */
+    uint32_t tail = captureTail;
+    uint32_t head = captureHead;
+    uint16_t count = 0;
+
+    while (tail != head) {
+        uint16_t recordLen = USB_SERIAL_CAPTURE_HDRLEN + captureBuffer[(tail + USB_SERIAL_CAPTURE_HDRLEN - 1) % captureBufferSize];
+
+        if ((count + recordLen) > bufferSize) {
+            break;
+        }
+
+        while (recordLen--) {
+            buffer[count++] = captureBuffer[tail++ % captureBufferSize];
+        }
+    }
+
+    captureTail = tail;
+
+    return count;
+}
@@ -7,20 +7,52 @@
 #define USB_SERIAL_UART             USART1
 #define USB_SERIAL_UART_IRQ         USART1_IRQHandler
 #define USB_SERIAL_UART_PERIPHCLK   RCC_PERIPHCLK_USART1
-#define USB_SERIAL_UART_RXTIMEOUT   20 /* in number of bits */
 #define USB_SERIAL_UART_DEFBAUD     9600
 #define USB_SERIAL_UART_GPIO        GPIOA
 #define USB_SERIAL_UART_PIN_TX      GPIO_PIN_9
 #define USB_SERIAL_UART_PIN_RX      GPIO_PIN_10
+#define USB_SERIAL_UART_RXDMA       DMA1_Channel5
+#define USB_SERIAL_UART_RXDMA_IRQ   DMA1_Channel5_IRQHandler
+#define USB_SERIAL_UART_RXDMA_IRQN  DMA1_Channel5_IRQn
+#define USB_SERIAL_UART_RXDMA_FLAGS (DMA_ISR_HTIF5 | DMA_ISR_TCIF5 | DMA_ISR_TEIF5)
+#define USB_SERIAL_UART_RXDMA_CLR   DMA_IFCR_CGIF5
+#define USB_SERIAL_UART_TXDMA       DMA1_Channel4
+#define USB_SERIAL_UART_TXDMA_IRQ   DMA1_Channel4_IRQHandler
+#define USB_SERIAL_UART_TXDMA_IRQN  DMA1_Channel4_IRQn
+#define USB_SERIAL_UART_TXDMA_FLAGS (DMA_ISR_TCIF4 | DMA_ISR_TEIF4)
+#define USB_SERIAL_UART_TXDMA_CLR   DMA_IFCR_CGIF4
+#define USB_SERIAL_UART_TXBUFSIZE   64 /* Linear DMA transmit chunk in bytes */
 
 #define USB_SERIAL_LINESTATE_DCD    0x01
 #define USB_SERIAL_LINESTATE_DSR    0x02
 #define USB_SERIAL_LINESTATE_BREAK  0x04
 #define USB_SERIAL_LINESTATE_RI     0x08
+#define USB_SERIAL_LINESTATE_MASK   0x0F
+
+/* Sources of line state changes. Each source holds its own line states, which are combined for the notification */
+#define USB_SERIAL_SOURCE_IN1       0
+#define USB_SERIAL_SOURCE_IN2       1
+#define USB_SERIAL_SOURCE_VCOS      2
+#define USB_SERIAL_SOURCE_COUNT     3
+#define USB_SERIAL_SOURCE_BITS      4
+
+/* Capture record: 32 bit timestamp in us (little endian), flags, data length, followed by the data */
+#define USB_SERIAL_CAPTURE_HDRLEN       6
+#define USB_SERIAL_CAPTURE_FLAG_TX      0x01 /* Host to radio, otherwise radio to host */
+#define USB_SERIAL_CAPTURE_FLAG_IGNORED 0x02 /* Received while PTT asserted, not forwarded to host */
+#define USB_SERIAL_CAPTURE_FLAG_FE      0x10 /* Framing error */
+#define USB_SERIAL_CAPTURE_FLAG_NE      0x20 /* Noise error */
+#define USB_SERIAL_CAPTURE_FLAG_ORE     0x40 /* Overrun error */
+#define USB_SERIAL_CAPTURE_FLAG_LOST    0x80 /* Records have been lost before this one */
 
 void USB_SerialInit(void);
 void USB_SerialTask(void);
 
-bool USB_SerialSendLineState(uint8_t lineState);
+uint16_t USB_SerialCaptureRead(uint8_t * buffer, uint16_t bufferSize);
+
+bool USB_SerialSendLineState(uint8_t source, uint8_t lineMask, bool state);
+
+/* Called by the IO layer with interrupts disabled, whenever the PTT outputs change */
+void USB_SerialPTTChanged(uint8_t pttStatus);
 
 #endif /* USB_SERIAL_H_ */
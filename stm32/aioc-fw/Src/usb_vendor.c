@@ -0,0 +1,200 @@
+#include "usb_vendor.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "aioc.h"
+#include "settings.h"
+#include "usb_descriptors.h"
+#include "usb_serial.h"
+#include "stm32f3xx_hal.h"
+#include <string.h>
+
+/* Staging buffer for register map transfers. IN transfers are served from a snapshot,
+ * OUT transfers are applied only after the data stage has completed. Also used for capture readout. */
+static uint32_t regMapBuffer[SETTINGS_REGMAP_SIZE];
+
+static const usb_vendor_buildinfo_t buildInfo = {
+    .magic = SETTINGS_REG_MAGIC_DEFAULT,
+    .regMapSize = SETTINGS_REGMAP_SIZE,
+    .regMapReadOnlyAddr = SETTINGS_REGMAP_READONLYADDR,
+    .layoutVersion = SETTINGS_LAYOUT_VERSION,
+    .profileCount = SETTINGS_PROFILE_COUNT,
+    .buildId = AIOC_BUILD_ID
+};
+
+static bool RegMapRequest(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
+{
+    uint16_t address = request->wValue;
+    uint16_t count = request->wLength / sizeof(uint32_t);
+
+    TU_VERIFY((count > 0) && ((request->wLength % sizeof(uint32_t)) == 0));
+    TU_VERIFY((address + count) <= SETTINGS_REGMAP_SIZE);
+
+    if (request->bmRequestType_bit.direction == TUSB_DIR_IN) {
+        if (stage == CONTROL_STAGE_SETUP) {
+            /* Take a consistent snapshot */
+            __disable_irq();
+            memcpy(regMapBuffer, &settingsRegMap[address], request->wLength);
+            __enable_irq();
+
+            return tud_control_xfer(rhport, request, regMapBuffer, request->wLength);
+        }
+    } else {
+        if (stage == CONTROL_STAGE_SETUP) {
+            return tud_control_xfer(rhport, request, regMapBuffer, request->wLength);
+        } else if (stage == CONTROL_STAGE_DATA) {
+            /* Applied as a whole. Read-only registers are silently skipped */
+            Settings_RegWriteBlock(address, regMapBuffer, count);
+        }
+    }
+
+    return true;
+}
+
+static bool CtrlRequest(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
+{
+    uint16_t ctrlWord = request->wValue;
+
+    TU_VERIFY(request->wLength == 0);
+
+    if (stage == CONTROL_STAGE_SETUP) {
+        return tud_control_status(rhport, request);
+    } else if (stage == CONTROL_STAGE_ACK) {
+        /* Execute after the status stage, so the host sees the request completing */
+        if (ctrlWord & 0x10UL) {
+            Settings_Default();
+        }
+
+        if (ctrlWord & 0x40UL) {
+            Settings_Recall();
+        }
+
+        if ((ctrlWord & 0x06UL) == 0x06UL) {
+            /* Begin and commit at once aborts the transaction */
+            Settings_Abort();
+        } else if (ctrlWord & 0x02UL) {
+            Settings_Begin();
+        } else if (ctrlWord & 0x04UL) {
+            Settings_Commit();
+        }
+
+        if (ctrlWord & 0x80UL) {
+            Settings_Store();
+        }
+
+        if (ctrlWord & 0x08UL) {
+            Settings_ProfileStore();
+        }
+
+        if (ctrlWord & 0x20UL) {
+            /* Reboot */
+            while(1) {
+                /* Let IWDG expire for rebooting */
+            }
+        }
+    }
+
+    return true;
+}
+
+// Invoked when a control transfer occurred on an interface of this class
+// Driver response accordingly to the request and the transfer stage (setup/data/ack)
+// return false to stall control endpoint (e.g unsupported request)
+bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
+{
+    switch (request->bRequest) {
+    case USB_VENDOR_REQ_MS_OS_20:
+        TU_VERIFY(request->wIndex == MS_OS_20_DESC_INDEX);
+        if (stage == CONTROL_STAGE_SETUP) {
+            return tud_control_xfer(rhport, request, (void *) (uintptr_t) desc_ms_os_20, TU_MIN(request->wLength, MS_OS_20_DESC_LEN));
+        }
+        return true;
+
+    case USB_VENDOR_REQ_REGMAP:
+        return RegMapRequest(rhport, stage, request);
+
+    case USB_VENDOR_REQ_BUILDINFO:
+        TU_VERIFY(request->bmRequestType_bit.direction == TUSB_DIR_IN);
+        if (stage == CONTROL_STAGE_SETUP) {
+            return tud_control_xfer(rhport, request, (void *) (uintptr_t) &buildInfo, TU_MIN(request->wLength, sizeof(buildInfo)));
+        }
+        return true;
+
+    case USB_VENDOR_REQ_CTRL:
+        return CtrlRequest(rhport, stage, request);
+
+    case USB_VENDOR_REQ_CAPTURE:
+        TU_VERIFY(request->bmRequestType_bit.direction == TUSB_DIR_IN);
+        if (stage == CONTROL_STAGE_SETUP) {
+            uint16_t length = USB_SerialCaptureRead((uint8_t *) regMapBuffer, TU_MIN(request->wLength, sizeof(regMapBuffer)));
+            return tud_control_xfer(rhport, request, regMapBuffer, length);
+        }
+        return true;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+/* Minimal class driver claiming the (endpoint-less) vendor interface.
+ * Vendor requests are routed by the stack to tud_vendor_control_xfer_cb() directly. */
+static void VendorDriverInit(void)
+{
+}
+
+static void VendorDriverReset(uint8_t rhport)
+{
+    (void) rhport;
+}
+
+static uint16_t VendorDriverOpen(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len)
+{
+    (void) rhport;
+
+    TU_VERIFY(itf_desc->bInterfaceClass == TUSB_CLASS_VENDOR_SPECIFIC, 0);
+    TU_VERIFY(itf_desc->bInterfaceNumber == ITF_NUM_VENDOR, 0);
+    TU_VERIFY(max_len >= sizeof(tusb_desc_interface_t), 0);
+
+    return sizeof(tusb_desc_interface_t);
+}
+
+static bool VendorDriverControlXfer(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
+{
+    (void) rhport;
+    (void) stage;
+    (void) request;
+
+    /* No class requests */
+    return false;
+}
+
+static bool VendorDriverXfer(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+    (void) rhport;
+    (void) ep_addr;
+    (void) result;
+    (void) xferred_bytes;
+
+    /* No endpoints */
+    return false;
+}
+
+static const usbd_class_driver_t vendorDriver = {
+#if CFG_TUSB_DEBUG >= 2
+    .name = "AIOC Vendor",
+#endif
+    .init = VendorDriverInit,
+    .reset = VendorDriverReset,
+    .open = VendorDriverOpen,
+    .control_xfer_cb = VendorDriverControlXfer,
+    .xfer_cb = VendorDriverXfer,
+    .sof = NULL
+};
+
+// Invoked when initializing device stack to get additional class drivers.
+usbd_class_driver_t const * usbd_app_driver_get_cb(uint8_t * driver_count)
+{
+    *driver_count = 1;
+    return &vendorDriver;
+}
@@ -0,0 +1,34 @@
+#ifndef USB_VENDOR_H_
+#define USB_VENDOR_H_
+
+#include <stdint.h>
+
+/* Vendor specific control requests (recipient device).
+ * REGMAP:    IN reads, OUT writes wLength/4 registers starting at address wValue.
+ *            A write is applied atomically. Writes to read-only registers are ignored.
+ * BUILDINFO: IN returns usb_vendor_buildinfo_t.
+ * CTRL:      No data stage. wValue holds the control word, with the same bits as in the HID feature report
+ *            (0x10: load defaults, 0x40: recall, 0x02: begin, 0x04: commit, 0x06: abort,
+ *            0x80: store, 0x08: store profile, 0x20: reboot).
+ *            A transaction is aborted, when no register is written for 2 seconds.
+ * CAPTURE:   IN returns as many complete serial capture records as fit into wLength (see usb_serial.h).
+ *            Returns an empty data stage when no records are pending.
+ * MS_OS_20:  IN returns the Microsoft OS 2.0 descriptor set (wIndex = 7). */
+#define USB_VENDOR_REQ_REGMAP       0x01
+#define USB_VENDOR_REQ_BUILDINFO    0x02
+#define USB_VENDOR_REQ_CTRL         0x03
+#define USB_VENDOR_REQ_CAPTURE      0x04
+#define USB_VENDOR_REQ_MS_OS_20     0x20
+
+#define USB_VENDOR_BUILDID_LEN      32
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t regMapSize;
+    uint16_t regMapReadOnlyAddr;
+    uint16_t layoutVersion;
+    uint16_t profileCount;
+    char buildId[USB_VENDOR_BUILDID_LEN];
+} usb_vendor_buildinfo_t;
+
+#endif /* USB_VENDOR_H_ */
@@ -0,0 +1,68 @@
+#include "vox.h"
+#include "settings.h"
+#include "usb_audio.h"
+#include "preroll.h"
+
+void Vox_Init(vox_t * vox, vox_source_t source)
+{
+    *vox = (vox_t) {
+        .source = source,
+        .blockLength = 1
+    };
+}
+
+vox_event_t Vox_Block(vox_t * vox)
+{
+    uint32_t sampleRate, timeout, attackLevel, releaseLevel, attackTime;
+
+    if (vox->source == VOX_SOURCE_VPTT) {
+        sampleRate = USB_AudioTxSampleRate();
+        timeout = Preroll_PttTimeout(SETTINGS_GET(SETTINGS_REG_VPTT_TIMCTRL, TIMEOUT));
+        attackLevel = SETTINGS_GET(SETTINGS_REG_VPTT_LVLCTRL, THRSHLD);
+        releaseLevel = SETTINGS_GET(SETTINGS_REG_VPTT_VOXCTRL, RELEASE);
+        attackTime = SETTINGS_GET(SETTINGS_REG_VPTT_VOXCTRL, ATTACK);
+    } else {
+        sampleRate = USB_AudioRxSampleRate();
+        timeout = SETTINGS_GET(SETTINGS_REG_VCOS_TIMCTRL, TIMEOUT);
+        attackLevel = SETTINGS_GET(SETTINGS_REG_VCOS_LVLCTRL, THRSHLD);
+        releaseLevel = SETTINGS_GET(SETTINGS_REG_VCOS_VOXCTRL, RELEASE);
+        attackTime = SETTINGS_GET(SETTINGS_REG_VCOS_VOXCTRL, ATTACK);
+    }
+
+    uint32_t level = vox->accu / vox->blockLength;
+
+    /* Follow the sample rate, which may be changed by the host at any time */
+    vox->accu = 0;
+    vox->blockPos = 0;
+    vox->blockLength = (sampleRate >= VOX_BLOCK_RATE) ? sampleRate / VOX_BLOCK_RATE : 1;
+
+    /* Timeout is given in milliseconds in 12.4 format. The hang time has to outlast the next block */
+    uint32_t hang = (uint32_t) (((uint64_t) timeout * sampleRate) / 16000);
+
+    if (hang <= vox->blockLength) {
+        hang = vox->blockLength + 1;
+    }
+
+    if (vox->active) {
+        if (level >= releaseLevel) {
+            vox->hangRemaining = hang;
+        }
+
+        return VOX_EVENT_NONE;
+    }
+
+    if (level < attackLevel) {
+        vox->attackCount = 0;
+        return VOX_EVENT_NONE;
+    }
+
+    if (++vox->attackCount < attackTime) {
+        return VOX_EVENT_NONE;
+    }
+
+    vox->attackCount = 0;
+    vox->active = true;
+    vox->hangRemaining = hang;
+
+    return VOX_EVENT_ON;
+}
@@ -0,0 +1,54 @@
+#ifndef VOX_H_
+#define VOX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Envelope based voice operated switch for the virtual PTT (playback) and virtual COS (capture).
+ * The mean absolute value of 1 ms blocks is compared against an attack threshold, which has to be exceeded
+ * for the attack time, and a lower release threshold, below which the hang time starts. The hang time is
+ * counted in samples. State transitions are returned as events, so the timers only need to be touched on those. */
+#define VOX_BLOCK_RATE          1000 /* Blocks per second */
+
+typedef enum {
+    VOX_SOURCE_VPTT,
+    VOX_SOURCE_VCOS
+} vox_source_t;
+
+typedef enum {
+    VOX_EVENT_NONE,
+    VOX_EVENT_ON,
+    VOX_EVENT_OFF
+} vox_event_t;
+
+typedef struct {
+    vox_source_t source;
+    uint32_t accu;
+    uint16_t blockPos;
+    uint16_t blockLength;
+    uint8_t attackCount;
+    bool active;
+    uint32_t hangRemaining;
+} vox_t;
+
+void Vox_Init(vox_t * vox, vox_source_t source);
+vox_event_t Vox_Block(vox_t * vox);
+
+/* Called from interrupt context for every sample */
+static inline vox_event_t Vox_Sample(vox_t * vox, int16_t sample)
+{
+    vox->accu += (sample < 0) ? -sample : sample;
+
+    if ((vox->hangRemaining != 0) && (--vox->hangRemaining == 0)) {
+        vox->active = false;
+        return VOX_EVENT_OFF;
+    }
+
+    if (++vox->blockPos < vox->blockLength) {
+        return VOX_EVENT_NONE;
+    }
+
+    return Vox_Block(vox);
+}
+
+#endif /* VOX_H_ */